@@ -0,0 +1,642 @@
+#include "app_base.hpp"
+
+#include <map>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+#include <string_view>
+
+// Reproducible headless scenes rendered through AppBase, reported as JSON on stdout. With --compare the results
+// are checked against a stored baseline and the exit code is 1 if anything regressed. Steady scenes also fail
+// the run if any frame after the warmup touches the heap.
+
+namespace {
+
+    enum class SceneKind : uint8_t {
+        eRects,
+        ePolylines,
+        eText,
+        eTextures,
+        eStaticUi,
+        eDynamicUi,
+        eShapes
+    };
+
+    struct SceneInfo {
+        SceneKind kind;
+        const char* name;
+        const char* description;
+        // Draws the same kind of frame over and over, nothing allocates after the warmup. New strings every
+        // frame add text runs, texture uploads land in the first frames.
+        bool steady;
+    };
+
+    constexpr std::array<SceneInfo, 7> Scenes = {{
+            {SceneKind::eRects, "rects", "100k small rects", true},
+            {SceneKind::ePolylines, "polylines", "one 1M point chart", true},
+            {SceneKind::eText, "text", "720 labels with numbers changing every frame", false},
+            {SceneKind::eTextures, "textures", "20k quads sampling 256 textures", false},
+            {SceneKind::eStaticUi, "static_ui", "a dashboard in cached scopes that never changes", true},
+            {SceneKind::eDynamicUi, "dynamic_ui", "the same dashboard redrawn with new values every frame", false},
+            {SceneKind::eShapes, "shapes", "300k rounded rects in scrolling clipped panels, most of them hidden", true}
+    }};
+
+    struct BenchOptions {
+        uint32_t frames = 300;
+        uint32_t warmupFrames = 60;
+        vk::Extent2D extent{1280, 720};
+        bool directDraws = false;
+        bool gpuShapeCulling = false;
+    };
+
+    // Averages over the measured frames, in the order they are written to the JSON
+    struct SceneResult {
+        std::string name;
+        uint32_t frames = 0;
+        uint32_t submitted = 0;
+        double cpuMsAvg = 0.0;
+        double cpuMsP50 = 0.0;
+        double cpuMsP99 = 0.0;
+        double frameMsAvg = 0.0;
+        double gpuMsAvg = 0.0;
+        double gpuMsP99 = 0.0;
+        double drawCalls = 0.0;
+        double batches = 0.0;
+        double uploadedBytes = 0.0;
+        double allocations = 0.0;
+    };
+
+    class Rng {
+    public:
+        explicit Rng(uint32_t seed) : state(seed) {}
+
+        float next() {
+            this->state = this->state * 1664525u + 1013904223u;
+            return static_cast<float>(this->state >> 8) / static_cast<float>(1u << 24);
+        }
+
+        float range(float min, float max) { return min + (max - min) * next(); }
+
+    private:
+        uint32_t state;
+    };
+
+    class BenchApp : public imr::AppBase {
+    public:
+        BenchApp(const imr::AppConfig& config, SceneKind scene, uint32_t warmupFrames) :
+                AppBase(config), scene(scene), warmupFrames(warmupFrames), width(static_cast<float>(config.extent.width)),
+                height(static_cast<float>(config.extent.height)) {
+            // Recording the stats mustn't show up in the allocation count
+            this->cpuMs.reserve(config.maxFrames);
+            this->frameMs.reserve(config.maxFrames);
+
+            setup();
+        }
+
+        void onDraw(imr::Renderer& renderer) override {
+            switch (this->scene) {
+                case SceneKind::eRects: drawRects(renderer); break;
+                case SceneKind::ePolylines: drawPolylines(renderer); break;
+                case SceneKind::eText: drawLabels(renderer); break;
+                case SceneKind::eTextures: drawTextures(renderer); break;
+                case SceneKind::eStaticUi: drawDashboard(renderer, true); break;
+                case SceneKind::eDynamicUi: drawDashboard(renderer, false); break;
+                case SceneKind::eShapes: drawPanels(renderer); break;
+            }
+        }
+
+        void onFrameEnd(const imr::FrameStats& stats) override {
+            auto now = std::chrono::steady_clock::now();
+
+            if (getFrameCount() >= this->warmupFrames) {
+                this->cpuMs.push_back(stats.cpuMs);
+                this->frameMs.push_back(std::chrono::duration<double, std::milli>(now - this->lastFrameEnd).count());
+                this->drawCalls += stats.drawCalls;
+                this->batches += stats.batches;
+                this->uploadedBytes += stats.uploadedBytes;
+                this->allocations += stats.allocations;
+                if (stats.submitted) this->submitted++;
+            }
+
+            this->lastFrameEnd = now;
+        }
+
+        SceneResult getResult(std::string name) const {
+            SceneResult result;
+            result.name = std::move(name);
+            result.frames = static_cast<uint32_t>(this->cpuMs.size());
+            result.submitted = this->submitted;
+            if (result.frames == 0) return result;
+
+            std::vector<double> sorted = this->cpuMs;
+            std::ranges::sort(sorted);
+            auto frames = static_cast<double>(result.frames);
+
+            result.cpuMsAvg = sum(this->cpuMs) / frames;
+            result.cpuMsP50 = sorted[sorted.size() / 2];
+            result.cpuMsP99 = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+            result.frameMsAvg = sum(this->frameMs) / frames;
+            result.drawCalls = static_cast<double>(this->drawCalls) / frames;
+            result.batches = static_cast<double>(this->batches) / frames;
+            result.uploadedBytes = static_cast<double>(this->uploadedBytes) / frames;
+            result.allocations = static_cast<double>(this->allocations) / frames;
+
+            // The profiler keeps the last few hundred samples of each zone, the warmup mostly fell out of them.
+            // Shape culling runs in front of the graph, the p99s are summed as an upper bound.
+            for (const auto& zone : getGpuProfiler().getZoneStats()) {
+                if (zone.name != "FrameGraph" && zone.name != "CullShapes") continue;
+                result.gpuMsAvg += zone.avgMs;
+                result.gpuMsP99 += zone.p99Ms;
+            }
+
+            return result;
+        }
+
+    private:
+        SceneKind scene;
+        uint32_t warmupFrames;
+        float width;
+        float height;
+
+        // Generated once, so the frames only measure drawing
+        std::vector<glm::vec2> positions;
+        std::vector<glm::vec2> sizes;
+        std::vector<glm::vec4> colors;
+        std::vector<glm::vec2> chart;
+        std::vector<imr::TextureHandle> textures;
+
+        std::vector<double> cpuMs;
+        std::vector<double> frameMs;
+        uint64_t drawCalls = 0;
+        uint64_t batches = 0;
+        uint64_t uploadedBytes = 0;
+        uint64_t allocations = 0;
+        uint32_t submitted = 0;
+        std::chrono::steady_clock::time_point lastFrameEnd = std::chrono::steady_clock::now();
+
+        static constexpr uint32_t ShapeCount = 300'000;
+        static constexpr uint32_t PanelCount = 48;
+        static constexpr float PanelWidth = 160.0f;
+        static constexpr float PanelHeight = 120.0f;
+
+        static double sum(const std::vector<double>& values) {
+            double total = 0.0;
+            for (double value : values) total += value;
+            return total;
+        }
+
+        void setup() {
+            Rng rng(0x1234567u);
+
+            if (this->scene == SceneKind::eRects || this->scene == SceneKind::eTextures) {
+                uint32_t count = this->scene == SceneKind::eRects ? 100'000 : 20'000;
+                for (uint32_t i = 0; i < count; i++) {
+                    this->positions.emplace_back(rng.range(0.0f, this->width - 12.0f), rng.range(0.0f, this->height - 12.0f));
+                    this->sizes.emplace_back(rng.range(2.0f, 12.0f), rng.range(2.0f, 12.0f));
+                    this->colors.emplace_back(rng.next(), rng.next(), rng.next(), 1.0f);
+                }
+            }
+
+            if (this->scene == SceneKind::eShapes) {
+                // Every panel's content is four panels tall, scrolling shows a different quarter of it
+                for (uint32_t i = 0; i < ShapeCount; i++) {
+                    this->positions.emplace_back(rng.range(0.0f, PanelWidth - 12.0f), rng.range(0.0f, PanelHeight * 4.0f));
+                    this->sizes.emplace_back(rng.range(4.0f, 12.0f), rng.range(4.0f, 12.0f));
+                    this->colors.emplace_back(rng.next(), rng.next(), rng.next(), 1.0f);
+                }
+            }
+
+            if (this->scene == SceneKind::ePolylines) {
+                constexpr uint32_t PointCount = 1'000'000;
+                this->chart.resize(PointCount);
+
+                float y = 0.0f;
+                for (uint32_t i = 0; i < PointCount; i++) {
+                    y = std::clamp(y + rng.range(-2.0f, 2.0f), -200.0f, 200.0f);
+                    this->chart[i] = {static_cast<float>(i) * this->width / PointCount, this->height * 0.5f + y};
+                }
+            }
+
+            if (this->scene == SceneKind::eTextures) {
+                constexpr uint32_t TextureSize = 64;
+                for (uint32_t t = 0; t < 256; t++) {
+                    imr::ImageData image{TextureSize, TextureSize, std::vector<uint8_t>(TextureSize * TextureSize * 4)};
+                    for (uint32_t y = 0; y < TextureSize; y++) {
+                        for (uint32_t x = 0; x < TextureSize; x++) {
+                            uint8_t* texel = image.pixels.data() + (y * TextureSize + x) * 4;
+                            texel[0] = static_cast<uint8_t>(x * 4 + t);
+                            texel[1] = static_cast<uint8_t>(y * 4);
+                            texel[2] = static_cast<uint8_t>(t);
+                            texel[3] = 255;
+                        }
+                    }
+                    this->textures.push_back(loadTexture(std::move(image)));
+                }
+            }
+        }
+
+        void drawRects(imr::Renderer& renderer) {
+            for (size_t i = 0; i < this->positions.size(); i++) {
+                renderer.drawRect(this->positions[i], this->sizes[i], this->colors[i]);
+            }
+        }
+
+        void drawPanels(imr::Renderer& renderer) {
+            auto columns = std::max(static_cast<uint32_t>(this->width / PanelWidth), 1u);
+            uint32_t perPanel = ShapeCount / PanelCount;
+            auto frame = static_cast<float>(getFrameCount());
+
+            for (uint32_t panel = 0; panel < PanelCount; panel++) {
+                glm::vec2 origin{static_cast<float>(panel % columns) * PanelWidth, static_cast<float>(panel / columns) * PanelHeight};
+                float scroll = std::fmod(frame * 4.0f + static_cast<float>(panel) * 37.0f, PanelHeight * 3.0f);
+
+                renderer.pushClipRect(origin, {PanelWidth, PanelHeight});
+                for (uint32_t i = panel * perPanel; i < (panel + 1) * perPanel; i++) {
+                    renderer.drawRoundedRect(origin + this->positions[i] - glm::vec2(0.0f, scroll), this->sizes[i], 2.0f, this->colors[i]);
+                }
+                renderer.popClipRect();
+            }
+        }
+
+        void drawPolylines(imr::Renderer& renderer) {
+            imr::StrokeStyle style{1.5f, imr::LineJoin::eBevel, imr::LineCap::eButt};
+            renderer.drawPolyline(this->chart, style, {0.2f, 0.8f, 1.0f, 1.0f});
+        }
+
+        void drawLabels(imr::Renderer& renderer) {
+            constexpr uint32_t Columns = 8;
+            constexpr uint32_t Rows = 90;
+            float columnWidth = this->width / Columns;
+            float rowHeight = this->height / Rows;
+            auto frame = static_cast<uint32_t>(getFrameCount());
+
+            // Formatted into a fixed buffer, the numbers change every frame and every label is a new text run
+            char text[64];
+            for (uint32_t row = 0; row < Rows; row++) {
+                for (uint32_t column = 0; column < Columns; column++) {
+                    uint32_t value = (row * Columns + column) * 7919u + frame * 31u;
+                    int length = std::snprintf(text, sizeof(text), "R%02u %u.%03u ms", row, value % 1000, value % 997);
+
+                    renderer.drawText({static_cast<float>(column) * columnWidth + 2.0f, static_cast<float>(row) * rowHeight},
+                                      std::string_view(text, static_cast<size_t>(length)), rowHeight * 0.9f, {1.0f, 1.0f, 1.0f, 1.0f});
+                }
+            }
+        }
+
+        void drawTextures(imr::Renderer& renderer) {
+            for (size_t i = 0; i < this->positions.size(); i++) {
+                renderer.drawTexturedQuad(this->positions[i], this->sizes[i], this->textures[i % this->textures.size()]);
+            }
+        }
+
+        // Panels of shadows, borders, labels and a bar chart. The static variant wraps every panel in a scope
+        // whose content never changes, so after the first frame everything is replayed and the frames are skipped.
+        void drawDashboard(imr::Renderer& renderer, bool cached) {
+            constexpr uint32_t Columns = 6;
+            constexpr uint32_t Rows = 5;
+            float panelWidth = this->width / Columns;
+            float panelHeight = this->height / Rows;
+            uint64_t frame = cached ? 0 : getFrameCount();
+
+            char text[64];
+            for (uint32_t panel = 0; panel < Columns * Rows; panel++) {
+                if (cached && !renderer.beginScope(panel + 1, 0)) {
+                    renderer.endScope();
+                    continue;
+                }
+
+                glm::vec2 origin{static_cast<float>(panel % Columns) * panelWidth + 8.0f, static_cast<float>(panel / Columns) * panelHeight + 8.0f};
+                glm::vec2 size{panelWidth - 16.0f, panelHeight - 16.0f};
+
+                renderer.drawShadow(origin, size, 6.0f, {0.0f, 3.0f}, 8.0f, {0.0f, 0.0f, 0.0f, 0.5f});
+                renderer.drawRoundedRect(origin, size, 6.0f, {0.12f, 0.13f, 0.16f, 1.0f});
+                renderer.drawBorder(origin, size, 6.0f, 1.0f, {0.3f, 0.32f, 0.38f, 1.0f});
+
+                int length = std::snprintf(text, sizeof(text), "Panel %u: %llu", panel, static_cast<unsigned long long>((frame * 13 + panel) % 1000));
+                renderer.drawText(origin + glm::vec2(8.0f, 6.0f), std::string_view(text, static_cast<size_t>(length)), 14.0f, {0.9f, 0.9f, 0.9f, 1.0f});
+
+                constexpr uint32_t Bars = 16;
+                float barWidth = (size.x - 16.0f) / Bars;
+                for (uint32_t bar = 0; bar < Bars; bar++) {
+                    float value = 0.5f + 0.5f * std::sin(static_cast<float>(frame) * 0.05f + static_cast<float>(panel * Bars + bar) * 0.7f);
+                    float barHeight = value * (size.y - 40.0f);
+                    renderer.drawRect({origin.x + 8.0f + static_cast<float>(bar) * barWidth, origin.y + size.y - 8.0f - barHeight},
+                                      {barWidth - 2.0f, barHeight}, {0.3f, 0.6f + 0.4f * value, 0.9f, 1.0f});
+                }
+
+                if (cached) renderer.endScope();
+            }
+        }
+    };
+
+    imr::AppConfig makeConfig(const SceneInfo& scene, const BenchOptions& options) {
+        imr::AppConfig config;
+        config.headless = true;
+        config.extent = options.extent;
+        config.maxFrames = options.warmupFrames + options.frames;
+        // The layer costs more CPU time than most scenes
+        config.enableValidation = false;
+        config.indirectDraws = !options.directDraws;
+        config.gpuShapeCulling = options.gpuShapeCulling;
+        // Without a warmup there's no steady state to check
+        if (scene.steady) config.allocationFreeAfterFrames = options.warmupFrames;
+
+        if (scene.kind == SceneKind::ePolylines) {
+            // Beveled, a segment takes 5 vertices and 9 indices
+            config.frames.vertexCapacity = 5'200'000;
+            config.frames.indexCapacity = 9'200'000;
+        }
+
+        if (scene.kind == SceneKind::eShapes) {
+            // Culled on the GPU every shape makes it into the upload buffer
+            config.frames.shapeCapacity = 320'000;
+        }
+
+        return config;
+    }
+
+    SceneResult runScene(const SceneInfo& scene, const BenchOptions& options) {
+        std::cerr << "Running " << scene.name << ": " << scene.description << '\n';
+
+        BenchApp app(makeConfig(scene, options), scene.kind, options.warmupFrames);
+        app.run();
+
+        return app.getResult(scene.name);
+    }
+
+    void writeJson(std::ostream& out, const std::vector<SceneResult>& results, const BenchOptions& options) {
+        out << std::setprecision(6) << "{\n"
+            << "  \"version\": 1,\n"
+            << "  \"width\": " << options.extent.width << ",\n"
+            << "  \"height\": " << options.extent.height << ",\n"
+            << "  \"frames\": " << options.frames << ",\n"
+            << "  \"warmup\": " << options.warmupFrames << ",\n"
+            << "  \"direct_draws\": " << (options.directDraws ? 1 : 0) << ",\n"
+            << "  \"gpu_shape_culling\": " << (options.gpuShapeCulling ? 1 : 0) << ",\n"
+            << "  \"scenes\": {";
+
+        for (size_t i = 0; i < results.size(); i++) {
+            const SceneResult& r = results[i];
+            out << (i == 0 ? "\n" : ",\n")
+                << "    \"" << r.name << "\": {\n"
+                << "      \"frames\": " << r.frames << ",\n"
+                << "      \"submitted\": " << r.submitted << ",\n"
+                << "      \"cpu_ms_avg\": " << r.cpuMsAvg << ",\n"
+                << "      \"cpu_ms_p50\": " << r.cpuMsP50 << ",\n"
+                << "      \"cpu_ms_p99\": " << r.cpuMsP99 << ",\n"
+                << "      \"frame_ms_avg\": " << r.frameMsAvg << ",\n"
+                << "      \"gpu_ms_avg\": " << r.gpuMsAvg << ",\n"
+                << "      \"gpu_ms_p99\": " << r.gpuMsP99 << ",\n"
+                << "      \"draw_calls\": " << r.drawCalls << ",\n"
+                << "      \"batches\": " << r.batches << ",\n"
+                << "      \"uploaded_bytes\": " << r.uploadedBytes << ",\n"
+                << "      \"allocations\": " << r.allocations << "\n"
+                << "    }";
+        }
+
+        out << "\n  }\n}\n";
+    }
+
+    // Just enough JSON for the files written above: nested objects of numbers, flattened to "scenes.rects.batches".
+    // Flags are written as 0 or 1 for it.
+    class BaselineReader {
+    public:
+        explicit BaselineReader(std::string_view text) : text(text) {}
+
+        std::optional<std::map<std::string, double>> read() {
+            std::map<std::string, double> values;
+            if (!object("", values)) return std::nullopt;
+            return values;
+        }
+
+    private:
+        std::string_view text;
+        size_t position = 0;
+
+        void skip() {
+            while (this->position < this->text.size() && std::isspace(static_cast<unsigned char>(this->text[this->position]))) this->position++;
+        }
+
+        bool consume(char c) {
+            skip();
+            if (this->position >= this->text.size() || this->text[this->position] != c) return false;
+            this->position++;
+            return true;
+        }
+
+        std::optional<std::string> string() {
+            if (!consume('"')) return std::nullopt;
+
+            size_t end = this->text.find('"', this->position);
+            if (end == std::string_view::npos) return std::nullopt;
+
+            std::string value(this->text.substr(this->position, end - this->position));
+            this->position = end + 1;
+            return value;
+        }
+
+        bool object(const std::string& prefix, std::map<std::string, double>& values) {
+            if (!consume('{')) return false;
+            if (consume('}')) return true;
+
+            do {
+                auto key = string();
+                if (!key || !consume(':')) return false;
+
+                std::string path = prefix.empty() ? *key : prefix + "." + *key;
+                skip();
+
+                if (this->position < this->text.size() && this->text[this->position] == '{') {
+                    if (!object(path, values)) return false;
+                } else {
+                    double value = 0.0;
+                    auto [end, error] = std::from_chars(this->text.data() + this->position, this->text.data() + this->text.size(), value);
+                    if (error != std::errc()) return false;
+
+                    this->position = static_cast<size_t>(end - this->text.data());
+                    values[path] = value;
+                }
+            } while (consume(','));
+
+            return consume('}');
+        }
+    };
+
+    // Lower is better for all of them. Timings get the tolerance, the counters are deterministic and only get
+    // a little slack for the allocations of worker threads that land in a frame or the next.
+    struct MetricCheck {
+        const char* name;
+        bool timing;
+    };
+
+    constexpr std::array<MetricCheck, 9> CheckedMetrics = {{
+            {"cpu_ms_avg", true},
+            {"cpu_ms_p50", true},
+            {"cpu_ms_p99", true},
+            {"frame_ms_avg", true},
+            {"gpu_ms_avg", true},
+            {"draw_calls", false},
+            {"batches", false},
+            {"uploaded_bytes", false},
+            {"allocations", false}
+    }};
+
+    // Results only compare when the runs were set up the same way
+    constexpr std::array<const char*, 6> RunSettings = {"width", "height", "frames", "warmup", "direct_draws", "gpu_shape_culling"};
+
+    bool checkSettings(const std::map<std::string, double>& baseline, const std::map<std::string, double>& current) {
+        bool matching = true;
+
+        for (const char* setting : RunSettings) {
+            auto base = baseline.find(setting);
+            auto now = current.find(setting);
+            if (base != baseline.end() && now != current.end() && base->second == now->second) continue;
+
+            std::cerr << "Baseline " << setting << " is ";
+            if (base != baseline.end()) std::cerr << base->second;
+            else std::cerr << "missing";
+            std::cerr << ", current run has ";
+            if (now != current.end()) std::cerr << now->second;
+            else std::cerr << "none";
+            std::cerr << '\n';
+            matching = false;
+        }
+
+        return matching;
+    }
+
+    // Returns the number of regressions
+    uint32_t compare(const std::map<std::string, double>& baseline, const std::map<std::string, double>& current, double tolerance) {
+        uint32_t regressions = 0;
+
+        std::cerr << std::left << std::setw(12) << "scene" << std::setw(16) << "metric" << std::right
+                  << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "change" << '\n';
+
+        for (const auto& scene : Scenes) {
+            for (const auto& metric : CheckedMetrics) {
+                std::string key = std::string("scenes.") + scene.name + "." + metric.name;
+                auto base = baseline.find(key);
+                auto now = current.find(key);
+                if (base == baseline.end() || now == current.end()) continue;
+
+                double allowed = metric.timing ? base->second * (1.0 + tolerance) : base->second * 1.01 + 0.5;
+                bool regressed = now->second > allowed;
+                double change = base->second != 0.0 ? (now->second - base->second) / base->second * 100.0 : 0.0;
+
+                std::cerr << std::left << std::setw(12) << scene.name << std::setw(16) << metric.name << std::right << std::fixed
+                          << std::setprecision(3) << std::setw(14) << base->second << std::setw(14) << now->second
+                          << std::setprecision(1) << std::setw(9) << change << '%' << (regressed ? "  REGRESSION" : "") << '\n';
+
+                if (regressed) regressions++;
+            }
+        }
+
+        return regressions;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::vector<std::string_view> selected;
+    std::string outputPath;
+    std::string baselinePath;
+    double tolerance = 0.10;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--scene" && i + 1 < argc) {
+            selected.emplace_back(argv[++i]);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            options.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            options.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--width" && i + 1 < argc) {
+            options.extent.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--height" && i + 1 < argc) {
+            options.extent.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--compare" && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::stod(argv[++i]);
+        } else if (arg == "--direct-draws") {
+            options.directDraws = true;
+        } else if (arg == "--gpu-shape-culling") {
+            options.gpuShapeCulling = true;
+        } else if (arg == "--list") {
+            for (const auto& scene : Scenes) std::cout << scene.name << ": " << scene.description << '\n';
+            return 0;
+        } else {
+            std::cerr << "Unknown argument " << arg << '\n'
+                      << "Usage: imr_bench [--scene name]... [--frames n] [--warmup n] [--width n] [--height n]\n"
+                      << "                 [--direct-draws] [--gpu-shape-culling]\n"
+                      << "                 [--output file.json] [--compare baseline.json] [--tolerance 0.1] [--list]\n";
+            return 2;
+        }
+    }
+
+    std::vector<SceneResult> results;
+    for (const auto& scene : Scenes) {
+        if (!selected.empty() && std::ranges::find(selected, std::string_view(scene.name)) == selected.end()) continue;
+
+        try {
+            results.push_back(runScene(scene, options));
+        } catch (const std::exception& e) {
+            std::cerr << scene.name << " failed: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    std::ostringstream json;
+    writeJson(json, results, options);
+
+    if (outputPath.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream file{outputPath, std::ios::trunc};
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << outputPath << '\n';
+            return 2;
+        }
+        file << json.str();
+    }
+
+    if (baselinePath.empty()) return 0;
+
+    std::ifstream baselineFile{baselinePath};
+    std::string baselineText{std::istreambuf_iterator<char>(baselineFile), std::istreambuf_iterator<char>()};
+
+    auto baseline = BaselineReader(baselineText).read();
+    auto current = BaselineReader(json.str()).read();
+    if (!baselineFile.is_open() || !baseline || !current) {
+        std::cerr << "Failed to read baseline " << baselinePath << '\n';
+        return 2;
+    }
+
+    if (!checkSettings(*baseline, *current)) {
+        std::cerr << "Not comparing against " << baselinePath << ", it was recorded with different settings\n";
+        return 2;
+    }
+
+    uint32_t regressions = compare(*baseline, *current, tolerance);
+    std::cerr << regressions << (regressions == 1 ? " regression" : " regressions") << " against " << baselinePath << '\n';
+
+    return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "job_system.hpp"
+#include "renderer.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+
+// Frames of a Renderer drawing large charts, with the chunked tessellation spread over 1 to N threads
+
+namespace {
+
+    // Random walks, one per chart
+    std::vector<std::vector<glm::vec2>> makeCharts(uint32_t chartCount, uint32_t pointCount) {
+        std::vector<std::vector<glm::vec2>> charts(chartCount);
+
+        uint32_t state = 0x12345678u;
+        for (uint32_t c = 0; c < chartCount; c++) {
+            auto& points = charts[c];
+            points.resize(pointCount);
+
+            float y = 0.0f;
+            for (uint32_t i = 0; i < pointCount; i++) {
+                state = state * 1664525u + 1013904223u;
+                y += (static_cast<float>(state >> 8) / static_cast<float>(1u << 24) - 0.5f) * 4.0f;
+                points[i] = {static_cast<float>(i) * 2000.0f / static_cast<float>(pointCount), 100.0f + 150.0f * static_cast<float>(c) + y};
+            }
+        }
+
+        return charts;
+    }
+
+    // Milliseconds per frame
+    double measure(imr::JobSystem* jobSystem, const std::vector<std::vector<glm::vec2>>& charts, uint32_t frames, size_t& vertices) {
+        imr::Renderer renderer;
+        renderer.setJobSystem(jobSystem);
+
+        imr::StrokeStyle style{2.0f, imr::LineJoin::eMiter, imr::LineCap::eButt};
+        auto drawFrame = [&] {
+            // Nothing is clipped, the single thread run would cull less than the chunks and skew the comparison
+            renderer.begin();
+            for (const auto& chart : charts) renderer.drawPolyline(chart, style, {1.0f, 1.0f, 1.0f, 1.0f});
+            renderer.end();
+        };
+
+        // Grows the renderer's storage to its steady state size
+        drawFrame();
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < frames; frame++) drawFrame();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        vertices = renderer.getVertices().size();
+        return seconds * 1000.0 / frames;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    uint32_t chartCount = 4;
+    uint32_t pointCount = 1'000'000;
+    uint32_t frames = 20;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--threads" && i + 1 < argc) {
+            maxThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--charts" && i + 1 < argc) {
+            chartCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--points" && i + 1 < argc) {
+            pointCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+    }
+
+    auto charts = makeCharts(chartCount, pointCount);
+
+    std::cout << chartCount << " charts of " << pointCount << " points, " << frames << " frames, SIMD path: "
+              << imr::Tessellator::getSimdName() << '\n'
+              << std::setw(8) << "threads" << std::setw(14) << "ms/frame" << std::setw(12) << "speedup"
+              << std::setw(14) << "efficiency" << std::setw(14) << "vertices" << '\n';
+
+    // 1 to 4, then doubling, always ending on the full count
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < maxThreads; threads = threads < 4 ? threads + 1 : threads * 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double baseline = 0.0;
+    for (uint32_t threads : threadCounts) {
+        // Without a system the renderer stays on this thread, the baseline the others are compared to
+        std::unique_ptr<imr::JobSystem> jobSystem;
+        if (threads > 1) jobSystem = std::make_unique<imr::JobSystem>(threads);
+
+        size_t vertices = 0;
+        double milliseconds = measure(jobSystem.get(), charts, frames, vertices);
+        if (threads == 1) baseline = milliseconds;
+
+        std::cout << std::fixed << std::setw(8) << threads
+                  << std::setw(14) << std::setprecision(2) << milliseconds
+                  << std::setw(11) << baseline / milliseconds << 'x'
+                  << std::setw(13) << std::setprecision(0) << 100.0 * baseline / milliseconds / threads << '%'
+                  << std::setw(14) << vertices << '\n';
+    }
+
+    return 0;
+}
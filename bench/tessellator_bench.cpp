@@ -0,0 +1,144 @@
+#include "tessellator.hpp"
+#include "renderer.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+
+// Strokes and fills the same geometry with the scalar and the SIMD path on one thread, so the rates are per core
+
+namespace {
+
+    struct Result {
+        double verticesPerSecond;
+        double indicesPerSecond;
+        // Keeps the output alive for the optimizer
+        uint64_t checksum;
+    };
+
+    // A chart: a random walk sampled once per x step
+    std::vector<glm::vec2> makeChart(uint32_t pointCount) {
+        std::vector<glm::vec2> points(pointCount);
+
+        uint32_t state = 0x12345678u;
+        float y = 0.0f;
+        for (uint32_t i = 0; i < pointCount; i++) {
+            state = state * 1664525u + 1013904223u;
+            y += (static_cast<float>(state >> 8) / static_cast<float>(1u << 24) - 0.5f) * 4.0f;
+            points[i] = {static_cast<float>(i) * 0.5f, 300.0f + y + 50.0f * std::sin(static_cast<float>(i) * 0.01f)};
+        }
+
+        return points;
+    }
+
+    // Concave outline with every other point pulled in
+    std::vector<glm::vec2> makeStar(uint32_t pointCount) {
+        std::vector<glm::vec2> points(pointCount);
+
+        for (uint32_t i = 0; i < pointCount; i++) {
+            float angle = static_cast<float>(i) / static_cast<float>(pointCount) * 6.2831853f;
+            float radius = i % 2 == 0 ? 200.0f : 120.0f;
+            points[i] = {400.0f + radius * std::cos(angle), 300.0f + radius * std::sin(angle)};
+        }
+
+        return points;
+    }
+
+    template<typename F>
+    Result measure(uint32_t iterations, F&& tessellate) {
+        uint64_t vertices = 0, indices = 0;
+        uint64_t checksum = 0;
+
+        // Faults the output in and fills the scratch memory, neither is part of the steady state
+        tessellate();
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            imr::TessellationCount count = tessellate();
+            vertices += count.vertices;
+            indices += count.indices;
+            checksum += count.vertices;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        return {static_cast<double>(vertices) / seconds, static_cast<double>(indices) / seconds, checksum};
+    }
+
+    void report(std::string_view name, const Result& scalar, const Result& simd) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << scalar.verticesPerSecond / 1e6
+                  << std::setw(12) << simd.verticesPerSecond / 1e6
+                  << std::setw(10) << std::setprecision(2) << simd.verticesPerSecond / scalar.verticesPerSecond << "x\n";
+    }
+
+}
+
+int main(int argc, char** argv) {
+    uint32_t pointCount = 1'000'000;
+    uint32_t iterations = 20;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--points" && i + 1 < argc) {
+            pointCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+    }
+
+    std::vector<glm::vec2> chart = makeChart(pointCount);
+    // Ear clipping is quadratic, a UI sized outline
+    std::vector<glm::vec2> star = makeStar(512);
+
+    imr::StrokeStyle styles[] = {
+            {2.0f, imr::LineJoin::eBevel, imr::LineCap::eButt},
+            {2.0f, imr::LineJoin::eMiter, imr::LineCap::eSquare},
+            {8.0f, imr::LineJoin::eRound, imr::LineCap::eRound}
+    };
+    const char* styleNames[] = {"stroke bevel 2px", "stroke miter 2px", "stroke round 8px"};
+
+    // Sized for the largest output, written like the frame's upload buffer would be
+    imr::TessellationCount capacity{0, 0};
+    for (const auto& style : styles) {
+        imr::TessellationCount bound = imr::Tessellator::getStrokeBound(pointCount, style);
+        capacity = {std::max(capacity.vertices, bound.vertices), std::max(capacity.indices, bound.indices)};
+    }
+    std::vector<imr::Vertex> vertices(std::max(capacity.vertices, imr::Tessellator::getFillBound(512).vertices));
+    std::vector<uint32_t> indices(std::max(capacity.indices, imr::Tessellator::getFillBound(512).indices));
+    imr::TessellationTarget target{vertices.data(), indices.data(), 0, imr::packUnorm8x4({1.0f, 1.0f, 1.0f, 1.0f})};
+
+    imr::Tessellator scalar(false);
+    imr::Tessellator simd(true);
+
+    std::cout << pointCount << " points, " << iterations << " iterations, SIMD path: " << imr::Tessellator::getSimdName() << '\n'
+              << std::left << std::setw(24) << "Mvertices/s per core" << std::right
+              << std::setw(12) << "scalar" << std::setw(12) << "simd" << std::setw(11) << "speedup" << '\n';
+
+    uint64_t checksum = 0;
+    for (size_t s = 0; s < std::size(styles); s++) {
+        const auto& style = styles[s];
+
+        Result scalarResult = measure(iterations, [&] { return scalar.stroke(chart, style, target); });
+        Result simdResult = measure(iterations, [&] { return simd.stroke(chart, style, target); });
+        report(styleNames[s], scalarResult, simdResult);
+
+        checksum += scalarResult.checksum + simdResult.checksum + indices[indices.size() / 2];
+    }
+
+    // Small enough to need more rounds for a stable rate
+    Result scalarFill = measure(iterations * 100, [&] { return scalar.fill(star, target); });
+    Result simdFill = measure(iterations * 100, [&] { return simd.fill(star, target); });
+    report("fill concave 512", scalarFill, simdFill);
+    checksum += scalarFill.checksum + simdFill.checksum;
+
+    std::cout << "checksum " << checksum << '\n';
+
+    return 0;
+}
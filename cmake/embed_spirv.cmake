@@ -0,0 +1,56 @@
+# Writes compiled SPIR-V files into a header of constexpr arrays, run with
+# cmake -DOUTPUT=<header> -DSPIRV_FILES=<a.spv|b.spv|...> -P embed_spirv.cmake
+
+string(REPLACE "|" ";" SPIRV_FILES "${SPIRV_FILES}")
+
+# CMake regexes have no {n}, spell out eight words for the line breaks
+string(REPEAT "0x[0-9a-f]+u, " 8 EIGHT_WORDS)
+
+set(ARRAYS "")
+set(TABLE "")
+
+foreach(SPIRV_FILE ${SPIRV_FILES})
+    get_filename_component(FILE_NAME ${SPIRV_FILE} NAME)
+    string(REGEX REPLACE "\\.spv$" "" SHADER_NAME ${FILE_NAME})
+    string(MAKE_C_IDENTIFIER ${SHADER_NAME} IDENTIFIER)
+
+    # SPIR-V is a stream of little endian words, reorder each 4 byte group into one literal
+    file(READ ${SPIRV_FILE} HEX HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1u, " WORDS "${HEX}")
+    string(REGEX REPLACE "(${EIGHT_WORDS})" "\\1\n            " WORDS "${WORDS}")
+
+    string(APPEND ARRAYS "        inline constexpr uint32_t ${IDENTIFIER}[] = {\n            ${WORDS}\n        };\n\n")
+    string(APPEND TABLE "            EmbeddedShader{\"${SHADER_NAME}\", ${IDENTIFIER}},\n")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+"// Generated by cmake/embed_spirv.cmake, do not edit
+#ifndef VK_IMM_RENDERER_EMBEDDED_SHADERS_HPP
+#define VK_IMM_RENDERER_EMBEDDED_SHADERS_HPP
+
+#include <span>
+#include <cstdint>
+#include <string_view>
+
+namespace imr {
+
+    struct EmbeddedShader {
+        std::string_view name;
+        std::span<const uint32_t> code;
+    };
+
+    namespace embedded {
+
+${ARRAYS}        inline constexpr EmbeddedShader shaders[] = {
+${TABLE}        };
+
+    } // embedded
+
+} // imr
+
+#endif //VK_IMM_RENDERER_EMBEDDED_SHADERS_HPP
+")
+
+# Only touch the header when it changed so dependents aren't rebuilt for nothing
+file(COPY_FILE ${OUTPUT}.tmp ${OUTPUT} ONLY_IF_DIFFERENT)
+file(REMOVE ${OUTPUT}.tmp)
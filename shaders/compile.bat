@@ -1,3 +0,0 @@
-C:/VulkanSDK/1.3.216.0/Bin/glslc.exe simple_shader.vert -o simple_shader.vert.spv
-C:/VulkanSDK/1.3.216.0/Bin/glslc.exe simple_shader.frag -o simple_shader.frag.spv
-pause
\ No newline at end of file
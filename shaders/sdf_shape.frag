@@ -0,0 +1,31 @@
+#version 450
+
+layout (location = 0) in vec2 fragLocal;
+layout (location = 1) flat in vec2 fragHalfSize;
+layout (location = 2) flat in vec4 fragCornerRadii;
+layout (location = 3) flat in vec4 fragFillColor;
+layout (location = 4) flat in vec4 fragBorderColor;
+layout (location = 5) flat in vec2 fragBorderSoftness;
+
+layout (location = 0) out vec4 outColor;
+
+// Radii are (bottom right, top right, bottom left, top left) with y pointing down
+float sdRoundBox(in vec2 p, in vec2 b, in vec4 r)
+{
+    r.xy = (p.x > 0.0) ? r.xy : r.zw;
+    r.x  = (p.y > 0.0) ? r.x  : r.y;
+    vec2 q = abs(p) - b + r.x;
+    return min(max(q.x, q.y), 0.0) + length(max(q, 0.0)) - r.x;
+}
+
+void main(){
+    float d = sdRoundBox(fragLocal, fragHalfSize, fragCornerRadii);
+
+    // A softness of 0 still gets about a pixel of antialiasing, larger values blur shadows and glows
+    float edge = max(fragBorderSoftness.y, fwidth(d));
+    float outer = 1.0 - smoothstep(-0.5 * edge, 0.5 * edge, d);
+    float inner = 1.0 - smoothstep(-0.5 * edge, 0.5 * edge, d + fragBorderSoftness.x);
+
+    vec4 color = fragBorderSoftness.x > 0.0 ? mix(fragBorderColor, fragFillColor, inner) : fragFillColor;
+    outColor = vec4(color.rgb, color.a * outer);
+}
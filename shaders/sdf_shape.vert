@@ -0,0 +1,40 @@
+#version 450
+
+// One ShapeInstance per instance, the quad corners come from gl_VertexIndex
+layout (location = 0) in vec2 inCenter;
+layout (location = 1) in vec2 inHalfSize;
+layout (location = 2) in vec4 inCornerRadii;
+layout (location = 3) in vec4 inFillColor;
+layout (location = 4) in vec4 inBorderColor;
+layout (location = 5) in vec2 inBorderSoftness;
+
+layout (location = 0) out vec2 fragLocal;
+layout (location = 1) flat out vec2 fragHalfSize;
+layout (location = 2) flat out vec4 fragCornerRadii;
+layout (location = 3) flat out vec4 fragFillColor;
+layout (location = 4) flat out vec4 fragBorderColor;
+layout (location = 5) flat out vec2 fragBorderSoftness;
+
+layout (push_constant) uniform Push {
+    vec2 screenSize;
+} push;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(-1.0, 1.0), vec2(-1.0, -1.0)
+);
+
+void main(){
+    // Grown by the softness and a pixel of antialiasing so the falloff isn't clipped by the quad
+    vec2 extent = inHalfSize + inBorderSoftness.y + 1.0;
+    vec2 local = corners[gl_VertexIndex] * extent;
+
+    gl_Position = vec4((inCenter + local) / push.screenSize * 2.0 - 1.0, 0.0, 1.0);
+
+    fragLocal = local;
+    fragHalfSize = inHalfSize;
+    fragCornerRadii = inCornerRadii;
+    fragFillColor = inFillColor;
+    fragBorderColor = inBorderColor;
+    fragBorderSoftness = inBorderSoftness;
+}
@@ -1,9 +1,12 @@
 #version 450
 
+layout (location = 0) in vec4 fragColor;
+layout (location = 1) in vec2 fragUv;
+
 layout (location = 0) out vec4 outColor;
 
 void main(){
-    outColor = vec4(0.0, 0.0, 1.0, 1.0);
+    outColor = fragColor;
 }
 
 /*
@@ -1,11 +1,22 @@
 #version 450
 
-vec2 positions[3] = vec2[] (
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+layout (location = 0) in vec2 inPosition;
+layout (location = 1) in vec2 inUv;
+layout (location = 2) in vec4 inColor;
+layout (location = 3) in uint inTexture;
+
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec2 fragUv;
+layout (location = 2) flat out uint fragTexture;
+
+layout (push_constant) uniform Push {
+    vec2 screenSize;
+} push;
 
 void main(){
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    // Pixel coordinates with the origin in the top left corner
+    gl_Position = vec4(inPosition / push.screenSize * 2.0 - 1.0, 0.0, 1.0);
+    fragColor = inColor;
+    fragUv = inUv;
+    fragTexture = inTexture;
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec4 fragColor;
+layout (location = 1) in vec2 fragUv;
+layout (location = 2) flat in uint fragTexture;
+
+layout (location = 0) out vec4 outColor;
+
+layout (set = 0, binding = 0) uniform sampler2D textures[];
+
+void main(){
+    float coverage = texture(textures[nonuniformEXT(fragTexture)], fragUv).r;
+    outColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
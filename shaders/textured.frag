@@ -0,0 +1,15 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec4 fragColor;
+layout (location = 1) in vec2 fragUv;
+layout (location = 2) flat in uint fragTexture;
+
+layout (location = 0) out vec4 outColor;
+
+// Bindless table, a batch can sample a different texture with every quad
+layout (set = 0, binding = 0) uniform sampler2D textures[];
+
+void main(){
+    outColor = fragColor * texture(textures[nonuniformEXT(fragTexture)], fragUv);
+}
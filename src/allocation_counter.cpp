@@ -0,0 +1,40 @@
+#include "allocation_counter.hpp"
+
+#ifdef IMR_TRACK_ALLOCATIONS
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#endif
+
+namespace imr {
+
+#ifdef IMR_TRACK_ALLOCATIONS
+    static std::atomic<uint64_t> allocationCount{0};
+
+    uint64_t getAllocationCount() {
+        return allocationCount.load(std::memory_order_relaxed);
+    }
+#else
+    uint64_t getAllocationCount() {
+        return 0;
+    }
+#endif
+
+} // imr
+
+#ifdef IMR_TRACK_ALLOCATIONS
+// The array and nothrow forms forward to this one
+void* operator new(std::size_t size) {
+    imr::allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size != 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#endif
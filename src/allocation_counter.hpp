@@ -0,0 +1,23 @@
+#ifndef VK_IMM_RENDERER_ALLOCATION_COUNTER_HPP
+#define VK_IMM_RENDERER_ALLOCATION_COUNTER_HPP
+
+#include <cstdint>
+
+namespace imr {
+
+    // Builds with IMR_TRACK_ALLOCATIONS replace the global operator new to count every heap allocation of the
+    // process, on any thread. Over-aligned allocations aren't counted. Without it nothing is replaced.
+    [[nodiscard]] constexpr bool isAllocationCountingEnabled() {
+#ifdef IMR_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Since the start of the process, 0 if counting isn't compiled in
+    [[nodiscard]] uint64_t getAllocationCount();
+
+} // imr
+
+#endif //VK_IMM_RENDERER_ALLOCATION_COUNTER_HPP
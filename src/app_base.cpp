@@ -1,9 +1,12 @@
 #include "app_base.hpp"
 
+#include <array>
 #include <iostream>
 #include <ranges>
 #include <unordered_set>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 
 namespace imr {
 
@@ -26,35 +29,60 @@ namespace imr {
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
         glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
-        this->window = glfwCreateWindow(640, 480, "Window", nullptr, nullptr);
+        this->window = glfwCreateWindow(static_cast<int>(this->config.extent.width), static_cast<int>(this->config.extent.height), "Window", nullptr, nullptr);
         if (!this->window) throw std::runtime_error("Failed to create window");
+
+        // Resizes are picked up before the next frame, presenting alone doesn't report them on every platform
+        glfwSetWindowUserPointer(this->window, this);
+        glfwSetFramebufferSizeCallback(this->window, [](GLFWwindow* window, int, int) {
+            static_cast<AppBase*>(glfwGetWindowUserPointer(window))->swapchainOutOfDate = true;
+        });
     }
 
-    std::vector<const char *> AppBase::getGlfwRequiredExtensions() {
-        uint32_t glfwExtensionCount = 0;
-        const char **glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char *> AppBase::getRequiredInstanceExtensions() {
+        std::vector<const char *> extensions;
+
+        if (!this->config.headless) {
+            uint32_t glfwExtensionCount = 0;
+            const char **glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-        std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
-        //if (enableValidationLayers) {
-        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-        //}
+        if (!this->enabledLayers.empty()) {
+            extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        }
 
         return extensions;
     }
 
     bool AppBase::isDeviceSuitable(vk::raii::PhysicalDevice &physicalDev, vk::raii::SurfaceKHR &surf) {
         // Supported Queues check
-        bool hasGraphicsQueue = false, hasPresentQueue = false;
+        bool hasGraphicsQueue = false, hasPresentQueue = this->config.headless;
         auto queueFamilies = physicalDev.getQueueFamilyProperties();
         for (int i = 0; i < queueFamilies.size(); i++) {
             hasGraphicsQueue = hasGraphicsQueue || (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics);
-            hasPresentQueue = hasPresentQueue || (queueFamilies[i].queueCount > 0 && physicalDev.getSurfaceSupportKHR(i, *surf));
+            if (!this->config.headless)
+                hasPresentQueue = hasPresentQueue || (queueFamilies[i].queueCount > 0 && physicalDev.getSurfaceSupportKHR(i, *surf));
         }
 
         if (!hasGraphicsQueue || !hasPresentQueue) return false;
 
+        // The bindless texture table needs descriptor indexing, core since 1.2
+        if (physicalDev.getProperties().apiVersion < VK_API_VERSION_1_2) return false;
+
+        auto features = physicalDev.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        const auto& vulkan12Features = features.get<vk::PhysicalDeviceVulkan12Features>();
+        if (!vulkan12Features.runtimeDescriptorArray || !vulkan12Features.descriptorBindingPartiallyBound ||
+            !vulkan12Features.descriptorBindingSampledImageUpdateAfterBind || !vulkan12Features.descriptorBindingUpdateUnusedWhilePending ||
+            !vulkan12Features.shaderSampledImageArrayNonUniformIndexing || !vulkan12Features.timelineSemaphore) {
+            return false;
+        }
+
+        // Offscreen rendering needs no extensions and no surface
+        if (this->config.headless) return true;
+
         // Extensions check
         auto supportedExtensions = physicalDev.enumerateDeviceExtensionProperties();
         std::unordered_set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
@@ -69,25 +97,34 @@ namespace imr {
         auto supportedSurfaceFormats = physicalDev.getSurfaceFormatsKHR(*surface);
         auto supportedPresentModes = physicalDev.getSurfacePresentModesKHR(*surface);
 
-        if (supportedSurfaceFormats.empty() || supportedPresentModes.empty()) return false;
-
-        // Features check
-        vk::PhysicalDeviceFeatures supportedFeatures = physicalDev.getFeatures();
-
-        return supportedFeatures.samplerAnisotropy;
+        return !supportedSurfaceFormats.empty() && !supportedPresentModes.empty();
     }
 
     void AppBase::initVulkan() {
         // Vulkan Instance creation
+        StageTimer stage(this->startupProfiler, "Instance");
+
         vk::ApplicationInfo appInfo {
                 "Vulkan Immediate Renderer",
                 VK_MAKE_VERSION(1, 0, 0),
                 "No Engine",
                 VK_MAKE_VERSION(0, 0, 0),
-                VK_API_VERSION_1_0
+                VK_API_VERSION_1_2
         };
 
-        auto extensions = getGlfwRequiredExtensions();
+        // Software implementations in CI usually come without the validation layer
+        if (this->config.enableValidation) {
+            auto availableLayers = this->context.enumerateInstanceLayerProperties();
+
+            for (const char* layer : validationLayers) {
+                bool found = std::ranges::any_of(availableLayers, [layer](const auto& props){ return std::string_view(props.layerName) == layer; });
+
+                if (found) this->enabledLayers.push_back(layer);
+                else std::cerr << "Validation layer " << layer << " is not available\n";
+            }
+        }
+
+        auto extensions = getRequiredInstanceExtensions();
 
         vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo;
         debugCreateInfo.messageSeverity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning | vk::DebugUtilsMessageSeverityFlagBitsEXT::eError;
@@ -98,21 +135,27 @@ namespace imr {
         vk::InstanceCreateInfo createInfo {
                 {},
                 &appInfo,
-                validationLayers,
+                this->enabledLayers,
                 extensions,
-                &debugCreateInfo
+                this->enabledLayers.empty() ? nullptr : &debugCreateInfo
         };
 
         this->instance = context.createInstance(createInfo);
 
         // Surface creation
-        VkSurfaceKHR tmpSurface;
-        if(glfwCreateWindowSurface(*this->instance, this->window, nullptr, &tmpSurface) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create window surface");
+        stage.next("Surface");
+
+        if (!this->config.headless) {
+            VkSurfaceKHR tmpSurface;
+            if(glfwCreateWindowSurface(*this->instance, this->window, nullptr, &tmpSurface) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create window surface");
+            }
+            this->surface = vk::raii::SurfaceKHR(this->instance, tmpSurface);
         }
-        this->surface = vk::raii::SurfaceKHR(this->instance, tmpSurface);
 
         // Pick PhysicalDevice
+        stage.next("PhysicalDevice");
+
         auto physicalDevices = instance.enumeratePhysicalDevices();
         if (physicalDevices.empty()) throw std::runtime_error("Failed to find GPUs with Vulkan support!");
 
@@ -133,6 +176,8 @@ namespace imr {
         std::cout << "Physical Device: " << this->physicalDevice.getProperties().deviceName << '\n';
 
         // Logical Device creation
+        stage.next("Device");
+
         bool foundGraphicsQueue = false, foundPresentQueue = false;
         uint32_t graphicsQueueFamilyIndex = 0, presentQueueFamilyIndex = 0;
         auto queueFamilies = this->physicalDevice.getQueueFamilyProperties();
@@ -142,7 +187,7 @@ namespace imr {
                 foundGraphicsQueue = true;
             }
 
-            if (!foundPresentQueue && (queueFamilies[i].queueCount > 0 && this->physicalDevice.getSurfaceSupportKHR(i, *this->surface))) {
+            if (!foundPresentQueue && !this->config.headless && (queueFamilies[i].queueCount > 0 && this->physicalDevice.getSurfaceSupportKHR(i, *this->surface))) {
                 presentQueueFamilyIndex = i;
                 foundPresentQueue = true;
             }
@@ -150,6 +195,18 @@ namespace imr {
             if (foundPresentQueue && foundGraphicsQueue) break;
         }
 
+        if (this->config.headless) presentQueueFamilyIndex = graphicsQueueFamilyIndex;
+
+        // A transfer only family is usually backed by a copy engine, uploads then run alongside rendering
+        uint32_t transferQueueFamilyIndex = graphicsQueueFamilyIndex;
+        for (int i = 0; i < queueFamilies.size(); i++) {
+            if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & vk::QueueFlagBits::eTransfer &&
+                !(queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics)) {
+                transferQueueFamilyIndex = i;
+                break;
+            }
+        }
+
         std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
 
         float queuePriority = 1.0f;
@@ -159,96 +216,106 @@ namespace imr {
             queueCreateInfos.push_back({{}, presentQueueFamilyIndex, 1, &queuePriority});
         }
 
+        if (transferQueueFamilyIndex != graphicsQueueFamilyIndex && transferQueueFamilyIndex != presentQueueFamilyIndex) {
+            queueCreateInfos.push_back({{}, transferQueueFamilyIndex, 1, &queuePriority});
+        }
+
+        vk::PhysicalDeviceFeatures supportedFeatures = this->physicalDevice.getFeatures();
         vk::PhysicalDeviceFeatures deviceFeatures {};
-        deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+        // Optional, recordBatches works around either one missing
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+        this->drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        this->maxDrawIndirectCount = supportedFeatures.multiDrawIndirect ? this->physicalDevice.getProperties().limits.maxDrawIndirectCount : 1;
+
+        vk::PhysicalDeviceVulkan12Features vulkan12Features {};
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        // Texture uploads signal one, see TextureStreamer
+        vulkan12Features.timelineSemaphore = VK_TRUE;
+
+        if (!this->config.headless) this->enabledDeviceExtensions = deviceExtensions;
 
         vk::DeviceCreateInfo deviceCreateInfo {
             {},
             queueCreateInfos,
-            validationLayers,
-            deviceExtensions,
-            &deviceFeatures
+            this->enabledLayers,
+            this->enabledDeviceExtensions,
+            &deviceFeatures,
+            &vulkan12Features
         };
 
         this->device = this->physicalDevice.createDevice(deviceCreateInfo);
 
-        // Command Pool creation
-        vk::CommandPoolCreateInfo cmdPoolCreateInfo {
-                vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-                graphicsQueueFamilyIndex
-        };
+        this->graphicsQueue = this->device.getQueue(graphicsQueueFamilyIndex, 0);
+        this->presentQueue = this->device.getQueue(presentQueueFamilyIndex, 0);
+        this->transferQueue = this->device.getQueue(transferQueueFamilyIndex, 0);
 
-        this->commandPool = this->device.createCommandPool(cmdPoolCreateInfo);
+        this->memoryAllocator = DeviceMemoryAllocator(this->device, this->physicalDevice);
 
-        // Swapchain creation
-        auto surfaceCapabilities = this->physicalDevice.getSurfaceCapabilitiesKHR(*this->surface);
-        auto surfaceFormats = this->physicalDevice.getSurfaceFormatsKHR(*this->surface);
-        auto presentModes = this->physicalDevice.getSurfacePresentModesKHR(*this->surface);
+        // Surface format
+        stage.next("SurfaceFormat");
 
-        vk::SurfaceFormatKHR surfaceFormat = [&]{
-            for (const auto& f : surfaceFormats) {
-                if (f.format == vk::Format::eB8G8R8A8Srgb &&
-                    f.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+        vk::Format colorFormat = OffscreenTarget::ColorFormat;
+        vk::SurfaceFormatKHR surfaceFormat;
 
-                    return f;
+        if (!this->config.headless) {
+            auto surfaceFormats = this->physicalDevice.getSurfaceFormatsKHR(*this->surface);
+
+            surfaceFormat = [&]{
+                for (const auto& f : surfaceFormats) {
+                    if (f.format == vk::Format::eB8G8R8A8Srgb &&
+                        f.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+
+                        return f;
+                    }
                 }
-            }
-            throw std::runtime_error("Couldn't find appropriate surface format");
-        }();
+                throw std::runtime_error("Couldn't find appropriate surface format");
+            }();
 
-        vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo; // TODO
-        vk::Extent2D surfaceExtent = vk::Extent2D{640, 480}; //this->windowExtent; // TODO set window extent
+            colorFormat = surfaceFormat.format;
+        }
 
-        uint32_t imageCount = 2; // TODO
-        std::vector<uint32_t> queueFamilyIndices = {graphicsQueueFamilyIndex, presentQueueFamilyIndex};
+        // Swapchain creation, depth buffers and framebuffers come from the frame graph
+        stage.next("Swapchain");
 
-        vk::SwapchainCreateInfoKHR swapchainCreateInfo {
-                {},
-                *this->surface,
-                imageCount,
-                surfaceFormat.format,
-                surfaceFormat.colorSpace,
-                surfaceExtent,
-                1,
-                vk::ImageUsageFlagBits::eColorAttachment,
-                (graphicsQueueFamilyIndex != presentQueueFamilyIndex) ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
-                static_cast<uint32_t>(queueFamilyIndices.size()),
-                queueFamilyIndices.data(),
-                surfaceCapabilities.currentTransform,
-                vk::CompositeAlphaFlagBitsKHR::eOpaque,
-                presentMode,
-                VK_TRUE,
-                VK_NULL_HANDLE
-        };
+        if (this->config.headless) {
+            std::vector<vk::Image> images;
+            for (uint32_t i = 0; i < this->config.frames.framesInFlight; i++) {
+                this->offscreenTargets.emplace_back(this->device, this->memoryAllocator, this->config.extent);
+                images.push_back(this->offscreenTargets.back().getImage());
+            }
 
-        this->swapchain = this->device.createSwapchainKHR(swapchainCreateInfo);
-        this->swapchainImages = [this]{
-            std::vector<vk::Image> result;
-            for (auto& i : swapchain.getImages())
-                result.emplace_back(i);
-
-            return std::move(result);
-        }();
-
-        this->swapchainImageViews = [this, &surfaceFormat]{
-            std::vector<vk::raii::ImageView> result;
-
-            vk::ImageViewCreateInfo viewCreateInfo {
-                    {},
-                    {},
-                    vk::ImageViewType::e2D,
-                    surfaceFormat.format,
-                    {},
-                    {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
-            };
+            this->swapchain = SwapchainManager(this->device, std::move(images), colorFormat, this->config.extent);
+
+            if (!this->config.batchOutputDirectory.empty()) {
+                std::filesystem::create_directories(this->config.batchOutputDirectory);
 
-            for (auto& i : this->swapchainImages) {
-                viewCreateInfo.image = i;
-                result.push_back(this->device.createImageView(viewCreateInfo));
+                this->imageWriter = std::make_unique<ImageWriter>(this->config.batchOutput);
+                this->pendingCaptures.assign(this->offscreenTargets.size(), NoCapture);
+                // Every frame is an image of its own, even if it looks like the one before
+                this->config.skipUnchangedFrames = false;
             }
+        } else {
+            SwapchainSettings swapchainSettings {
+                    surfaceFormat,
+                    this->config.latencyPolicy,
+                    {graphicsQueueFamilyIndex, presentQueueFamilyIndex}
+            };
 
-            return std::move(result);
-        }();
+            int width = 0, height = 0;
+            glfwGetFramebufferSize(this->window, &width, &height);
+
+            this->swapchain = SwapchainManager(this->device, this->physicalDevice, this->surface,
+                                               std::move(swapchainSettings), {static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
+        }
+
+        stage.next("FrameGraph");
 
         auto checkFormat = [this](vk::Format wantedFormat, vk::ImageTiling tiling, vk::FormatFeatureFlags features){
             vk::FormatProperties props = this->physicalDevice.getFormatProperties(wantedFormat);
@@ -264,289 +331,616 @@ namespace imr {
             throw std::runtime_error("There was no format satisfying the requirements");
         };
 
-        vk::Format depthFormat = chooseFormat({vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+        this->depthFormat = chooseFormat({vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
 
-        this->renderPass = [&]{
-            vk::AttachmentDescription depthAttachment {
-                {},
-                depthFormat,
-                vk::SampleCountFlagBits::e1,
-                vk::AttachmentLoadOp::eClear,
-                vk::AttachmentStoreOp::eDontCare,
-                vk::AttachmentLoadOp::eDontCare,
-                vk::AttachmentStoreOp::eDontCare,
-                vk::ImageLayout::eUndefined,
-                vk::ImageLayout::eDepthStencilAttachmentOptimal
-            };
+        // The pipelines are created against the main pass' render pass, every later frame's is compatible with it
+        this->frameGraphExecutor = std::make_unique<FrameGraphExecutor>(this->device, this->memoryAllocator);
+        buildFrameGraph(0, {}, vk::SubpassContents::eInline);
+        this->renderPass = this->frameGraphExecutor->getRenderPass(this->frameGraph, 0);
 
-            vk::AttachmentReference depthAttachmentRef {1, vk::ImageLayout::eDepthStencilAttachmentOptimal };
-
-            vk::AttachmentDescription colorAttachment {
-                    {},
-                    surfaceFormat.format,
-                    vk::SampleCountFlagBits::e1,
-                    vk::AttachmentLoadOp::eClear,
-                    vk::AttachmentStoreOp::eStore,
-                    vk::AttachmentLoadOp::eDontCare,
-                    vk::AttachmentStoreOp::eDontCare,
-                    vk::ImageLayout::eUndefined,
-                    vk::ImageLayout::ePresentSrcKHR
-            };
+        // Frames in flight
+        stage.next("FrameRing");
 
-            vk::AttachmentReference colorAttachmentRef {0, vk::ImageLayout::eColorAttachmentOptimal };
+        this->frameRing = FrameRing(this->device, this->memoryAllocator, graphicsQueueFamilyIndex, this->config.frames);
+        this->framePacer = FramePacer(this->config.targetFrameRate);
 
-            vk::SubpassDescription subpassDescription {
-                    {},
-                    vk::PipelineBindPoint::eGraphics,
-                    0, nullptr,
-                    1, &colorAttachmentRef,
-                    nullptr,
-                    &depthAttachmentRef
-            };
+        if (this->config.recordingThreads > 1) {
+            this->parallelRecorder = std::make_unique<ParallelRecorder>(this->device, graphicsQueueFamilyIndex,
+                                                                        this->config.frames.framesInFlight, this->config.recordingThreads);
+        }
+        // Created on the thread that runs the frames, which takes part as thread 0
+        if (this->config.jobThreads > 1) {
+            this->jobSystem = std::make_unique<JobSystem>(this->config.jobThreads);
+        }
+        this->imagesInFlight.assign(this->swapchain.getImageCount(), VK_NULL_HANDLE);
 
-            vk::SubpassDependency dependency {
-                VK_SUBPASS_EXTERNAL,
-                0,
-                vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
-                vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
-                vk::AccessFlagBits::eNone,
-                vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite
-            };
+        if (this->config.enableGpuProfiler) {
+            this->gpuProfiler = GpuProfiler(this->device, this->physicalDevice, graphicsQueueFamilyIndex, this->config.frames.framesInFlight);
+        }
 
-            std::array<vk::AttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
-            std::array<vk::SubpassDescription, 1> subpasses = {subpassDescription};
-            std::array<vk::SubpassDependency, 1> dependencies = {dependency};
+        // Debug messenger
+        stage.next("DebugMessenger");
 
-            vk::RenderPassCreateInfo renderPassInfo {
-                    {},
-                    attachments,
-                    subpasses,
-                    dependencies
-            };
+        if (!this->enabledLayers.empty()) {
+            this->debugMessenger = this->instance.createDebugUtilsMessengerEXT(debugCreateInfo);
+        }
 
-            return this->device.createRenderPass(renderPassInfo);
-        }();
+        // Text
+        stage.next("TextAtlas");
 
-        // Depth resources
-        auto findMemType = [this](uint32_t typeFilter, vk::MemoryPropertyFlags props){
-            auto memProps = this->physicalDevice.getMemoryProperties();
-            for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
-                if ((typeFilter & (1<<i)) && ((memProps.memoryTypes[i].propertyFlags & props) == props)) return i;
-            }
-            throw std::runtime_error("Failed to find suitable memory type");
-        };
-        auto createImageWithInfo = [&](const vk::ImageCreateInfo& imageInfo, vk::MemoryPropertyFlags memProps){
-            vk::raii::Image image{VK_NULL_HANDLE};
-            vk::raii::DeviceMemory imageMemory{VK_NULL_HANDLE};
+        this->textCache = TextCache(this->config.glyphAtlasSize);
+        this->atlasTexture = AtlasTexture(this->device, this->memoryAllocator, {this->config.glyphAtlasSize, this->config.glyphAtlasSize});
 
-            image = this->device.createImage(imageInfo);
+        // The atlas is just another entry of the texture table, in its reserved slot
+        this->textureTable = TextureTable(this->device, this->physicalDevice, this->config.textures.maxTextures + ReservedTextureSlots);
+        this->textureTable.write(GlyphAtlasSlot, this->atlasTexture.getSampler(), this->atlasTexture.getView());
 
-            vk::MemoryRequirements memReq = image.getMemoryRequirements();
+        // Textures
+        stage.next("TextureStreamer");
 
-            vk::MemoryAllocateInfo allocInfo {
-                memReq.size,
-                findMemType(memReq.memoryTypeBits, memProps)
-            };
+        this->textureStreamer = std::make_unique<TextureStreamer>(this->device, this->memoryAllocator,
+                                                                  this->transferQueue, transferQueueFamilyIndex, graphicsQueueFamilyIndex,
+                                                                  this->textureTable, this->config.textures);
 
-            imageMemory = this->device.allocateMemory(allocInfo);
+        // Pipeline Layout
+        stage.next("PipelineLayout");
 
-            image.bindMemory(*imageMemory, 0);
+        vk::PushConstantRange pushConstantRange {
+                vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::vec2)
+        };
 
-            return std::make_pair(std::move(image), std::move(imageMemory));
+        // Shared by every program, so the texture table is bound once per command buffer
+        vk::DescriptorSetLayout textureTableLayout = this->textureTable.getLayout();
+        vk::PipelineLayoutCreateInfo layoutInfo {
+                {}, 1, &textureTableLayout, 1, &pushConstantRange
         };
 
-        for (int i = 0; i < this->swapchainImages.size(); i++){
-            vk::ImageCreateInfo imageInfo {
-                    {},
-                    vk::ImageType::e2D,
-                    depthFormat,
-                    vk::Extent3D(640, 480, 1), // TODO add dynamic extent
-                    1, 1,
-                    vk::SampleCountFlagBits::e1,
-                    vk::ImageTiling::eOptimal,
-                    vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                    vk::SharingMode::eExclusive, 0, nullptr,
-                    vk::ImageLayout::eUndefined
-            };
+        this->pipelineLayout = this->device.createPipelineLayout(layoutInfo);
 
-            auto [img, mem] = createImageWithInfo(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        // Shaders, embedded by CMake unless IMR_EMBED_SHADERS is off
+        stage.next("Shaders");
 
-            vk::ImageViewCreateInfo viewInfo {
-                    {},
-                    *img,
-                    vk::ImageViewType::e2D,
-                    depthFormat, {},
-                    {vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1}
-            };
+        this->shaderLibrary = ShaderLibrary(this->device);
 
-            this->depthImageViews.push_back(this->device.createImageView(viewInfo));
-            this->depthImages.push_back(std::move(img));
-            this->depthImageMemorys.push_back(std::move(mem));
-        }
+        // Pipelines
+        stage.next("Pipelines");
 
-        // Framebuffers
-        for (int i = 0; i < this->swapchainImages.size(); i++) {
-            std::array<vk::ImageView, 2> attachments = {*this->swapchainImageViews[i], *this->depthImageViews[i]};
+        this->pipelineManager = PipelineManager(this->device, this->physicalDevice, this->config.pipelineCachePath);
 
-            vk::FramebufferCreateInfo framebufferInfo {
-                    {},
-                    *this->renderPass,
-                    attachments,
-                    640, 480, 1
-            };
+        // Vertex input state comes from the structs' attribute declarations, see VertexFormat
+        this->defaultProgram = this->pipelineManager.registerProgram(makeShaderProgram<Vertex>(
+                this->shaderLibrary.get("simple_shader.vert"),
+                this->shaderLibrary.get("simple_shader.frag"),
+                *this->pipelineLayout));
+
+        this->textProgram = this->pipelineManager.registerProgram(makeShaderProgram<Vertex>(
+                this->shaderLibrary.get("simple_shader.vert"),
+                this->shaderLibrary.get("text.frag"),
+                *this->pipelineLayout));
 
-            this->swapchainFramebuffers.push_back(this->device.createFramebuffer(framebufferInfo));
+        this->texturedProgram = this->pipelineManager.registerProgram(makeShaderProgram<Vertex>(
+                this->shaderLibrary.get("simple_shader.vert"),
+                this->shaderLibrary.get("textured.frag"),
+                *this->pipelineLayout));
+
+        // Shapes read their instance from binding 1, binding 0 stays bound to the vertices for the other programs
+        this->shapeProgram = this->pipelineManager.registerProgram(makeShaderProgram<ShapeInstance, 1, vk::VertexInputRate::eInstance>(
+                this->shaderLibrary.get("sdf_shape.vert"),
+                this->shaderLibrary.get("sdf_shape.frag"),
+                *this->pipelineLayout));
+
+        // Compacted instances start wherever the culling put them, the commands need a first instance
+        if (this->config.gpuShapeCulling && this->config.indirectDraws && this->drawIndirectFirstInstance) {
+            this->shapeCuller = std::make_unique<ShapeCuller>(this->device, this->memoryAllocator, this->pipelineManager,
+                                                              this->shaderLibrary.get("cull_shapes.comp"), this->config.frames);
         }
 
-        // Sync objects
-        for (int i = 0; i < this->swapchainImages.size(); i++) {
-            this->renderFinishedSemaphores.push_back(this->device.createSemaphore({}));
-            this->imageAvailableSemaphores.push_back(this->device.createSemaphore({}));
-            this->imageInFlightFences.push_back(this->device.createFence({ vk::FenceCreateFlagBits::eSignaled }));
+        // The variants the Renderer can ask for are known up front, build them off the main thread
+        std::vector<PipelineKey> defaultVariants;
+        for (auto blend : {BlendMode::eAlpha, BlendMode::eOpaque, BlendMode::eAdditive, BlendMode::ePremultiplied}) {
+            defaultVariants.push_back(getPipelineKey({PipelineType::eSolid, blend}));
+            defaultVariants.push_back(getPipelineKey({PipelineType::eShape, blend}));
+            defaultVariants.push_back(getPipelineKey({PipelineType::eText, blend}));
+            defaultVariants.push_back(getPipelineKey({PipelineType::eTextured, blend}));
         }
+        this->pipelineManager.prewarm(std::move(defaultVariants));
 
-        // Debug messenger
-        this->debugMessenger = this->instance.createDebugUtilsMessengerEXT(debugCreateInfo);
+    }
 
-        // Pipeline Layout
-        vk::PipelineLayoutCreateInfo layoutInfo {
-                {}, 0, nullptr, 0, nullptr
+    PipelineKey AppBase::getPipelineKey(const DrawState &state) const {
+        uint32_t program = this->defaultProgram;
+        if (state.pipeline == PipelineType::eShape) program = this->shapeProgram;
+        if (state.pipeline == PipelineType::eText) program = this->textProgram;
+        if (state.pipeline == PipelineType::eTextured) program = this->texturedProgram;
+
+        return {
+                program,
+                state.blend,
+                vk::PrimitiveTopology::eTriangleList,
+                false,
+                this->renderPass,
+                0
         };
+    }
 
-        this->pipelineLayout = this->device.createPipelineLayout(layoutInfo);
+    FrameSlot &AppBase::beginFrame(Renderer &renderer) {
+        FrameSlot& frame = this->frameRing.acquire(this->device);
+        this->frameStart = FramePacer::Clock::now();
+        this->frameArena.reset();
+        this->frameStats = {};
+        this->drawCallCount.store(0, std::memory_order_relaxed);
+
+        // Resources retired while the finished frames were in flight can go now
+        this->deletionQueue.collect(this->frameRing.getCompletedFrame());
+
+        // Never waits, uploads that aren't done yet are picked up by a later frame
+        this->textureStreamer->update();
+
+        // The slot's fence has signalled, so its upload buffer is free to be overwritten
+        renderer.begin(frame.getGeometryTarget(this->frameRing.getConfig()));
+
+        this->textCache.beginFrame(frame.frameNumber);
+        renderer.setTextCache(&this->textCache);
+        renderer.setTextureSlots(&this->textureStreamer->getSlots());
+        renderer.setJobSystem(this->jobSystem.get());
+        renderer.setGpuShapeCulling(this->shapeCuller != nullptr);
+
+        return frame;
+    }
+
+    bool AppBase::endFrame(FrameSlot &frame, Renderer &renderer) {
+        renderer.end();
+
+        this->frameStats.batches = static_cast<uint32_t>(renderer.getBatches().size());
+        this->frameStats.uploadedBytes = renderer.getVertices().size_bytes() + renderer.getIndices().size_bytes() +
+                                         renderer.getShapes().size_bytes();
+
+        // Nothing to present into while minimized. Like any skipped frame the slot's fence was never reset.
+        if (this->swapchainOutOfDate && !recreateSwapchain()) {
+            this->skippedFrameCount++;
+            return false;
+        }
+
+        // Everything came from cached scopes matching the previous frame, what's on screen is still right.
+        // The slot's fence was never reset, so acquiring it again doesn't wait.
+        if (this->config.skipUnchangedFrames && this->frameCount > 0 && !this->redrawRequired &&
+            renderer.isUnchanged() && !this->textCache.getAtlas().isDirty() && !this->textureStreamer->hasPendingAcquires()) {
+            this->skippedFrameCount++;
+            return false;
+        }
 
-        // Shaders TODO: compile shaders and make modules
-        auto makeShader = [this](const std::string& filepath){
-            std::ifstream codeFile{filepath, std::ios::ate | std::ios::binary};
+        uint32_t imageIndex;
+        if (this->config.headless) {
+            imageIndex = this->nextOffscreenTarget;
+            this->nextOffscreenTarget = (this->nextOffscreenTarget + 1) % static_cast<uint32_t>(this->offscreenTargets.size());
+        } else {
+            try {
+                auto [result, index] = this->swapchain.getSwapchain().acquireNextImage(UINT64_MAX, *frame.imageAvailableSemaphore);
+                // Still presentable, rebuilt before the next frame
+                if (result == vk::Result::eSuboptimalKHR) this->swapchainOutOfDate = true;
+                imageIndex = index;
+            } catch (const vk::OutOfDateKHRError&) {
+                // The semaphore wasn't signalled, so the slot is reusable as is
+                this->swapchainOutOfDate = true;
+                this->skippedFrameCount++;
+                return false;
+            }
+        }
+        this->lastImageIndex = imageIndex;
 
-            if (!codeFile.is_open()) throw std::runtime_error("Failed to open file: " + filepath);
+        // With more swapchain images than frames in flight an image can still be owned by an older slot
+        if (this->imagesInFlight[imageIndex]) {
+            if (this->device.waitForFences({this->imagesInFlight[imageIndex]}, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to wait for swapchain image fence");
+            }
+        }
+        this->imagesInFlight[imageIndex] = *frame.inFlightFence;
 
-            size_t fileSize = static_cast<size_t>(codeFile.tellg());
-            std::vector<char> buffer(fileSize);
+        // The wait above finished the frame the target was last used for
+        if (this->imageWriter) writeCapture(imageIndex);
 
-            codeFile.seekg(0);
-            codeFile.read(buffer.data(), fileSize);
+        recordCommandBuffer(frame, renderer, imageIndex);
 
-            codeFile.close();
+        this->device.resetFences({*frame.inFlightFence});
+
+        // The swapchain image, and the uploads of textures acquired in this frame. Values only matter for the timeline.
+        std::array<vk::Semaphore, 2> waitSemaphores;
+        std::array<vk::PipelineStageFlags, 2> waitStages;
+        std::array<uint64_t, 2> waitValues{};
+        uint32_t waitCount = 0;
+
+        if (!this->config.headless) {
+            waitSemaphores[waitCount] = *frame.imageAvailableSemaphore;
+            waitStages[waitCount++] = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        }
 
-            vk::ShaderModuleCreateInfo shaderInfo {
-                    {},
-                    buffer.size(),
-                    reinterpret_cast<const uint32_t*>(buffer.data())
+        if (uint64_t uploads = this->textureStreamer->getAcquireWait()) {
+            waitSemaphores[waitCount] = this->textureStreamer->getTimeline();
+            waitStages[waitCount] = vk::PipelineStageFlagBits::eFragmentShader;
+            waitValues[waitCount++] = uploads;
+        }
+
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{waitCount, waitValues.data()};
+
+        if (this->config.headless) {
+            vk::SubmitInfo submitInfo {
+                    waitCount, waitSemaphores.data(), waitStages.data(),
+                    1, &*frame.commandBuffer,
+                    0, nullptr,
+                    &timelineInfo
             };
 
-            return this->device.createShaderModule(shaderInfo);
-        };
+            this->graphicsQueue.submit(submitInfo, *frame.inFlightFence);
+            this->frameRing.markSubmitted(frame);
+            this->redrawRequired = false;
 
-        this->vertexShaderModule = makeShader("../shaders/simple_shader.vert.spv");
-        this->fragmentShaderModule = makeShader("../shaders/simple_shader.frag.spv");
+            if (this->imageWriter) this->pendingCaptures[imageIndex] = this->frameCount;
+            return true;
+        }
 
-        // Pipeline
-        vk::PipelineShaderStageCreateInfo shaderStages[2] = {
-                {{}, vk::ShaderStageFlagBits::eVertex, *this->vertexShaderModule, "main", nullptr },
-                {{}, vk::ShaderStageFlagBits::eFragment, *this->fragmentShaderModule, "main", nullptr }
+        vk::SubmitInfo submitInfo {
+                waitCount, waitSemaphores.data(), waitStages.data(),
+                1, &*frame.commandBuffer,
+                1, &*frame.renderFinishedSemaphore,
+                &timelineInfo
         };
 
-        vk::Viewport viewport{
-            0.0f,
-            0.0f,
-            640.0f, // TODO dynamic size
-            480.0f,
-            0.0f,
-            1.0f
-        };
+        this->graphicsQueue.submit(submitInfo, *frame.inFlightFence);
+        this->frameRing.markSubmitted(frame);
+        this->redrawRequired = false;
 
-        vk::Rect2D scissor{
-                {0, 0},
-                {640, 480} // TODO dynamic size
+        vk::PresentInfoKHR presentInfo {
+                1, &*frame.renderFinishedSemaphore,
+                1, &*this->swapchain.getSwapchain(),
+                &imageIndex
         };
 
-        vk::PipelineViewportStateCreateInfo viewportStateInfo {
-                {},
-                1, &viewport,
-                1, &scissor
-        };
+        // The semaphore wait still happens when the present is rejected
+        try {
+            if (this->presentQueue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR) this->swapchainOutOfDate = true;
+        } catch (const vk::OutOfDateKHRError&) {
+            this->swapchainOutOfDate = true;
+        }
 
-        vk::PipelineVertexInputStateCreateInfo vertexInputStateInfo {
-                {}, 0, nullptr, 0, nullptr
-        };
+        this->framePacer.framePresented(this->inputTime, this->swapchain.getPresentQueueDepth(this->frameRing.getFramesInFlight()));
 
-        vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo {
-                {},
-                vk::PrimitiveTopology::eTriangleList,
-                VK_FALSE
-        };
+        return true;
+    }
 
-        vk::PipelineRasterizationStateCreateInfo rasterizationStateInfo {
-                {},
-                VK_FALSE,
-                VK_FALSE,
-                vk::PolygonMode::eFill,
-                vk::CullModeFlagBits::eNone,
-                vk::FrontFace::eClockwise,
-                VK_FALSE,
-                0.0f, 0.0f, 0.0f,
-                1.0f
-        };
+    bool AppBase::recreateSwapchain() {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(this->window, &width, &height);
 
-        vk::PipelineMultisampleStateCreateInfo multisampleStateInfo {
-                {},
-                vk::SampleCountFlagBits::e1,
-                VK_FALSE,
-                1.0f,
-                nullptr,
-                VK_FALSE,
-                VK_FALSE
-        };
+        // Framebuffers of the old views go together with them
+        this->frameGraphExecutor->retireFramebuffers(this->deletionQueue, this->frameRing.getLastSubmittedFrame());
 
-        vk::PipelineColorBlendAttachmentState colorBlendAttachmentState {
-                VK_FALSE,
-                vk::BlendFactor::eOne,
-                vk::BlendFactor::eZero,
-                vk::BlendOp::eAdd,
-                vk::BlendFactor::eOne,
-                vk::BlendFactor::eZero,
-                vk::BlendOp::eAdd,
-                vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
-        };
+        // The old images stay alive until the frames that may still be rendering into them have finished
+        if (!this->swapchain.recreate({static_cast<uint32_t>(width), static_cast<uint32_t>(height)},
+                                      this->deletionQueue, this->frameRing.getLastSubmittedFrame())) {
+            return false;
+        }
 
-        vk::PipelineColorBlendStateCreateInfo colorBlendStateInfo {
-                {},
-                VK_FALSE,
-                vk::LogicOp::eCopy,
-                1, &colorBlendAttachmentState,
-                {.0f, .0f, .0f, .0f}
-        };
+        this->imagesInFlight.assign(this->swapchain.getImageCount(), VK_NULL_HANDLE);
+        this->swapchainOutOfDate = false;
+        this->redrawRequired = true;
 
-        vk::PipelineDepthStencilStateCreateInfo depthStencilStateInfo {
-                {},
-                VK_TRUE,
-                VK_TRUE,
-                vk::CompareOp::eLess,
-                VK_FALSE,
-                VK_FALSE, {}, {},
-                0.0f,
-                1.0f
-        };
+        return true;
+    }
 
-        vk::GraphicsPipelineCreateInfo pipelineInfo {
-                {},
-                2, shaderStages,
-                &vertexInputStateInfo,
-                &inputAssemblyStateInfo, {},
-                &viewportStateInfo,
-                &rasterizationStateInfo,
-                &multisampleStateInfo,
-                &depthStencilStateInfo,
-                &colorBlendStateInfo,
-                {},
-                *this->pipelineLayout,
-                *this->renderPass,
-                0,
-                VK_NULL_HANDLE, -1
+    void AppBase::recordCommandBuffer(FrameSlot &frame, const Renderer &renderer, uint32_t imageIndex) {
+        auto& cmd = frame.commandBuffer;
+
+        // The slot's command pool was reset in FrameRing::acquire
+        cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+        // Transfers and query resets have to happen outside the render pass
+        this->atlasTexture.recordUpload(cmd, frame, this->textCache.getAtlas());
+        this->textureStreamer->recordAcquires(cmd);
+        this->gpuProfiler.beginFrame(cmd, frame.index);
+
+        const auto& batches = renderer.getBatches();
+        const FrameRingConfig& frameConfig = this->frameRing.getConfig();
+
+        // The commands go straight into the slot's upload buffer, the culling pass then fills in the shape batches' instances
+        this->indirectFrame = this->config.indirectDraws && batches.size() <= frameConfig.drawCommandCapacity;
+        this->culledShapesFrame = false;
+        if (this->indirectFrame) {
+            bool cullShapes = this->shapeCuller && !renderer.getShapes().empty();
+            renderer.writeDrawCommands(frame.getDrawCommands(frameConfig), cullShapes);
+
+            if (cullShapes) {
+                uint32_t cullZone = this->gpuProfiler.beginZone(cmd, "CullShapes");
+                this->culledShapesFrame = this->shapeCuller->record(cmd, frame, batches, static_cast<uint32_t>(renderer.getShapes().size()),
+                                                                    this->swapchain.getExtent());
+                this->gpuProfiler.endZone(cmd, cullZone);
+
+                // Out of transient memory, the shapes are drawn unculled
+                if (!this->culledShapesFrame) renderer.writeDrawCommands(frame.getDrawCommands(frameConfig), false);
+            }
+        }
+
+        uint32_t graphZone = this->gpuProfiler.beginZone(cmd, "FrameGraph");
+
+        // Timestamps can't go between the secondaries, the inline path is the only one with zones
+        bool parallel = this->parallelRecorder && !this->config.profileBatches &&
+                        batches.size() >= this->config.parallelRecordingMinBatches;
+
+        auto mainPass = [&](const vk::raii::CommandBuffer& passCmd, const FrameGraphPassContext& pass) {
+            if (parallel) {
+                this->parallelRecorder->beginFrame(frame.index);
+
+                vk::CommandBufferInheritanceInfo inheritance {
+                        pass.renderPass, 0,
+                        pass.framebuffer
+                };
+
+                // Contiguous chunks keep the draw order once the secondaries are executed in chunk order.
+                // Renderer zones are dropped here, the profiler isn't thread safe.
+                uint32_t chunkCount = this->parallelRecorder->getThreadCount();
+                size_t chunkSize = (batches.size() + chunkCount - 1) / chunkCount;
+
+                const auto& secondaries = this->parallelRecorder->record(chunkCount, inheritance,
+                        [&](const vk::raii::CommandBuffer& chunkCmd, uint32_t chunk) {
+                            size_t first = std::min(batches.size(), chunk * chunkSize);
+                            size_t count = std::min(batches.size() - first, chunkSize);
+                            if (count == 0) return;
+
+                            bindFrameGeometry(chunkCmd, frame);
+                            recordBatches(chunkCmd, frame, std::span(batches).subspan(first, count), static_cast<uint32_t>(first), false);
+                        });
+
+                passCmd.executeCommands(secondaries);
+                return;
+            }
+
+            const auto& zoneMarkers = renderer.getZoneMarkers();
+            size_t nextMarker = 0;
+            this->openGpuZones.clear();
+
+            // Markers placed in front of batch index `batch` are emitted before that batch is drawn
+            auto emitZoneMarkers = [&](uint32_t batch) {
+                for (; nextMarker < zoneMarkers.size() && zoneMarkers[nextMarker].batch <= batch; nextMarker++) {
+                    if (zoneMarkers[nextMarker].name) {
+                        this->openGpuZones.push_back(this->gpuProfiler.beginZone(passCmd, zoneMarkers[nextMarker].name));
+                    } else if (!this->openGpuZones.empty()) {
+                        this->gpuProfiler.endZone(passCmd, this->openGpuZones.back());
+                        this->openGpuZones.pop_back();
+                    }
+                }
+            };
+
+            if (!batches.empty()) {
+                bindFrameGeometry(passCmd, frame);
+
+                // Split at zone markers so the zones wrap exactly their batches
+                uint32_t first = 0;
+                while (first < batches.size()) {
+                    emitZoneMarkers(first);
+
+                    uint32_t last = nextMarker < zoneMarkers.size() ? std::min<uint32_t>(zoneMarkers[nextMarker].batch, batches.size()) : batches.size();
+                    recordBatches(passCmd, frame, std::span(batches).subspan(first, last - first), first, this->config.profileBatches);
+                    first = last;
+                }
+            }
+
+            // Zones that close after the last batch, or in a frame without any
+            emitZoneMarkers(UINT32_MAX);
         };
 
-        this->pipeline = this->device.createGraphicsPipeline(VK_NULL_HANDLE, pipelineInfo);
+        buildFrameGraph(imageIndex, FrameGraphCallback::wrap(mainPass), parallel ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+        // Transients replaced this frame may still be in use by the frames before it
+        this->frameGraphExecutor->execute(cmd, this->frameGraph, this->deletionQueue, this->frameRing.getLastSubmittedFrame());
+
+        this->gpuProfiler.endZone(cmd, graphZone);
+
+        cmd.end();
+    }
+
+    void AppBase::buildFrameGraph(uint32_t imageIndex, FrameGraphCallback mainPass, vk::SubpassContents contents) {
+        this->frameGraph.reset();
+
+        // Rendered from scratch every frame. The acquire semaphore is waited for at the color output stage.
+        FrameGraphResource backbuffer = this->frameGraph.importImage({
+                this->swapchain.getImage(imageIndex),
+                this->swapchain.getImageView(imageIndex),
+                this->swapchain.getColorFormat(),
+                this->swapchain.getExtent(),
+                vk::ImageLayout::eUndefined,
+                vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                this->config.headless ? vk::ImageLayout::eUndefined : vk::ImageLayout::ePresentSrcKHR,
+                true
+        });
+
+        // Neither loaded nor stored, on tilers it never leaves tile memory
+        FrameGraphResource depth = this->frameGraph.createImage({this->depthFormat, this->swapchain.getExtent()});
+
+        FrameGraphPass main = this->frameGraph.addPass("Main", mainPass, contents);
+        this->frameGraph.writeColor(main, backbuffer, vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+        this->frameGraph.writeDepth(main, depth, vk::ClearDepthStencilValue{1.0f, 0});
+
+        if (this->config.headless) {
+            FrameGraphPass readback = this->frameGraph.addPass("Readback", [this, imageIndex](const vk::raii::CommandBuffer& cmd, const FrameGraphPassContext&) {
+                this->offscreenTargets[imageIndex].recordReadback(cmd);
+            });
+            this->frameGraph.copyFrom(readback, backbuffer);
+            this->frameGraph.keepAlive(readback);
+        }
+
+        this->frameGraph.compile();
+    }
+
+    void AppBase::bindFrameGeometry(const vk::raii::CommandBuffer &cmd, const FrameSlot &frame) {
+        // Culled shapes are read from where the culling compacted them
+        if (this->culledShapesFrame) {
+            cmd.bindVertexBuffers(0, {*frame.uploadBuffer, this->shapeCuller->getInstanceBuffer(frame.index)}, {frame.vertexOffset, vk::DeviceSize{0}});
+        } else {
+            cmd.bindVertexBuffers(0, {*frame.uploadBuffer, *frame.uploadBuffer}, {frame.vertexOffset, frame.shapeOffset});
+        }
+        cmd.bindIndexBuffer(*frame.uploadBuffer, frame.indexOffset, vk::IndexType::eUint32);
+
+        vk::Extent2D extent = this->swapchain.getExtent();
+        glm::vec2 screenSize(static_cast<float>(extent.width), static_cast<float>(extent.height));
+        cmd.pushConstants<glm::vec2>(*this->pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, screenSize);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *this->pipelineLayout, 0, this->textureTable.getSet(), nullptr);
+
+        // Dynamic state isn't inherited by secondaries, every command buffer sets it itself
+        cmd.setViewport(0, vk::Viewport{0.0f, 0.0f, screenSize.x, screenSize.y, 0.0f, 1.0f});
+    }
+
+    void AppBase::recordBatches(const vk::raii::CommandBuffer &cmd, const FrameSlot &frame, std::span<const DrawBatch> batches,
+                                uint32_t firstBatch, bool profileBatches) {
+        vk::Pipeline boundPipeline;
+        const ClipRect* boundClip = nullptr;
+        uint32_t drawCalls = 0;
+        for (uint32_t i = 0; i < batches.size();) {
+            const DrawBatch& batch = batches[i];
+            vk::Pipeline batchPipeline = this->pipelineManager.get(getPipelineKey(batch.state));
+            if (batchPipeline != boundPipeline) {
+                cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, batchPipeline);
+                boundPipeline = batchPipeline;
+            }
+
+            if (!boundClip || batch.state.clip != *boundClip) {
+                cmd.setScissor(0, getScissor(batch.state.clip));
+                boundClip = &batch.state.clip;
+            }
+
+            // Shape commands start at their first instance, which an indirect draw may only do with drawIndirectFirstInstance
+            bool shape = batch.state.pipeline == PipelineType::eShape;
+            bool indirect = this->indirectFrame && (!shape || this->drawIndirectFirstInstance);
+
+            // Batches split only by scopes, zones or polyline chunks need no state change, they join one multi draw
+            uint32_t count = 1;
+            if (indirect && !profileBatches) {
+                while (i + count < batches.size() && count < this->maxDrawIndirectCount && batches[i + count].state == batch.state) count++;
+            }
+
+            uint32_t batchZone = profileBatches ? this->gpuProfiler.beginZone(cmd, "Batch") : GpuProfiler::InvalidZone;
+            if (indirect) {
+                vk::DeviceSize offset = frame.drawCommandOffset + static_cast<vk::DeviceSize>(firstBatch + i) * sizeof(DrawIndirectCommand);
+                if (shape) cmd.drawIndirect(*frame.uploadBuffer, offset, count, sizeof(DrawIndirectCommand));
+                else cmd.drawIndexedIndirect(*frame.uploadBuffer, offset, count, sizeof(DrawIndirectCommand));
+            } else if (shape) {
+                // Two triangles per instance, the corners come from gl_VertexIndex
+                cmd.draw(6, batch.instanceCount, 0, batch.firstInstance);
+            } else {
+                cmd.drawIndexed(batch.indexCount, 1, batch.firstIndex, batch.vertexOffset, 0);
+            }
+            this->gpuProfiler.endZone(cmd, batchZone);
+
+            drawCalls++;
+            i += count;
+        }
+
+        this->drawCallCount.fetch_add(drawCalls, std::memory_order_relaxed);
+    }
+
+    vk::Rect2D AppBase::getScissor(const ClipRect &clip) const {
+        auto width = static_cast<float>(this->swapchain.getExtent().width);
+        auto height = static_cast<float>(this->swapchain.getExtent().height);
+
+        // Rounded outwards, the unbounded default ends up as the whole framebuffer
+        float minX = std::clamp(std::floor(clip.min.x), 0.0f, width);
+        float minY = std::clamp(std::floor(clip.min.y), 0.0f, height);
+        float maxX = std::clamp(std::ceil(clip.max.x), minX, width);
+        float maxY = std::clamp(std::ceil(clip.max.y), minY, height);
+
+        return {{static_cast<int32_t>(minX), static_cast<int32_t>(minY)},
+                {static_cast<uint32_t>(maxX - minX), static_cast<uint32_t>(maxY - minY)}};
+    }
+
+    void AppBase::reloadShaders() {
+        if (this->shaderLibrary.reloadChanged().empty()) return;
+
+        // Every variant of a changed program is rebuilt, none of them may still be in flight
+        this->device.waitIdle();
+
+        this->pipelineManager.replaceShaders(this->defaultProgram,
+                                             this->shaderLibrary.get("simple_shader.vert"),
+                                             this->shaderLibrary.get("simple_shader.frag"));
+        this->pipelineManager.replaceShaders(this->textProgram,
+                                             this->shaderLibrary.get("simple_shader.vert"),
+                                             this->shaderLibrary.get("text.frag"));
+        this->pipelineManager.replaceShaders(this->texturedProgram,
+                                             this->shaderLibrary.get("simple_shader.vert"),
+                                             this->shaderLibrary.get("textured.frag"));
+        this->pipelineManager.replaceShaders(this->shapeProgram,
+                                             this->shaderLibrary.get("sdf_shape.vert"),
+                                             this->shaderLibrary.get("sdf_shape.frag"));
+    }
+
+    void AppBase::reportStartup() {
+        if (!this->config.startupTracePath.empty()) {
+            std::ofstream traceFile{this->config.startupTracePath, std::ios::trunc};
+            if (!traceFile.is_open()) throw std::runtime_error("Failed to open file: " + this->config.startupTracePath.string());
+
+            this->startupProfiler.writeChromeTrace(traceFile);
+        }
+
+        if (this->config.printStartupSummary) {
+            std::cout << "Startup timings:\n";
+            this->startupProfiler.writeSummary(std::cout);
+        }
+    }
+
+    void AppBase::reportLatency() const {
+        const LatencyStats& stats = this->framePacer.getStats();
+
+        std::cout << "Present mode: " << vk::to_string(this->swapchain.getPresentMode()) << '\n'
+                  << "Input to present latency over " << stats.frames << " frames (estimated): "
+                  << "avg " << stats.averageMs << " ms, max " << stats.maxMs << " ms, "
+                  << "frame interval " << stats.frameIntervalMs << " ms\n";
+    }
+
+    void AppBase::reportBatch() {
+        ImageWriterStats stats = this->imageWriter->getStats();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->batchStart).count();
+
+        std::cout << "Batch output: " << stats.images << " images (" << getImageFileExtension(this->imageWriter->getConfig().format)
+                  << ", " << stats.bytes / (1024.0 * 1024.0) << " MiB) in " << seconds << " s, "
+                  << stats.images / seconds << " images/s end to end, "
+                  << (stats.images ? stats.encodeSeconds * 1000.0 / stats.images : 0.0) << " ms encoding per image on "
+                  << this->imageWriter->getConfig().workerThreads << " threads\n";
+    }
+
+    void AppBase::writeCapture(uint32_t imageIndex) {
+        uint64_t frame = this->pendingCaptures[imageIndex];
+        if (frame == NoCapture) return;
+        this->pendingCaptures[imageIndex] = NoCapture;
+
+        // Copied out right away, the target is about to be rendered into again
+        const OffscreenTarget& target = this->offscreenTargets[imageIndex];
+        ImageData image{target.getExtent().width, target.getExtent().height, this->imageWriter->takeBuffer()};
+        target.read(image.pixels);
+
+        std::string name = std::to_string(frame);
+        name = "frame_" + std::string(name.size() < 6 ? 6 - name.size() : 0, '0') + name;
+        this->imageWriter->write(this->config.batchOutputDirectory / name, std::move(image));
+    }
+
+    void AppBase::finishBatch() {
+        // Oldest first, like the images written during the run
+        std::vector<uint32_t> targets;
+        for (uint32_t i = 0; i < this->pendingCaptures.size(); i++) {
+            if (this->pendingCaptures[i] != NoCapture) targets.push_back(i);
+        }
+        std::ranges::sort(targets, {}, [this](uint32_t i) { return this->pendingCaptures[i]; });
+
+        for (uint32_t target : targets) writeCapture(target);
+
+        this->imageWriter->finish();
+        reportBatch();
+    }
+
+    FrameCapture AppBase::readback() {
+        if (!this->config.headless) throw std::runtime_error("Readback is only available in headless mode");
+
+        // The fence of the slot that rendered the image, the current slot may have skipped its frame
+        vk::Fence lastFence = this->imagesInFlight[this->lastImageIndex];
+        if (lastFence && this->device.waitForFences({lastFence}, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to wait for frame fence");
+        }
 
+        return this->offscreenTargets[this->lastImageIndex].read();
     }
 } // imr
\ No newline at end of file
@@ -1,29 +1,150 @@
 #ifndef VK_IMM_RENDERER_APP_BASE_HPP
 #define VK_IMM_RENDERER_APP_BASE_HPP
 
+#include <span>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
 
 #include "vulkan/vulkan_raii.hpp"
 #include <GLFW/glfw3.h>
 
 #include "renderer.hpp"
+#include "frame_ring.hpp"
+#include "memory_allocator.hpp"
+#include "offscreen_target.hpp"
+#include "swapchain_manager.hpp"
+#include "frame_arena.hpp"
+#include "frame_graph.hpp"
+#include "frame_graph_executor.hpp"
+#include "deletion_queue.hpp"
+#include "frame_pacer.hpp"
+#include "pipeline_manager.hpp"
+#include "shape_culler.hpp"
+#include "cpu_profiler.hpp"
+#include "gpu_profiler.hpp"
+#include "parallel_recorder.hpp"
+#include "shader_library.hpp"
+#include "text_cache.hpp"
+#include "atlas_texture.hpp"
+#include "texture_table.hpp"
+#include "texture_streamer.hpp"
+#include "image_writer.hpp"
+#include "allocation_counter.hpp"
 
 namespace imr {
 
+    // What one call of onFrame() cost, handed to onFrameEnd()
+    struct FrameStats {
+        // From the acquired frame slot to the submit, waiting for the GPU not included
+        double cpuMs = 0.0;
+        uint32_t batches = 0;
+        uint32_t drawCalls = 0;
+        // Geometry written into the frame's upload buffer, replayed scopes included
+        uint64_t uploadedBytes = 0;
+        // False for frames skipped because nothing changed or the window is minimized
+        bool submitted = false;
+        // Heap allocations from the frame slot to the submit, only counted with IMR_TRACK_ALLOCATIONS
+        uint64_t allocations = 0;
+        // Scratch taken from the frame arena
+        uint64_t arenaBytes = 0;
+    };
+
+    struct AppConfig {
+        FrameRingConfig frames;
+        // Renders into offscreen images without GLFW, a surface or a swapchain, e.g. on lavapipe or SwiftShader
+        bool headless = false;
+        vk::Extent2D extent{640, 480};
+        // Stops run() after this many frames, 0 runs until the window is closed
+        uint64_t maxFrames = 0;
+        // Validation is skipped with a warning when the layer isn't installed
+        bool enableValidation = true;
+        // Empty disables the on-disk pipeline cache
+        std::filesystem::path pipelineCachePath = "pipeline_cache.bin";
+        // Per stage startup timings, as a Chrome trace file and/or a text summary on stdout
+        std::filesystem::path startupTracePath;
+        bool printStartupSummary = false;
+        // Timestamp queries around the main pass and Renderer zones, optionally around every batch.
+        // Frames recorded in parallel have no Renderer zones, profileBatches records every frame inline.
+        bool enableGpuProfiler = true;
+        bool profileBatches = false;
+        // Threads recording draw batches into secondary command buffers, 1 keeps everything on the main thread.
+        // Frames with fewer batches than the threshold are recorded inline, the split isn't worth it there.
+        // Half of the cores by default, jobThreads gets the other half, so the two pools never add up to more
+        // threads than there are cores. Both count the main thread.
+        uint32_t recordingThreads = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 8u);
+        uint32_t parallelRecordingMinBatches = 256;
+        // Batches are drawn from indirect commands in the frame's upload buffer. Runs of batches that share a
+        // pipeline and clip rect go out as one multi draw where the device supports it, e.g. replayed scopes.
+        // Frames with more batches than FrameRingConfig::drawCommandCapacity are recorded directly.
+        bool indirectDraws = true;
+        // Shape instances are culled against their clip rect by a compute pass instead of on the CPU, the visible
+        // ones compacted into a GPU only buffer. Needs indirectDraws and drawIndirectFirstInstance, otherwise ignored.
+        bool gpuShapeCulling = false;
+        // Threads of the job system that tessellates large primitives in chunks, 1 keeps it on the main thread.
+        // By default the cores recordingThreads leaves.
+        uint32_t jobThreads = std::clamp(std::thread::hardware_concurrency() - std::thread::hardware_concurrency() / 2, 1u, 8u);
+        // Width and height of the glyph atlas texture
+        uint32_t glyphAtlasSize = 1024;
+        // Frames built only from unchanged Renderer scopes aren't submitted, the window then waits for
+        // input for up to idleWaitSeconds instead of spinning
+        bool skipUnchangedFrames = true;
+        double idleWaitSeconds = 1.0 / 60.0;
+        // Present mode and swapchain depth, see LatencyPolicy
+        LatencyPolicy latencyPolicy = LatencyPolicy::eVsync;
+        // Frames start no more often than this, 0 leaves pacing to the present mode. Worth setting with
+        // eLowLatency, which otherwise renders as fast as it can.
+        double targetFrameRate = 0.0;
+        // Estimated input to present latency on stdout when run() returns
+        bool printLatencySummary = false;
+        // Worker threads and staging ring of the texture uploads
+        TextureStreamerConfig textures;
+        // Headless only: every frame is written to this directory as frame_000000.png and so on, empty disables.
+        // Frames are never skipped then, set maxFrames to the number of images.
+        std::filesystem::path batchOutputDirectory;
+        ImageWriterConfig batchOutput;
+        // With IMR_TRACK_ALLOCATIONS, any frame after this many that touches the heap throws, 0 disables. For
+        // steady scenes only: resizes, texture loads, new glyphs and batch captures all allocate.
+        uint64_t allocationFreeAfterFrames = 0;
+    };
+
     class AppBase {
     protected:
-        AppBase() {
-            initGlfw();
-            initVulkan();
+        explicit AppBase(const AppConfig& config = {}) : config(config) {
+            {
+                ScopedTimer startupTimer(this->startupProfiler, "Startup");
+
+                if (!this->config.headless) {
+                    ScopedTimer glfwTimer(this->startupProfiler, "GLFW");
+                    initGlfw();
+                }
+
+                ScopedTimer vulkanTimer(this->startupProfiler, "initVulkan");
+                initVulkan();
+            }
+
+            reportStartup();
         };
 
         ~AppBase() {
 
         }
     private:
+        AppConfig config;
+        CpuProfiler startupProfiler;
+
+        void reportStartup();
+        void reportLatency() const;
+        void reportBatch();
+
         // GLFW
-        GLFWwindow* window;
+        GLFWwindow* window = nullptr;
 
         void initGlfw();
 
@@ -31,76 +152,216 @@ namespace imr {
         static const std::vector<const char*> deviceExtensions;
         static const std::vector<const char*> validationLayers;
 
+        std::vector<const char*> enabledLayers;
+        std::vector<const char*> enabledDeviceExtensions;
+
         vk::raii::Context context;
         vk::raii::Instance instance{VK_NULL_HANDLE};
 
         vk::raii::PhysicalDevice physicalDevice{VK_NULL_HANDLE};
         vk::raii::Device device{VK_NULL_HANDLE};
 
+        DeviceMemoryAllocator memoryAllocator;
+
         vk::raii::SurfaceKHR surface{VK_NULL_HANDLE};
 
         vk::raii::Queue graphicsQueue{VK_NULL_HANDLE};
         vk::raii::Queue presentQueue{VK_NULL_HANDLE};
+        // The graphics queue when there is no transfer only family
+        vk::raii::Queue transferQueue{VK_NULL_HANDLE};
+
+        FrameRing frameRing;
+        std::unique_ptr<ParallelRecorder> parallelRecorder;
+        std::unique_ptr<JobSystem> jobSystem;
+        GpuProfiler gpuProfiler;
+        std::vector<uint32_t> openGpuZones;
+
+        // Per frame scratch, reset once the frame slot is acquired. Declared before the graph that allocates from it.
+        FrameArena frameArena;
+
+        // Rebuilt every frame: the main pass into the swapchain image, headless followed by the readback
+        FrameGraph frameGraph{this->frameArena};
+        std::unique_ptr<FrameGraphExecutor> frameGraphExecutor;
+        vk::Format depthFormat = vk::Format::eUndefined;
+        // The main pass' render pass, owned by the executor. The pipelines are created against it.
+        vk::RenderPass renderPass;
+
+        // Headless stand-ins for the swapchain images, declared first so the views go before them
+        std::vector<OffscreenTarget> offscreenTargets;
+        uint32_t nextOffscreenTarget = 0;
+        uint32_t lastImageIndex = 0;
+
+        SwapchainManager swapchain;
+        // After everything it may hold on to, whatever is still queued goes first
+        DeletionQueue deletionQueue;
+        // Set by resizes and out of date presents, the swapchain is rebuilt before the next frame
+        bool swapchainOutOfDate = false;
+        // The new images have never been drawn to, the next frame can't be skipped
+        bool redrawRequired = false;
+
+        // Fence of the frame slot that last rendered into each swapchain image
+        std::vector<vk::Fence> imagesInFlight;
+
+        // Batch mode: the readback of each offscreen target is picked up when the target comes around again,
+        // so the GPU renders the next frames while the workers encode the previous ones
+        static constexpr uint64_t NoCapture = UINT64_MAX;
+        std::unique_ptr<ImageWriter> imageWriter;
+        // Frame whose pixels wait in each target's readback buffer
+        std::vector<uint64_t> pendingCaptures;
+        std::chrono::steady_clock::time_point batchStart;
+
+        uint64_t frameCount = 0;
+        uint64_t skippedFrameCount = 0;
+        bool closeRequested = false;
+
+        FrameStats frameStats;
+        FramePacer::Clock::time_point frameStart;
+        // Counted by recordBatches, which may run on the recording threads
+        std::atomic<uint32_t> drawCallCount{0};
+
+        FramePacer framePacer;
+        // When the current frame polled its input
+        FramePacer::Clock::time_point inputTime;
+
+        // Text
+        TextCache textCache;
+        AtlasTexture atlasTexture;
+
+        // Every sampled image, the atlas included. The streamer goes first, it hands out the table's slots.
+        TextureTable textureTable;
+        std::unique_ptr<TextureStreamer> textureStreamer;
 
-        vk::raii::CommandPool commandPool{VK_NULL_HANDLE};
+        vk::raii::PipelineLayout pipelineLayout{VK_NULL_HANDLE};
+        ShaderLibrary shaderLibrary;
+
+        // After the shader modules, so a running prewarm is joined before they go away
+        PipelineManager pipelineManager;
+        uint32_t defaultProgram = 0;
+        uint32_t shapeProgram = 0;
+        uint32_t textProgram = 0;
+        uint32_t texturedProgram = 0;
+
+        // Optional device features. Without multiDrawIndirect every batch is its own indirect draw, without
+        // drawIndirectFirstInstance shape batches are drawn directly.
+        bool drawIndirectFirstInstance = false;
+        uint32_t maxDrawIndirectCount = 1;
+        // Null unless gpuShapeCulling is set and supported
+        std::unique_ptr<ShapeCuller> shapeCuller;
+        // How the frame being recorded draws, read by the recording threads
+        bool indirectFrame = false;
+        bool culledShapesFrame = false;
 
-        vk::Format swapchainImageFormat;
-        vk::Extent2D swapchainExtent;
+        vk::raii::DebugUtilsMessengerEXT debugMessenger{VK_NULL_HANDLE};
 
-        std::vector<vk::raii::Framebuffer> swapchainFramebuffers;
-        vk::raii::RenderPass renderPass{VK_NULL_HANDLE};
+        std::vector<const char*> getRequiredInstanceExtensions();
+        bool isDeviceSuitable(vk::raii::PhysicalDevice& physicalDev, vk::raii::SurfaceKHR& surf);
+        void initVulkan();
 
-        // Frame info
-        std::vector<vk::raii::Image> depthImages;
-        std::vector<vk::raii::DeviceMemory> depthImageMemorys;
-        std::vector<vk::raii::ImageView> depthImageViews;
-        std::vector<vk::Image> swapchainImages;
-        std::vector<vk::raii::ImageView> swapchainImageViews;
-        std::vector<vk::raii::Semaphore> imageAvailableSemaphores;
-        std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
-        std::vector<vk::raii::Fence> imageInFlightFences;
+        FrameSlot& beginFrame(Renderer& renderer);
+        // Returns false if the frame was skipped because nothing changed
+        bool endFrame(FrameSlot& frame, Renderer& renderer);
+        // Returns false while the window is minimized
+        bool recreateSwapchain();
+        void recordCommandBuffer(FrameSlot& frame, const Renderer& renderer, uint32_t imageIndex);
+        void buildFrameGraph(uint32_t imageIndex, FrameGraphCallback mainPass, vk::SubpassContents contents);
+        void bindFrameGeometry(const vk::raii::CommandBuffer& cmd, const FrameSlot& frame);
+        // firstBatch is the index of batches[0] in the frame, it locates their indirect commands
+        void recordBatches(const vk::raii::CommandBuffer& cmd, const FrameSlot& frame, std::span<const DrawBatch> batches,
+                           uint32_t firstBatch, bool profileBatches);
+        [[nodiscard]] PipelineKey getPipelineKey(const DrawState& state) const;
+        [[nodiscard]] vk::Rect2D getScissor(const ClipRect& clip) const;
+        // Rebuilds the pipelines of programs whose shader sources changed, see IMR_SHADER_HOT_RELOAD
+        void reloadShaders();
+        // Hands the target's finished readback to the image writer, its frame must be complete
+        void writeCapture(uint32_t imageIndex);
+        // Writes the captures still sitting in the targets and waits for the writer, after the device went idle
+        void finishBatch();
 
-        std::vector<vk::raii::CommandBuffer> commandBuffers;
+    protected:
+        void requestClose() { this->closeRequested = true; }
 
-        vk::Extent2D windowExtent;
+        [[nodiscard]] bool isHeadless() const { return this->config.headless; }
+        [[nodiscard]] uint64_t getFrameCount() const { return this->frameCount; }
+        [[nodiscard]] uint64_t getSkippedFrameCount() const { return this->skippedFrameCount; }
+        [[nodiscard]] const CpuProfiler& getStartupProfile() const { return this->startupProfiler; }
+        [[nodiscard]] const GpuProfiler& getGpuProfiler() const { return this->gpuProfiler; }
+        [[nodiscard]] const LatencyStats& getLatencyStats() const { return this->framePacer.getStats(); }
 
-        vk::raii::SwapchainKHR swapchain{VK_NULL_HANDLE};
+        // Loads in the background, draws with the returned handle show a placeholder until it is resident
+        TextureHandle loadTexture(std::filesystem::path path) { return this->textureStreamer->load(std::move(path)); }
+        TextureHandle loadTexture(ImageData image) { return this->textureStreamer->load(std::move(image)); }
 
-        vk::raii::PipelineLayout pipelineLayout{VK_NULL_HANDLE};
-        vk::raii::Pipeline pipeline{VK_NULL_HANDLE};
-        vk::raii::ShaderModule vertexShaderModule{VK_NULL_HANDLE};
-        vk::raii::ShaderModule fragmentShaderModule{VK_NULL_HANDLE};
+        // Waits for the last submitted frame and returns its pixels, headless only
+        FrameCapture readback();
 
-        vk::raii::DebugUtilsMessengerEXT debugMessenger{VK_NULL_HANDLE};
+    public:
 
-        uint32_t currentFrame = 0;
+        virtual void onDraw(Renderer& renderer) {
 
-        std::vector<const char*> getGlfwRequiredExtensions();
-        bool isDeviceSuitable(vk::raii::PhysicalDevice& physicalDev, vk::raii::SurfaceKHR& surf);
-        void initVulkan();
+        }
 
-    public:
+        // After every frame, submitted or not
+        virtual void onFrameEnd(const FrameStats& stats) {
 
-        virtual void onDraw(Renderer& renderer) {
+        }
 
+        bool isRunning() {
+            if (this->closeRequested) return false;
+            if (this->config.maxFrames != 0 && this->frameCount >= this->config.maxFrames) return false;
+
+            return this->config.headless || !glfwWindowShouldClose(this->window);
         }
 
         void onFrame(Renderer& renderer) {
-            // process events
+#ifdef IMR_SHADER_HOT_RELOAD
+            // Checking a few timestamps is cheap, but there's no need to do it every frame
+            if (this->frameCount % 30 == 0) reloadShaders();
+#endif
 
+            this->framePacer.waitForFrame();
+            uint64_t allocationsBefore = getAllocationCount();
 
             // draw frame
-            //renderer.begin();
+            FrameSlot& frame = beginFrame(renderer);
+
+            // process events, after beginFrame waited for the slot so the frame sees the newest input
+            if (!this->config.headless) glfwPollEvents();
+            this->inputTime = FramePacer::Clock::now();
+
             onDraw(renderer);
-            //renderer.end();
+            bool submitted = endFrame(frame, renderer);
+
+            this->frameStats.submitted = submitted;
+            this->frameStats.cpuMs = std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - this->frameStart).count();
+            this->frameStats.drawCalls = this->drawCallCount.load(std::memory_order_relaxed);
+            this->frameStats.allocations = getAllocationCount() - allocationsBefore;
+            this->frameStats.arenaBytes = this->frameArena.getUsed();
+
+            if (isAllocationCountingEnabled() && this->config.allocationFreeAfterFrames != 0 &&
+                this->frameCount >= this->config.allocationFreeAfterFrames && this->frameStats.allocations != 0) {
+                throw std::runtime_error("Frame " + std::to_string(this->frameCount) + " made " +
+                                         std::to_string(this->frameStats.allocations) + " heap allocations");
+            }
+
+            onFrameEnd(this->frameStats);
+
+            this->frameCount++;
+
+            if (!submitted && !this->config.headless) glfwWaitEventsTimeout(this->config.idleWaitSeconds);
         }
 
         void run() {
             Renderer renderer;
+            this->batchStart = std::chrono::steady_clock::now();
 
-            while(!glfwWindowShouldClose(this->window)) {
+            while(isRunning()) {
                 onFrame(renderer);
             }
+
+            this->device.waitIdle();
+
+            if (this->imageWriter) finishBatch();
+            if (this->config.printLatencySummary) reportLatency();
         }
     };
 
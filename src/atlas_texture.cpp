@@ -0,0 +1,100 @@
+#include "atlas_texture.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace imr {
+
+    AtlasTexture::AtlasTexture(const vk::raii::Device &device, DeviceMemoryAllocator &allocator, vk::Extent2D extent) : extent(extent) {
+        vk::ImageCreateInfo imageInfo {
+                {},
+                vk::ImageType::e2D,
+                Format,
+                vk::Extent3D(extent.width, extent.height, 1),
+                1, 1,
+                vk::SampleCountFlagBits::e1,
+                vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+                vk::SharingMode::eExclusive, 0, nullptr,
+                vk::ImageLayout::eUndefined
+        };
+
+        this->image = device.createImage(imageInfo);
+        this->imageMemory = allocator.bind(this->image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::ImageViewCreateInfo viewInfo {
+                {},
+                *this->image,
+                vk::ImageViewType::e2D,
+                Format,
+                {},
+                {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+        };
+
+        this->view = device.createImageView(viewInfo);
+
+        // Glyphs are drawn at whole multiples of their bitmap size, nearest keeps them sharp
+        vk::SamplerCreateInfo samplerInfo {
+                {},
+                vk::Filter::eNearest, vk::Filter::eNearest,
+                vk::SamplerMipmapMode::eNearest,
+                vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge
+        };
+
+        this->sampler = device.createSampler(samplerInfo);
+    }
+
+    void AtlasTexture::recordUpload(const vk::raii::CommandBuffer &cmd, FrameSlot &frame, GlyphAtlas &atlas) {
+        auto dirty = atlas.takeDirtyRect();
+        if (!dirty) return;
+
+        vk::DeviceSize size = static_cast<vk::DeviceSize>(dirty->width) * dirty->height;
+        auto staging = frame.allocateTransient(size, 4);
+        if (!staging) throw std::runtime_error("Glyph atlas upload doesn't fit into the frame's transient memory");
+
+        auto pixels = atlas.getPixels();
+        for (uint32_t row = 0; row < dirty->height; row++) {
+            std::memcpy(static_cast<uint8_t*>(staging->mapped) + static_cast<size_t>(row) * dirty->width,
+                        pixels.data() + static_cast<size_t>(dirty->y + row) * atlas.getWidth() + dirty->x,
+                        dirty->width);
+        }
+
+        vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+
+        vk::ImageMemoryBarrier toTransfer {
+                {},
+                vk::AccessFlagBits::eTransferWrite,
+                this->initialized ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eTransferDstOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                *this->image,
+                range
+        };
+
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+
+        vk::BufferImageCopy region {
+                staging->offset, dirty->width, dirty->height,
+                {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                {static_cast<int32_t>(dirty->x), static_cast<int32_t>(dirty->y), 0},
+                {dirty->width, dirty->height, 1}
+        };
+
+        cmd.copyBufferToImage(*frame.uploadBuffer, *this->image, vk::ImageLayout::eTransferDstOptimal, region);
+
+        vk::ImageMemoryBarrier toShader {
+                vk::AccessFlagBits::eTransferWrite,
+                vk::AccessFlagBits::eShaderRead,
+                vk::ImageLayout::eTransferDstOptimal,
+                vk::ImageLayout::eShaderReadOnlyOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                *this->image,
+                range
+        };
+
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, toShader);
+
+        this->initialized = true;
+    }
+
+} // imr
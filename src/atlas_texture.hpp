@@ -0,0 +1,40 @@
+#ifndef VK_IMM_RENDERER_ATLAS_TEXTURE_HPP
+#define VK_IMM_RENDERER_ATLAS_TEXTURE_HPP
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "frame_ring.hpp"
+#include "glyph_atlas.hpp"
+#include "memory_allocator.hpp"
+
+namespace imr {
+
+    // GPU copy of a GlyphAtlas, kept in sync by uploading the dirty region through the frame's transient memory
+    class AtlasTexture {
+    public:
+        static constexpr vk::Format Format = vk::Format::eR8Unorm;
+
+        AtlasTexture() = default;
+        AtlasTexture(const vk::raii::Device& device, DeviceMemoryAllocator& allocator, vk::Extent2D extent);
+
+        // Has to be recorded outside a render pass. Earlier frames still sampling the old contents are
+        // ordered before the copy by the barrier, so nothing has to wait on the CPU.
+        void recordUpload(const vk::raii::CommandBuffer& cmd, FrameSlot& frame, GlyphAtlas& atlas);
+
+        [[nodiscard]] vk::ImageView getView() const { return *this->view; }
+        [[nodiscard]] vk::Sampler getSampler() const { return *this->sampler; }
+
+    private:
+        vk::Extent2D extent;
+
+        vk::raii::Image image{VK_NULL_HANDLE};
+        MemoryAllocation imageMemory;
+        vk::raii::ImageView view{VK_NULL_HANDLE};
+        vk::raii::Sampler sampler{VK_NULL_HANDLE};
+
+        bool initialized = false;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_ATLAS_TEXTURE_HPP
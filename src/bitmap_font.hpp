@@ -0,0 +1,36 @@
+#ifndef VK_IMM_RENDERER_BITMAP_FONT_HPP
+#define VK_IMM_RENDERER_BITMAP_FONT_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace imr {
+
+    // Fixed cell 1 bit font, one byte per row with bit 0 as the leftmost pixel.
+    // Glyphs are scaled by whole multiples of the cell so they stay crisp.
+    struct BitmapFont {
+        uint32_t cellWidth = 8;
+        uint32_t cellHeight = 8;
+        uint32_t firstCodepoint = 0;
+        uint32_t glyphCount = 0;
+        // Drawn for codepoints the font doesn't cover
+        uint32_t fallbackCodepoint = '?';
+        std::span<const uint8_t> rows;
+
+        [[nodiscard]] bool contains(uint32_t codepoint) const {
+            return codepoint >= this->firstCodepoint && codepoint - this->firstCodepoint < this->glyphCount;
+        }
+
+        [[nodiscard]] uint32_t getScale(float pixelSize) const;
+
+        // Writes the glyph as 8 bit coverage at cellWidth * scale by cellHeight * scale, returns false for empty glyphs
+        bool rasterize(uint32_t codepoint, uint32_t scale, std::vector<uint8_t>& pixels) const;
+
+        // font8x8_basic by Daniel Hepper (public domain), printable ASCII
+        static const BitmapFont& builtin();
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_BITMAP_FONT_HPP
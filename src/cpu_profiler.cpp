@@ -0,0 +1,111 @@
+#include "cpu_profiler.hpp"
+
+#include <atomic>
+#include <iomanip>
+#include <algorithm>
+
+namespace imr {
+
+    // Zones currently open on this thread, gives the nesting depth without a per thread stack
+    static thread_local uint32_t openZones = 0;
+
+    int64_t CpuProfiler::now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - this->origin).count();
+    }
+
+    uint32_t CpuProfiler::threadIndex() {
+        static std::atomic<uint32_t> nextIndex = 0;
+        static thread_local uint32_t index = nextIndex++;
+        return index;
+    }
+
+    uint32_t CpuProfiler::begin(std::string_view name) {
+        CpuZone zone;
+        zone.name = name;
+        zone.depth = openZones++;
+        zone.thread = threadIndex();
+        zone.start = now();
+
+        std::scoped_lock lock(this->mutex);
+        this->zones.push_back(std::move(zone));
+        return static_cast<uint32_t>(this->zones.size() - 1);
+    }
+
+    void CpuProfiler::end(uint32_t zone) {
+        int64_t endTime = now();
+        openZones--;
+
+        std::scoped_lock lock(this->mutex);
+        this->zones[zone].duration = endTime - this->zones[zone].start;
+    }
+
+    std::vector<CpuZone> CpuProfiler::getZones() const {
+        std::scoped_lock lock(this->mutex);
+        return this->zones;
+    }
+
+    std::optional<double> CpuProfiler::getDurationMs(std::string_view name) const {
+        std::scoped_lock lock(this->mutex);
+
+        std::optional<double> total;
+        for (const auto& zone : this->zones) {
+            if (zone.name == name) total = total.value_or(0.0) + static_cast<double>(zone.duration) / 1e6;
+        }
+
+        return total;
+    }
+
+    void CpuProfiler::writeChromeTrace(std::ostream &out) const {
+        auto zonesCopy = getZones();
+
+        auto writeEscaped = [&out](const std::string& text) {
+            for (char c : text) {
+                if (c == '"' || c == '\\') out << '\\';
+                out << c;
+            }
+        };
+
+        std::ios oldState(nullptr);
+        oldState.copyfmt(out);
+
+        out << "{\"traceEvents\":[";
+        for (size_t i = 0; i < zonesCopy.size(); i++) {
+            const auto& zone = zonesCopy[i];
+
+            out << (i == 0 ? "" : ",") << "\n{\"name\":\"";
+            writeEscaped(zone.name);
+            out << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << zone.thread
+                << std::fixed << std::setprecision(3)
+                << ",\"ts\":" << static_cast<double>(zone.start) / 1e3
+                << ",\"dur\":" << static_cast<double>(zone.duration) / 1e3 << "}";
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        out.copyfmt(oldState);
+    }
+
+    void CpuProfiler::writeSummary(std::ostream &out) const {
+        auto zonesCopy = getZones();
+
+        int64_t rootTotal = 0;
+        for (const auto& zone : zonesCopy) {
+            if (zone.depth == 0) rootTotal += zone.duration;
+        }
+
+        std::ios oldState(nullptr);
+        oldState.copyfmt(out);
+
+        out << std::fixed << std::setprecision(3);
+        for (const auto& zone : zonesCopy) {
+            double ms = static_cast<double>(zone.duration) / 1e6;
+            double percent = rootTotal > 0 ? 100.0 * static_cast<double>(zone.duration) / static_cast<double>(rootTotal) : 0.0;
+
+            out << std::string(zone.depth * 2, ' ') << std::left << std::setw(static_cast<int>(32 - std::min<uint32_t>(zone.depth * 2, 30)))
+                << zone.name << std::right << std::setw(10) << ms << " ms" << std::setw(8) << std::setprecision(1) << percent << " %\n"
+                << std::setprecision(3);
+        }
+
+        out.copyfmt(oldState);
+    }
+
+} // imr
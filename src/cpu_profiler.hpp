@@ -0,0 +1,87 @@
+#ifndef VK_IMM_RENDERER_CPU_PROFILER_HPP
+#define VK_IMM_RENDERER_CPU_PROFILER_HPP
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <ostream>
+#include <optional>
+#include <cstdint>
+#include <string_view>
+
+namespace imr {
+
+    struct CpuZone {
+        std::string name;
+        // Nanoseconds since the profiler was created
+        int64_t start = 0;
+        int64_t duration = 0;
+        uint32_t depth = 0;
+        uint32_t thread = 0;
+    };
+
+    // Collects CPU timestamps for named zones, meant for coarse scopes like startup stages rather than per draw work
+    class CpuProfiler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        CpuProfiler() : origin(Clock::now()) {}
+
+        // Returns a zone index to pass to end()
+        uint32_t begin(std::string_view name);
+        void end(uint32_t zone);
+
+        [[nodiscard]] std::vector<CpuZone> getZones() const;
+        // Summed duration of all zones with that name in milliseconds
+        [[nodiscard]] std::optional<double> getDurationMs(std::string_view name) const;
+
+        // Chrome trace event format, open with chrome://tracing or ui.perfetto.dev
+        void writeChromeTrace(std::ostream& out) const;
+        void writeSummary(std::ostream& out) const;
+
+    private:
+        Clock::time_point origin;
+
+        mutable std::mutex mutex;
+        std::vector<CpuZone> zones;
+
+        [[nodiscard]] int64_t now() const;
+        static uint32_t threadIndex();
+    };
+
+    class ScopedTimer {
+    public:
+        ScopedTimer(CpuProfiler& profiler, std::string_view name) : profiler(profiler), zone(profiler.begin(name)) {}
+        ~ScopedTimer() { this->profiler.end(this->zone); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        CpuProfiler& profiler;
+        uint32_t zone;
+    };
+
+    // Times consecutive stages of one long function, next() closes the running stage and opens the following one
+    class StageTimer {
+    public:
+        StageTimer(CpuProfiler& profiler, std::string_view firstStage) : profiler(profiler), zone(profiler.begin(firstStage)) {}
+        ~StageTimer() { this->profiler.end(this->zone); }
+
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+        void next(std::string_view stage) {
+            this->profiler.end(this->zone);
+            this->zone = this->profiler.begin(stage);
+        }
+
+    private:
+        CpuProfiler& profiler;
+        uint32_t zone;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_CPU_PROFILER_HPP
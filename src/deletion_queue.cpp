@@ -0,0 +1,29 @@
+#include "deletion_queue.hpp"
+
+#include <stdexcept>
+
+namespace imr {
+
+    void DeletionQueue::retire(uint64_t frame, std::move_only_function<void()> deleter) {
+        if (!this->entries.empty() && this->entries.back().frame > frame) {
+            throw std::runtime_error("DeletionQueue frames have to be retired in order");
+        }
+
+        this->entries.push_back({frame, std::move(deleter)});
+    }
+
+    void DeletionQueue::collect(uint64_t completedFrame) {
+        while (!this->entries.empty() && this->entries.front().frame <= completedFrame) {
+            // Popped before running, a throwing deleter doesn't run twice
+            Entry entry = std::move(this->entries.front());
+            this->entries.pop_front();
+
+            entry.deleter();
+        }
+    }
+
+    void DeletionQueue::flush() {
+        collect(UINT64_MAX);
+    }
+
+} // imr
@@ -0,0 +1,42 @@
+#ifndef VK_IMM_RENDERER_DELETION_QUEUE_HPP
+#define VK_IMM_RENDERER_DELETION_QUEUE_HPP
+
+#include <deque>
+#include <cstdint>
+#include <functional>
+
+namespace imr {
+
+    // Defers destroying resources until the GPU has finished every frame that could still use them,
+    // so replacing something doesn't need a vkDeviceWaitIdle
+    class DeletionQueue {
+    public:
+        DeletionQueue() = default;
+        DeletionQueue(DeletionQueue&&) noexcept = default;
+        DeletionQueue& operator=(DeletionQueue&&) noexcept = default;
+
+        // Runs everything still queued, the device has to be idle by then
+        ~DeletionQueue() { flush(); }
+
+        // Runs the deleter once frame has completed. Resources moved into it are destroyed together with it.
+        // Frames have to be retired in order.
+        void retire(uint64_t frame, std::move_only_function<void()> deleter);
+
+        // Runs the deleters of every frame up to and including completedFrame
+        void collect(uint64_t completedFrame);
+        void flush();
+
+        [[nodiscard]] size_t size() const { return this->entries.size(); }
+
+    private:
+        struct Entry {
+            uint64_t frame;
+            std::move_only_function<void()> deleter;
+        };
+
+        std::deque<Entry> entries;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_DELETION_QUEUE_HPP
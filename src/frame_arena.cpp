@@ -0,0 +1,34 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+
+namespace imr {
+
+    FrameArena::FrameArena(size_t initialBytes) :
+            block(std::make_unique_for_overwrite<std::byte[]>(std::max<size_t>(initialBytes, 1))), blockSize(std::max<size_t>(initialBytes, 1)) {}
+
+    void *FrameArena::allocateOverflow(size_t size, size_t alignment) {
+        // Counted with the padding the alignment may need, so the merged block is sure to fit the whole frame
+        size_t bytes = size + alignment - 1;
+        this->overflow.push_back(std::make_unique_for_overwrite<std::byte[]>(std::max<size_t>(bytes, 1)));
+        this->overflowBytes += bytes;
+
+        auto base = reinterpret_cast<uintptr_t>(this->overflow.back().get());
+        return reinterpret_cast<void*>((base + alignment - 1) & ~(alignment - 1));
+    }
+
+    void FrameArena::reset() {
+        if (!this->overflow.empty()) {
+            // Grown to the whole frame with some headroom, the next frame of this size fits without overflowing
+            size_t required = this->head + this->overflowBytes;
+            this->blockSize = std::max(this->blockSize * 2, required + required / 2);
+            this->block = std::make_unique_for_overwrite<std::byte[]>(this->blockSize);
+
+            this->overflow.clear();
+            this->overflowBytes = 0;
+        }
+
+        this->head = 0;
+    }
+
+} // imr
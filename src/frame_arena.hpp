@@ -0,0 +1,91 @@
+#ifndef VK_IMM_RENDERER_FRAME_ARENA_HPP
+#define VK_IMM_RENDERER_FRAME_ARENA_HPP
+
+#include <span>
+#include <new>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace imr {
+
+    // Bump allocator for the CPU side scratch data of one frame, released all at once by reset(). A frame that
+    // outgrows the block gets overflow blocks, reset() then replaces everything with one block large enough for
+    // that frame, so once the frames stop growing the arena never touches the heap. Nothing allocated here is
+    // destructed, only trivially destructible objects or storage of the containers below belong into it.
+    class FrameArena {
+    public:
+        explicit FrameArena(size_t initialBytes = 64 << 10);
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        void* allocate(size_t size, size_t alignment) {
+            uintptr_t base = reinterpret_cast<uintptr_t>(this->block.get());
+            size_t offset = ((base + this->head + alignment - 1) & ~(alignment - 1)) - base;
+
+            if (offset + size > this->blockSize) return allocateOverflow(size, alignment);
+
+            this->head = offset + size;
+            return this->block.get() + offset;
+        }
+
+        // Value initialized
+        template<typename T>
+        std::span<T> allocateArray(size_t count) {
+            static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+
+            T* items = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+            for (size_t i = 0; i < count; i++) new (items + i) T();
+            return {items, count};
+        }
+
+        // Everything allocated since the last reset is gone, containers using it have to be cleared or dropped first
+        void reset();
+
+        // Since the last reset, overflow blocks included
+        [[nodiscard]] size_t getUsed() const { return this->head + this->overflowBytes; }
+        [[nodiscard]] size_t getCapacity() const { return this->blockSize; }
+
+    private:
+        std::unique_ptr<std::byte[]> block;
+        size_t blockSize = 0;
+        size_t head = 0;
+
+        std::vector<std::unique_ptr<std::byte[]>> overflow;
+        size_t overflowBytes = 0;
+
+        void* allocateOverflow(size_t size, size_t alignment);
+    };
+
+    // Standard allocator over a FrameArena, deallocating is a no-op. Containers using it may only live for the frame.
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+        T* allocate(size_t count) { return static_cast<T*>(this->arena->allocate(sizeof(T) * count, alignof(T))); }
+        void deallocate(T*, size_t) {}
+
+        [[nodiscard]] FrameArena* getArena() const { return this->arena; }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return this->arena == other.getArena(); }
+
+    private:
+        FrameArena* arena;
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // imr
+
+#endif //VK_IMM_RENDERER_FRAME_ARENA_HPP
@@ -0,0 +1,369 @@
+#include "frame_graph.hpp"
+
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    namespace {
+
+        struct AccessInfo {
+            vk::ImageLayout layout;
+            vk::PipelineStageFlags stage;
+            vk::AccessFlags access;
+            vk::ImageUsageFlags usage;
+            bool write;
+        };
+
+        AccessInfo getAccessInfo(ImageAccess access) {
+            switch (access) {
+                case ImageAccess::eColorAttachment:
+                    return {vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+                            vk::ImageUsageFlagBits::eColorAttachment, true};
+                case ImageAccess::eDepthAttachment:
+                    return {vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                            vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                            vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                            vk::ImageUsageFlagBits::eDepthStencilAttachment, true};
+                case ImageAccess::eSampled:
+                    return {vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader,
+                            vk::AccessFlagBits::eShaderRead, vk::ImageUsageFlagBits::eSampled, false};
+                case ImageAccess::eTransferSrc:
+                    return {vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTransfer,
+                            vk::AccessFlagBits::eTransferRead, vk::ImageUsageFlagBits::eTransferSrc, false};
+                case ImageAccess::eTransferDst:
+                    return {vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eTransfer,
+                            vk::AccessFlagBits::eTransferWrite, vk::ImageUsageFlagBits::eTransferDst, true};
+            }
+            throw std::runtime_error("Unknown image access");
+        }
+
+        bool isAttachment(ImageAccess access) {
+            return access == ImageAccess::eColorAttachment || access == ImageAccess::eDepthAttachment;
+        }
+
+        // Reads of an attachment are only its load, they don't need to be made available to anyone
+        constexpr vk::AccessFlags WriteAccess = vk::AccessFlagBits::eColorAttachmentWrite |
+                                                vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                                                vk::AccessFlagBits::eTransferWrite;
+
+        struct ResourceState {
+            vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+            vk::PipelineStageFlags writeStage;
+            vk::AccessFlags writeAccess;
+            // Stages that read since the last write, and stages the last write has been made visible to
+            vk::PipelineStageFlags readStages;
+            vk::PipelineStageFlags visibleStages;
+        };
+
+    }
+
+    void FrameGraph::reset() {
+        this->passes.clear();
+        this->resources.clear();
+        this->compiled.passes.clear();
+        this->compiled.finalBarriers.clear();
+        this->compiled.transients.clear();
+    }
+
+    FrameGraphResource FrameGraph::createImage(const TransientImageDesc &desc) {
+        this->resources.push_back({false, desc, {}});
+        return static_cast<FrameGraphResource>(this->resources.size() - 1);
+    }
+
+    FrameGraphResource FrameGraph::importImage(const ImportedImage &image) {
+        this->resources.push_back({true, {image.format, image.extent}, image});
+        return static_cast<FrameGraphResource>(this->resources.size() - 1);
+    }
+
+    FrameGraphPass FrameGraph::addPass(const char *name, FrameGraphCallback callback, vk::SubpassContents contents) {
+        this->passes.push_back({name, callback, contents, ArenaVector<Access>(ArenaAllocator<Access>(*this->arena)), false});
+        return static_cast<FrameGraphPass>(this->passes.size() - 1);
+    }
+
+    void FrameGraph::writeColor(FrameGraphPass pass, FrameGraphResource resource, std::optional<vk::ClearColorValue> clear) {
+        addAccess(pass, resource, ImageAccess::eColorAttachment, clear ? std::optional<vk::ClearValue>(*clear) : std::nullopt);
+    }
+
+    void FrameGraph::writeDepth(FrameGraphPass pass, FrameGraphResource resource, std::optional<vk::ClearDepthStencilValue> clear) {
+        addAccess(pass, resource, ImageAccess::eDepthAttachment, clear ? std::optional<vk::ClearValue>(*clear) : std::nullopt);
+    }
+
+    void FrameGraph::sample(FrameGraphPass pass, FrameGraphResource resource) {
+        addAccess(pass, resource, ImageAccess::eSampled, std::nullopt);
+    }
+
+    void FrameGraph::copyFrom(FrameGraphPass pass, FrameGraphResource resource) {
+        addAccess(pass, resource, ImageAccess::eTransferSrc, std::nullopt);
+    }
+
+    void FrameGraph::copyTo(FrameGraphPass pass, FrameGraphResource resource) {
+        addAccess(pass, resource, ImageAccess::eTransferDst, std::nullopt);
+    }
+
+    void FrameGraph::keepAlive(FrameGraphPass pass) {
+        this->passes.at(pass).keepAlive = true;
+    }
+
+    void FrameGraph::addAccess(FrameGraphPass pass, FrameGraphResource resource, ImageAccess access, std::optional<vk::ClearValue> clear) {
+        if (resource >= this->resources.size()) throw std::runtime_error("Unknown frame graph resource");
+
+        auto& accesses = this->passes.at(pass).accesses;
+        if (std::ranges::any_of(accesses, [resource](const Access& a) { return a.resource == resource; })) {
+            throw std::runtime_error("A pass can only access a frame graph resource once");
+        }
+
+        accesses.push_back({resource, access, clear});
+    }
+
+    vk::Format FrameGraph::getFormat(FrameGraphResource resource) const {
+        return this->resources[resource].desc.format;
+    }
+
+    vk::Extent2D FrameGraph::getExtent(FrameGraphResource resource) const {
+        return this->resources[resource].desc.extent;
+    }
+
+    const CompiledFrameGraph &FrameGraph::compile() {
+        this->compiled.passes.clear();
+        this->compiled.finalBarriers.clear();
+        this->compiled.transients.clear();
+
+        // Culling, backwards: a pass survives if something later needs what it writes. A cleared attachment
+        // doesn't need what was there before, so the writers in front of it can go.
+        ArenaAllocator<bool> scratch(*this->arena);
+        ArenaVector<bool> needed(this->resources.size(), false, scratch);
+        for (size_t i = 0; i < this->resources.size(); i++) {
+            needed[i] = this->resources[i].imported && this->resources[i].import.output;
+        }
+
+        ArenaVector<bool> alive(this->passes.size(), false, scratch);
+        for (size_t p = this->passes.size(); p-- > 0;) {
+            const Pass& pass = this->passes[p];
+
+            alive[p] = pass.keepAlive || std::ranges::any_of(pass.accesses, [&](const Access& a) {
+                return getAccessInfo(a.access).write && needed[a.resource];
+            });
+            if (!alive[p]) continue;
+
+            for (const auto& access : pass.accesses) {
+                if (access.clear) needed[access.resource] = false;
+            }
+            for (const auto& access : pass.accesses) {
+                if (!access.clear) needed[access.resource] = true;
+            }
+        }
+
+        for (size_t p = 0; p < this->passes.size(); p++) {
+            if (alive[p]) this->compiled.passes.push_back({static_cast<FrameGraphPass>(p), ArenaVector<FrameGraphBarrier>(scratch), ArenaVector<FrameGraphAttachment>(scratch), {}});
+        }
+        this->compiled.culledPassCount = static_cast<uint32_t>(this->passes.size() - this->compiled.passes.size());
+
+        // Lifetimes and usage of the transients that survived
+        constexpr uint32_t Unused = UINT32_MAX;
+        ArenaVector<CompiledTransient> transients(this->resources.size(), {0, Unused, 0, {}, true}, scratch);
+        ArenaVector<uint32_t> useCount(this->resources.size(), 0, scratch);
+        ArenaVector<uint32_t> lastAccess(this->resources.size(), Unused, scratch);
+
+        for (uint32_t c = 0; c < this->compiled.passes.size(); c++) {
+            for (const auto& access : this->passes[this->compiled.passes[c].pass].accesses) {
+                CompiledTransient& transient = transients[access.resource];
+                if (transient.firstUse == Unused) transient.firstUse = c;
+                transient.lastUse = c;
+                transient.usage |= getAccessInfo(access.access).usage;
+                transient.lazy = transient.lazy && isAttachment(access.access);
+
+                useCount[access.resource]++;
+                lastAccess[access.resource] = c;
+            }
+        }
+
+        // Aliased transients and the previous frame's use of the same memory have to finish before a transient
+        // starts over. Everything that may share memory is waited for, the exact placement isn't known yet.
+        vk::PipelineStageFlags aliasedStages;
+        vk::AccessFlags aliasedAccess;
+
+        for (FrameGraphResource r = 0; r < this->resources.size(); r++) {
+            CompiledTransient& transient = transients[r];
+            transient.resource = r;
+            transient.lazy = transient.lazy && useCount[r] == 1;
+            if (this->resources[r].imported || transient.firstUse == Unused) continue;
+
+            if (transient.lazy) transient.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+            this->compiled.transients.push_back(transient);
+        }
+
+        ArenaVector<vk::PipelineStageFlags> usedStages(this->resources.size(), scratch);
+        ArenaVector<vk::AccessFlags> usedWrites(this->resources.size(), scratch);
+        for (const auto& compiledPass : this->compiled.passes) {
+            for (const auto& access : this->passes[compiledPass.pass].accesses) {
+                AccessInfo info = getAccessInfo(access.access);
+                usedStages[access.resource] |= info.stage;
+                if (info.write) usedWrites[access.resource] |= info.access & WriteAccess;
+            }
+        }
+        for (const auto& transient : this->compiled.transients) {
+            if (transient.lazy) continue;
+            aliasedStages |= usedStages[transient.resource];
+            aliasedAccess |= usedWrites[transient.resource];
+        }
+
+        ArenaVector<ResourceState> states(this->resources.size(), scratch);
+        for (FrameGraphResource r = 0; r < this->resources.size(); r++) {
+            const Resource& resource = this->resources[r];
+            ResourceState& state = states[r];
+
+            if (resource.imported) {
+                state.layout = resource.import.initialLayout;
+                state.writeStage = resource.import.initialStage;
+            } else if (transients[r].lazy) {
+                state.writeStage = usedStages[r];
+                state.writeAccess = usedWrites[r];
+            } else {
+                state.writeStage = aliasedStages;
+                state.writeAccess = aliasedAccess;
+            }
+        }
+
+        // Barriers and attachments, forwards
+        for (uint32_t c = 0; c < this->compiled.passes.size(); c++) {
+            CompiledPass& compiledPass = this->compiled.passes[c];
+            const Pass& pass = this->passes[compiledPass.pass];
+
+            for (const auto& access : pass.accesses) {
+                AccessInfo info = getAccessInfo(access.access);
+                ResourceState& state = states[access.resource];
+
+                // Cleared attachments and anything never written before start from undefined contents
+                bool discard = access.clear.has_value() || state.layout == vk::ImageLayout::eUndefined;
+
+                bool barrier = state.layout != info.layout || discard;
+                if (info.write) barrier = barrier || state.writeAccess || state.readStages;
+                else barrier = barrier || (state.writeAccess && (state.visibleStages & info.stage) != info.stage);
+
+                if (barrier) {
+                    vk::PipelineStageFlags srcStage = state.writeStage | state.readStages;
+                    if (!srcStage) srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
+
+                    compiledPass.barriers.push_back({
+                            access.resource,
+                            discard ? vk::ImageLayout::eUndefined : state.layout, info.layout,
+                            srcStage, info.stage,
+                            state.writeAccess, info.access
+                    });
+                }
+
+                if (isAttachment(access.access)) {
+                    bool storeNeeded = lastAccess[access.resource] != c || this->resources[access.resource].imported;
+
+                    compiledPass.attachments.push_back({
+                            access.resource,
+                            access.clear ? vk::AttachmentLoadOp::eClear : discard ? vk::AttachmentLoadOp::eDontCare : vk::AttachmentLoadOp::eLoad,
+                            storeNeeded ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
+                            info.layout,
+                            access.clear.value_or(vk::ClearValue{})
+                    });
+                    compiledPass.extent = getExtent(access.resource);
+                }
+
+                state.layout = info.layout;
+                if (info.write) {
+                    state.writeStage = info.stage;
+                    state.writeAccess = info.access & WriteAccess;
+                    state.readStages = {};
+                    state.visibleStages = {};
+                } else {
+                    state.readStages |= info.stage;
+                    if (barrier) state.visibleStages |= info.stage;
+                }
+            }
+
+            // The depth attachment goes last, the executor's render passes expect it there. Rotated rather than
+            // stable_partition, which would take a heap buffer every frame.
+            auto depth = std::ranges::find(compiledPass.attachments, vk::ImageLayout::eDepthStencilAttachmentOptimal, &FrameGraphAttachment::layout);
+            if (depth != compiledPass.attachments.end()) std::rotate(depth, depth + 1, compiledPass.attachments.end());
+        }
+
+        for (FrameGraphResource r = 0; r < this->resources.size(); r++) {
+            const Resource& resource = this->resources[r];
+            const ResourceState& state = states[r];
+            if (!resource.imported || resource.import.finalLayout == vk::ImageLayout::eUndefined) continue;
+            if (resource.import.finalLayout == state.layout && !state.writeAccess) continue;
+
+            vk::PipelineStageFlags srcStage = state.writeStage | state.readStages;
+            this->compiled.finalBarriers.push_back({
+                    r,
+                    state.layout, resource.import.finalLayout,
+                    srcStage ? srcStage : vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eBottomOfPipe,
+                    state.writeAccess, {}
+            });
+        }
+
+        return this->compiled;
+    }
+
+    std::pair<std::vector<vk::DeviceSize>, vk::DeviceSize> packTransientMemory(std::span<const TransientMemoryRequest> requests) {
+        std::vector<vk::DeviceSize> offsets(requests.size(), 0);
+        vk::DeviceSize totalSize = 0;
+
+        // Largest first, the small ones fill the gaps between them
+        std::vector<size_t> order(requests.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, [&](size_t a, size_t b) { return requests[a].size > requests[b].size; });
+
+        std::vector<size_t> placed;
+        for (size_t i : order) {
+            const TransientMemoryRequest& request = requests[i];
+            auto align = [&](vk::DeviceSize offset) { return (offset + request.alignment - 1) / request.alignment * request.alignment; };
+
+            auto overlapsInTime = [&](size_t other) {
+                return requests[other].firstUse <= request.lastUse && request.firstUse <= requests[other].lastUse;
+            };
+
+            // Lowest offset that doesn't collide with a placed transient alive at the same time. The candidates
+            // are the start of the range and the ends of those transients.
+            std::vector<vk::DeviceSize> candidates = {0};
+            for (size_t other : placed) {
+                if (overlapsInTime(other)) candidates.push_back(align(offsets[other] + requests[other].size));
+            }
+            std::ranges::sort(candidates);
+
+            for (vk::DeviceSize candidate : candidates) {
+                bool collides = std::ranges::any_of(placed, [&](size_t other) {
+                    return overlapsInTime(other) &&
+                           candidate < offsets[other] + requests[other].size && offsets[other] < candidate + request.size;
+                });
+
+                if (!collides) {
+                    offsets[i] = candidate;
+                    break;
+                }
+            }
+
+            placed.push_back(i);
+            totalSize = std::max(totalSize, offsets[i] + request.size);
+        }
+
+        return {std::move(offsets), totalSize};
+    }
+
+    vk::ImageAspectFlags getImageAspect(vk::Format format) {
+        switch (format) {
+            case vk::Format::eD16Unorm:
+            case vk::Format::eX8D24UnormPack32:
+            case vk::Format::eD32Sfloat:
+                return vk::ImageAspectFlagBits::eDepth;
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+            case vk::Format::eS8Uint:
+                return vk::ImageAspectFlagBits::eStencil;
+            default:
+                return vk::ImageAspectFlagBits::eColor;
+        }
+    }
+
+} // imr
@@ -0,0 +1,222 @@
+#ifndef VK_IMM_RENDERER_FRAME_GRAPH_HPP
+#define VK_IMM_RENDERER_FRAME_GRAPH_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <concepts>
+#include <type_traits>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "frame_arena.hpp"
+
+namespace imr {
+
+    using FrameGraphResource = uint32_t;
+    using FrameGraphPass = uint32_t;
+
+    enum class ImageAccess : uint8_t {
+        eColorAttachment,
+        eDepthAttachment,
+        eSampled,
+        eTransferSrc,
+        eTransferDst
+    };
+
+    // Image created by the graph, it only exists between its first and last use
+    struct TransientImageDesc {
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent2D extent;
+
+        bool operator==(const TransientImageDesc&) const = default;
+    };
+
+    // Image owned outside the graph, e.g. the swapchain image
+    struct ImportedImage {
+        vk::Image image;
+        vk::ImageView view;
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent2D extent;
+        // Undefined discards the contents. The stage has to cover whatever made the image available,
+        // e.g. the wait stage of the acquire semaphore.
+        vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags initialStage = vk::PipelineStageFlagBits::eTopOfPipe;
+        // Undefined leaves the image in whatever layout its last pass needed
+        vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+        // Passes writing an output are never culled
+        bool output = false;
+    };
+
+    struct FrameGraphBarrier {
+        FrameGraphResource resource;
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+        vk::PipelineStageFlags srcStage;
+        vk::PipelineStageFlags dstStage;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+    };
+
+    struct FrameGraphAttachment {
+        FrameGraphResource resource;
+        vk::AttachmentLoadOp loadOp;
+        vk::AttachmentStoreOp storeOp;
+        vk::ImageLayout layout;
+        vk::ClearValue clearValue;
+    };
+
+    // Like everything else the graph builds per frame, the barrier and attachment lists live in its arena
+    struct CompiledPass {
+        FrameGraphPass pass;
+        // Recorded in front of the pass, outside any render pass
+        ArenaVector<FrameGraphBarrier> barriers;
+        // Color attachments, then the depth attachment. Passes without any only get a command buffer.
+        ArenaVector<FrameGraphAttachment> attachments;
+        vk::Extent2D extent;
+    };
+
+    struct CompiledTransient {
+        FrameGraphResource resource;
+        // Lifetime as indices into CompiledFrameGraph::passes
+        uint32_t firstUse;
+        uint32_t lastUse;
+        vk::ImageUsageFlags usage;
+        // Only used as an attachment of a single pass, so its contents never leave tile memory. Gets lazily
+        // allocated memory where the device has it and is never aliased.
+        bool lazy;
+    };
+
+    struct CompiledFrameGraph {
+        // In execution order, culled passes left out
+        std::vector<CompiledPass> passes;
+        // Imported images to their final layouts
+        std::vector<FrameGraphBarrier> finalBarriers;
+        std::vector<CompiledTransient> transients;
+        uint32_t culledPassCount = 0;
+    };
+
+    struct FrameGraphPassContext {
+        // Null for passes without attachments
+        vk::RenderPass renderPass;
+        vk::Framebuffer framebuffer;
+        vk::Extent2D extent;
+        // Indexed by resource
+        std::span<const vk::ImageView> views;
+    };
+
+    // Doesn't own what it calls, see FrameGraph::addPass
+    struct FrameGraphCallback {
+        void* context = nullptr;
+        void (*invoke)(void* context, const vk::raii::CommandBuffer& cmd, const FrameGraphPassContext& pass) = nullptr;
+
+        // The callable has to outlive the execution of the graph
+        template<typename F>
+        static FrameGraphCallback wrap(F& callable) {
+            return {
+                    &callable,
+                    [](void* context, const vk::raii::CommandBuffer& cmd, const FrameGraphPassContext& pass) {
+                        (*static_cast<F*>(context))(cmd, pass);
+                    }
+            };
+        }
+
+        explicit operator bool() const { return this->invoke != nullptr; }
+        void operator()(const vk::raii::CommandBuffer& cmd, const FrameGraphPassContext& pass) const { this->invoke(this->context, cmd, pass); }
+    };
+
+    // Passes declared in execution order together with the images they read and write. Compiling culls the
+    // passes nothing depends on, derives the barriers and layout transitions between them, picks load and
+    // store ops and works out the transients' lifetimes. Doesn't touch the device, FrameGraphExecutor
+    // creates the images and records the result.
+    class FrameGraph {
+    public:
+        struct Access {
+            FrameGraphResource resource;
+            ImageAccess access;
+            std::optional<vk::ClearValue> clear;
+        };
+
+        struct Pass {
+            const char* name;
+            FrameGraphCallback callback;
+            vk::SubpassContents contents;
+            ArenaVector<Access> accesses;
+            bool keepAlive = false;
+        };
+
+        struct Resource {
+            bool imported;
+            TransientImageDesc desc;
+            ImportedImage import;
+        };
+
+        // Per frame data is allocated from the arena, which has to be reset between frames and outlive the graph
+        explicit FrameGraph(FrameArena& arena) : arena(&arena) {}
+
+        // Drops every pass and resource, keeping the storage for the next frame. The arena may be reset
+        // before or after, but not while the graph is recorded.
+        void reset();
+
+        FrameGraphResource createImage(const TransientImageDesc& desc);
+        FrameGraphResource importImage(const ImportedImage& image);
+
+        // The name has to outlive the graph, e.g. a string literal. The callback is only referenced, whatever it
+        // calls has to live until the graph has been executed.
+        FrameGraphPass addPass(const char* name, FrameGraphCallback callback, vk::SubpassContents contents = vk::SubpassContents::eInline);
+        // Copies the callable into the arena, so a lambda can be passed straight in. Its destructor never runs.
+        template<typename F>
+            requires (!std::same_as<std::remove_cvref_t<F>, FrameGraphCallback> &&
+                      std::invocable<std::remove_cvref_t<F>&, const vk::raii::CommandBuffer&, const FrameGraphPassContext&>)
+        FrameGraphPass addPass(const char* name, F&& callable, vk::SubpassContents contents = vk::SubpassContents::eInline) {
+            using Callable = std::remove_cvref_t<F>;
+            static_assert(std::is_trivially_destructible_v<Callable>, "Pass callbacks in the frame arena are never destroyed");
+
+            auto* stored = new (this->arena->allocate(sizeof(Callable), alignof(Callable))) Callable(std::forward<F>(callable));
+            return addPass(name, FrameGraphCallback::wrap(*stored), contents);
+        }
+        // Without a clear value the attachment keeps what earlier passes wrote
+        void writeColor(FrameGraphPass pass, FrameGraphResource resource, std::optional<vk::ClearColorValue> clear = std::nullopt);
+        void writeDepth(FrameGraphPass pass, FrameGraphResource resource, std::optional<vk::ClearDepthStencilValue> clear = std::nullopt);
+        void sample(FrameGraphPass pass, FrameGraphResource resource);
+        void copyFrom(FrameGraphPass pass, FrameGraphResource resource);
+        void copyTo(FrameGraphPass pass, FrameGraphResource resource);
+        // For passes whose effect isn't an image, e.g. a readback
+        void keepAlive(FrameGraphPass pass);
+
+        const CompiledFrameGraph& compile();
+
+        [[nodiscard]] const std::vector<Pass>& getPasses() const { return this->passes; }
+        [[nodiscard]] const std::vector<Resource>& getResources() const { return this->resources; }
+        [[nodiscard]] const CompiledFrameGraph& getCompiled() const { return this->compiled; }
+
+        [[nodiscard]] vk::Format getFormat(FrameGraphResource resource) const;
+        [[nodiscard]] vk::Extent2D getExtent(FrameGraphResource resource) const;
+
+    private:
+        FrameArena* arena;
+        std::vector<Pass> passes;
+        std::vector<Resource> resources;
+        CompiledFrameGraph compiled;
+
+        void addAccess(FrameGraphPass pass, FrameGraphResource resource, ImageAccess access, std::optional<vk::ClearValue> clear);
+    };
+
+    struct TransientMemoryRequest {
+        vk::DeviceSize size;
+        vk::DeviceSize alignment;
+        uint32_t firstUse;
+        uint32_t lastUse;
+    };
+
+    // Places transients with overlapping lifetimes at disjoint offsets, the others may share memory.
+    // Returns the offsets and the size of the whole range.
+    std::pair<std::vector<vk::DeviceSize>, vk::DeviceSize> packTransientMemory(std::span<const TransientMemoryRequest> requests);
+
+    [[nodiscard]] vk::ImageAspectFlags getImageAspect(vk::Format format);
+
+} // imr
+
+#endif //VK_IMM_RENDERER_FRAME_GRAPH_HPP
@@ -0,0 +1,266 @@
+#include "frame_graph_executor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    FrameGraphExecutor::FrameGraphExecutor(const vk::raii::Device &device, DeviceMemoryAllocator &allocator) :
+            device(&device), allocator(&allocator) {}
+
+    FrameGraphExecutor::~FrameGraphExecutor() {
+        this->framebuffers.clear();
+        release(this->transients, *this->allocator);
+    }
+
+    void FrameGraphExecutor::execute(const vk::raii::CommandBuffer &cmd, const FrameGraph &graph, DeletionQueue &deletionQueue, uint64_t retireFrame) {
+        const CompiledFrameGraph& compiled = graph.getCompiled();
+        const auto& resources = graph.getResources();
+
+        prepareTransients(graph, deletionQueue, retireFrame);
+
+        this->images.assign(resources.size(), VK_NULL_HANDLE);
+        this->views.assign(resources.size(), VK_NULL_HANDLE);
+        for (size_t r = 0; r < resources.size(); r++) {
+            if (!resources[r].imported) continue;
+            this->images[r] = resources[r].import.image;
+            this->views[r] = resources[r].import.view;
+        }
+        for (size_t i = 0; i < compiled.transients.size(); i++) {
+            this->images[compiled.transients[i].resource] = *this->transients.images[i];
+            this->views[compiled.transients[i].resource] = *this->transients.views[i];
+        }
+
+        for (uint32_t c = 0; c < compiled.passes.size(); c++) {
+            const CompiledPass& pass = compiled.passes[c];
+            const FrameGraph::Pass& declaration = graph.getPasses()[pass.pass];
+
+            recordBarriers(cmd, graph, pass.barriers);
+
+            FrameGraphPassContext context{{}, {}, pass.extent, this->views};
+            if (pass.attachments.empty()) {
+                if (declaration.callback) declaration.callback(cmd, context);
+                continue;
+            }
+
+            context.renderPass = getRenderPass(graph, c);
+            context.framebuffer = getFramebuffer(context.renderPass, pass);
+
+            this->clearValues.clear();
+            for (const auto& attachment : pass.attachments) this->clearValues.push_back(attachment.clearValue);
+
+            vk::RenderPassBeginInfo renderPassInfo {
+                    context.renderPass,
+                    context.framebuffer,
+                    {{0, 0}, pass.extent},
+                    this->clearValues
+            };
+
+            cmd.beginRenderPass(renderPassInfo, declaration.contents);
+            if (declaration.callback) declaration.callback(cmd, context);
+            cmd.endRenderPass();
+        }
+
+        recordBarriers(cmd, graph, compiled.finalBarriers);
+    }
+
+    vk::RenderPass FrameGraphExecutor::getRenderPass(const FrameGraph &graph, uint32_t compiledPass) {
+        const CompiledPass& pass = graph.getCompiled().passes.at(compiledPass);
+
+        this->renderPassKey.clear();
+        for (const auto& attachment : pass.attachments) {
+            this->renderPassKey.push_back({graph.getFormat(attachment.resource), attachment.loadOp, attachment.storeOp, attachment.layout});
+        }
+
+        auto it = std::ranges::find(this->renderPasses, this->renderPassKey, &CachedRenderPass::attachments);
+        if (it != this->renderPasses.end()) return *it->renderPass;
+
+        std::vector<AttachmentKey> key = this->renderPassKey;
+
+        // Layout transitions are the graph's barriers, inside the pass the attachments stay in one layout
+        std::vector<vk::AttachmentDescription> attachments;
+        std::vector<vk::AttachmentReference> colorRefs;
+        std::optional<vk::AttachmentReference> depthRef;
+
+        for (const auto& attachment : key) {
+            auto index = static_cast<uint32_t>(attachments.size());
+            attachments.push_back({
+                    {},
+                    attachment.format,
+                    vk::SampleCountFlagBits::e1,
+                    attachment.loadOp,
+                    attachment.storeOp,
+                    vk::AttachmentLoadOp::eDontCare,
+                    vk::AttachmentStoreOp::eDontCare,
+                    attachment.layout,
+                    attachment.layout
+            });
+
+            if (attachment.layout == vk::ImageLayout::eDepthStencilAttachmentOptimal) depthRef = vk::AttachmentReference{index, attachment.layout};
+            else colorRefs.push_back({index, attachment.layout});
+        }
+
+        vk::SubpassDescription subpass {
+                {},
+                vk::PipelineBindPoint::eGraphics,
+                0, nullptr,
+                static_cast<uint32_t>(colorRefs.size()), colorRefs.data(),
+                nullptr,
+                depthRef ? &*depthRef : nullptr
+        };
+
+        vk::RenderPassCreateInfo renderPassInfo {
+                {},
+                attachments,
+                subpass
+        };
+
+        this->renderPasses.push_back({std::move(key), this->device->createRenderPass(renderPassInfo)});
+        return *this->renderPasses.back().renderPass;
+    }
+
+    void FrameGraphExecutor::retireFramebuffers(DeletionQueue &deletionQueue, uint64_t retireFrame) {
+        if (this->framebuffers.empty()) return;
+
+        deletionQueue.retire(retireFrame, [old = std::move(this->framebuffers)]() mutable { old.clear(); });
+        this->framebuffers.clear();
+    }
+
+    void FrameGraphExecutor::prepareTransients(const FrameGraph &graph, DeletionQueue &deletionQueue, uint64_t retireFrame) {
+        const CompiledFrameGraph& compiled = graph.getCompiled();
+
+        this->transientKeys.clear();
+        for (const auto& transient : compiled.transients) {
+            this->transientKeys.push_back({graph.getResources()[transient.resource].desc, transient.usage, transient.firstUse, transient.lastUse, transient.lazy});
+        }
+
+        if (this->transientKeys == this->transients.keys) return;
+
+        // Frames still in flight keep using the old images, their framebuffers go with them
+        retireFramebuffers(deletionQueue, retireFrame);
+        deletionQueue.retire(retireFrame, [old = std::move(this->transients), allocator = this->allocator]() mutable {
+            release(old, *allocator);
+        });
+
+        this->transients = {};
+        this->transients.keys = this->transientKeys;
+
+        std::vector<TransientMemoryRequest> requests;
+        std::vector<size_t> aliased;
+        vk::MemoryRequirements aliasedRequirements{0, 1, ~0u};
+
+        for (size_t i = 0; i < this->transients.keys.size(); i++) {
+            const TransientKey& key = this->transients.keys[i];
+
+            vk::ImageCreateInfo imageInfo {
+                    {},
+                    vk::ImageType::e2D,
+                    key.desc.format,
+                    vk::Extent3D(key.desc.extent.width, key.desc.extent.height, 1),
+                    1, 1,
+                    vk::SampleCountFlagBits::e1,
+                    vk::ImageTiling::eOptimal,
+                    key.usage,
+                    vk::SharingMode::eExclusive, 0, nullptr,
+                    vk::ImageLayout::eUndefined
+            };
+
+            this->transients.images.push_back(this->device->createImage(imageInfo));
+            vk::raii::Image& image = this->transients.images.back();
+
+            if (key.lazy) {
+                // Tilers back lazily allocated memory only while the pass runs, elsewhere it's plain device memory
+                this->transients.memory.push_back(this->allocator->bind(image, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                                        vk::MemoryPropertyFlagBits::eLazilyAllocated));
+                continue;
+            }
+
+            vk::MemoryRequirements requirements = image.getMemoryRequirements();
+            requests.push_back({requirements.size, requirements.alignment, key.firstUse, key.lastUse});
+            aliased.push_back(i);
+
+            aliasedRequirements.alignment = std::max(aliasedRequirements.alignment, requirements.alignment);
+            aliasedRequirements.memoryTypeBits &= requirements.memoryTypeBits;
+        }
+
+        if (!requests.empty() && aliasedRequirements.memoryTypeBits != 0) {
+            auto [offsets, size] = packTransientMemory(requests);
+            aliasedRequirements.size = size;
+
+            MemoryAllocation memory = this->allocator->allocate(aliasedRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal, ResourceKind::eImage);
+            for (size_t j = 0; j < aliased.size(); j++) {
+                this->transients.images[aliased[j]].bindMemory(memory.memory, memory.offset + offsets[j]);
+            }
+            this->transients.memory.push_back(memory);
+        } else {
+            // No memory type all of them can live in, nothing is shared then
+            for (size_t i : aliased) {
+                this->transients.memory.push_back(this->allocator->bind(this->transients.images[i], vk::MemoryPropertyFlagBits::eDeviceLocal));
+            }
+        }
+
+        for (size_t i = 0; i < this->transients.keys.size(); i++) {
+            const TransientKey& key = this->transients.keys[i];
+
+            vk::ImageViewCreateInfo viewInfo {
+                    {},
+                    *this->transients.images[i],
+                    vk::ImageViewType::e2D,
+                    key.desc.format,
+                    {},
+                    {getImageAspect(key.desc.format), 0, 1, 0, 1}
+            };
+
+            this->transients.views.push_back(this->device->createImageView(viewInfo));
+        }
+    }
+
+    vk::Framebuffer FrameGraphExecutor::getFramebuffer(vk::RenderPass renderPass, const CompiledPass &pass) {
+        this->attachmentViews.clear();
+        for (const auto& attachment : pass.attachments) this->attachmentViews.push_back(this->views[attachment.resource]);
+
+        for (const auto& cached : this->framebuffers) {
+            if (cached.renderPass == renderPass && cached.views == this->attachmentViews && cached.extent == pass.extent) return *cached.framebuffer;
+        }
+
+        vk::FramebufferCreateInfo framebufferInfo {
+                {},
+                renderPass,
+                this->attachmentViews,
+                pass.extent.width, pass.extent.height, 1
+        };
+
+        this->framebuffers.push_back({renderPass, this->attachmentViews, pass.extent, this->device->createFramebuffer(framebufferInfo)});
+        return *this->framebuffers.back().framebuffer;
+    }
+
+    void FrameGraphExecutor::recordBarriers(const vk::raii::CommandBuffer &cmd, const FrameGraph &graph, std::span<const FrameGraphBarrier> barriers) {
+        if (barriers.empty()) return;
+
+        vk::PipelineStageFlags srcStage, dstStage;
+        this->imageBarriers.clear();
+
+        for (const auto& barrier : barriers) {
+            srcStage |= barrier.srcStage;
+            dstStage |= barrier.dstStage;
+
+            this->imageBarriers.push_back({
+                    barrier.srcAccess, barrier.dstAccess,
+                    barrier.oldLayout, barrier.newLayout,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                    this->images[barrier.resource],
+                    {getImageAspect(graph.getFormat(barrier.resource)), 0, 1, 0, 1}
+            });
+        }
+
+        cmd.pipelineBarrier(srcStage, dstStage, {}, nullptr, nullptr, this->imageBarriers);
+    }
+
+    void FrameGraphExecutor::release(Transients &transients, DeviceMemoryAllocator &allocator) {
+        transients.views.clear();
+        transients.images.clear();
+        for (auto& memory : transients.memory) allocator.free(memory);
+        transients.memory.clear();
+    }
+
+} // imr
@@ -0,0 +1,103 @@
+#ifndef VK_IMM_RENDERER_FRAME_GRAPH_EXECUTOR_HPP
+#define VK_IMM_RENDERER_FRAME_GRAPH_EXECUTOR_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "frame_graph.hpp"
+#include "deletion_queue.hpp"
+#include "memory_allocator.hpp"
+
+namespace imr {
+
+    // Records compiled frame graphs. Transient images are kept from frame to frame and only rebuilt when the
+    // graph asks for different ones. Render passes are cached by their attachments, framebuffers by their views.
+    class FrameGraphExecutor {
+    public:
+        FrameGraphExecutor(const vk::raii::Device& device, DeviceMemoryAllocator& allocator);
+
+        FrameGraphExecutor(const FrameGraphExecutor&) = delete;
+        FrameGraphExecutor& operator=(const FrameGraphExecutor&) = delete;
+
+        ~FrameGraphExecutor();
+
+        // Replaced transients and their framebuffers are retired at retireFrame
+        void execute(const vk::raii::CommandBuffer& cmd, const FrameGraph& graph, DeletionQueue& deletionQueue, uint64_t retireFrame);
+
+        // Render pass of a compiled pass, e.g. to create pipelines before the first frame. Stays valid as long
+        // as the executor, later graphs with the same attachments get the same one.
+        vk::RenderPass getRenderPass(const FrameGraph& graph, uint32_t compiledPass);
+
+        // For imported views that are about to be destroyed, e.g. when the swapchain is recreated
+        void retireFramebuffers(DeletionQueue& deletionQueue, uint64_t retireFrame);
+
+    private:
+        struct AttachmentKey {
+            vk::Format format;
+            vk::AttachmentLoadOp loadOp;
+            vk::AttachmentStoreOp storeOp;
+            vk::ImageLayout layout;
+
+            bool operator==(const AttachmentKey&) const = default;
+        };
+
+        struct CachedRenderPass {
+            std::vector<AttachmentKey> attachments;
+            vk::raii::RenderPass renderPass{VK_NULL_HANDLE};
+        };
+
+        struct CachedFramebuffer {
+            vk::RenderPass renderPass;
+            std::vector<vk::ImageView> views;
+            vk::Extent2D extent;
+            vk::raii::Framebuffer framebuffer{VK_NULL_HANDLE};
+        };
+
+        struct TransientKey {
+            TransientImageDesc desc;
+            vk::ImageUsageFlags usage;
+            uint32_t firstUse;
+            uint32_t lastUse;
+            bool lazy;
+
+            bool operator==(const TransientKey&) const = default;
+        };
+
+        struct Transients {
+            std::vector<TransientKey> keys;
+            std::vector<vk::raii::Image> images;
+            std::vector<vk::raii::ImageView> views;
+            // Shared by the aliased transients, the lazy ones have their own
+            std::vector<MemoryAllocation> memory;
+        };
+
+        const vk::raii::Device* device = nullptr;
+        DeviceMemoryAllocator* allocator = nullptr;
+
+        std::vector<CachedRenderPass> renderPasses;
+        std::vector<CachedFramebuffer> framebuffers;
+        Transients transients;
+
+        // Per frame, indexed by resource
+        std::vector<vk::Image> images;
+        std::vector<vk::ImageView> views;
+
+        // Scratch, kept so steady frames don't allocate
+        std::vector<vk::ClearValue> clearValues;
+        std::vector<vk::ImageMemoryBarrier> imageBarriers;
+        std::vector<TransientKey> transientKeys;
+        std::vector<AttachmentKey> renderPassKey;
+        std::vector<vk::ImageView> attachmentViews;
+
+        void prepareTransients(const FrameGraph& graph, DeletionQueue& deletionQueue, uint64_t retireFrame);
+        vk::Framebuffer getFramebuffer(vk::RenderPass renderPass, const CompiledPass& pass);
+        void recordBarriers(const vk::raii::CommandBuffer& cmd, const FrameGraph& graph, std::span<const FrameGraphBarrier> barriers);
+
+        static void release(Transients& transients, DeviceMemoryAllocator& allocator);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_FRAME_GRAPH_EXECUTOR_HPP
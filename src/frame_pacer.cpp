@@ -0,0 +1,50 @@
+#include "frame_pacer.hpp"
+
+#include <thread>
+#include <algorithm>
+
+namespace imr {
+
+    FramePacer::FramePacer(double targetFrameRate) {
+        if (targetFrameRate > 0.0) {
+            this->framePeriod = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFrameRate));
+        }
+    }
+
+    void FramePacer::waitForFrame() {
+        if (this->framePeriod == Clock::duration::zero()) return;
+
+        Clock::time_point now = Clock::now();
+
+        // After a stall the schedule restarts from now instead of rushing frames out to catch up
+        if (now - this->deadline > this->framePeriod) this->deadline = now;
+
+        if (this->deadline - now > SpinThreshold) std::this_thread::sleep_until(this->deadline - SpinThreshold);
+        while (Clock::now() < this->deadline) std::this_thread::yield();
+
+        this->deadline += this->framePeriod;
+    }
+
+    void FramePacer::framePresented(Clock::time_point inputTime, uint32_t queuedImages) {
+        Clock::time_point now = Clock::now();
+
+        if (this->lastPresent != Clock::time_point{}) {
+            double intervalMs = std::chrono::duration<double, std::milli>(now - this->lastPresent).count();
+
+            // Gaps left by skipped frames or an idle window aren't display intervals
+            if (intervalMs < MaxFrameIntervalMs) {
+                this->stats.frameIntervalMs = this->stats.frameIntervalMs == 0.0 ? intervalMs : this->stats.frameIntervalMs * 0.9 + intervalMs * 0.1;
+            }
+        }
+        this->lastPresent = now;
+
+        double latencyMs = std::chrono::duration<double, std::milli>(now - inputTime).count() + queuedImages * this->stats.frameIntervalMs;
+
+        this->stats.frames++;
+        this->stats.lastMs = latencyMs;
+        this->stats.maxMs = std::max(this->stats.maxMs, latencyMs);
+        this->totalLatencyMs += latencyMs;
+        this->stats.averageMs = this->totalLatencyMs / static_cast<double>(this->stats.frames);
+    }
+
+} // imr
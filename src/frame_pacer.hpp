@@ -0,0 +1,52 @@
+#ifndef VK_IMM_RENDERER_FRAME_PACER_HPP
+#define VK_IMM_RENDERER_FRAME_PACER_HPP
+
+#include <chrono>
+#include <cstdint>
+
+namespace imr {
+
+    struct LatencyStats {
+        uint64_t frames = 0;
+        // Input sampled to the frame reaching the display. Estimated as the time until the present call plus one
+        // frame interval per image queued ahead of it, there's no display timing feedback to measure it exactly.
+        double averageMs = 0.0;
+        double maxMs = 0.0;
+        double lastMs = 0.0;
+        // Smoothed time between two presents
+        double frameIntervalMs = 0.0;
+    };
+
+    // Caps the frame rate by sleeping until each frame's deadline, so a fast CPU doesn't render frames
+    // nobody sees and the input of the frames that are shown is as fresh as possible
+    class FramePacer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        FramePacer() = default;
+        // 0 doesn't cap the frame rate, the present mode alone paces then
+        explicit FramePacer(double targetFrameRate);
+
+        // Blocks until the next frame is due
+        void waitForFrame();
+        // queuedImages is how many images the presentation engine shows before this one
+        void framePresented(Clock::time_point inputTime, uint32_t queuedImages);
+
+        [[nodiscard]] const LatencyStats& getStats() const { return this->stats; }
+
+    private:
+        // Sleeps overshoot by up to a scheduler tick, the rest of the wait is spent yielding
+        static constexpr Clock::duration SpinThreshold = std::chrono::microseconds(1500);
+        static constexpr double MaxFrameIntervalMs = 250.0;
+
+        Clock::duration framePeriod{0};
+        Clock::time_point deadline;
+        Clock::time_point lastPresent;
+
+        LatencyStats stats;
+        double totalLatencyMs = 0.0;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_FRAME_PACER_HPP
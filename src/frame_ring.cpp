@@ -0,0 +1,117 @@
+#include "frame_ring.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    GeometryTarget FrameSlot::getGeometryTarget(const FrameRingConfig &config) const {
+        auto* base = static_cast<std::byte*>(this->uploadMapped);
+
+        return {
+            reinterpret_cast<Vertex*>(base + this->vertexOffset), config.vertexCapacity,
+            reinterpret_cast<uint32_t*>(base + this->indexOffset), config.indexCapacity,
+            reinterpret_cast<ShapeInstance*>(base + this->shapeOffset), config.shapeCapacity
+        };
+    }
+
+    std::span<DrawIndirectCommand> FrameSlot::getDrawCommands(const FrameRingConfig &config) const {
+        auto* base = static_cast<std::byte*>(this->uploadMapped);
+        return {reinterpret_cast<DrawIndirectCommand*>(base + this->drawCommandOffset), config.drawCommandCapacity};
+    }
+
+    std::optional<TransientAllocation> FrameSlot::allocateTransient(vk::DeviceSize size, vk::DeviceSize alignment) {
+        auto offset = this->transient.allocate(size, alignment);
+        if (!offset) return std::nullopt;
+
+        vk::DeviceSize bufferOffset = this->transientOffset + *offset;
+        return TransientAllocation{bufferOffset, static_cast<std::byte*>(this->uploadMapped) + bufferOffset};
+    }
+
+    FrameRing::FrameRing(const vk::raii::Device &device, DeviceMemoryAllocator &allocator,
+                         uint32_t queueFamilyIndex, const FrameRingConfig &config) : config(config) {
+        if (config.framesInFlight == 0) throw std::runtime_error("FrameRing needs at least one frame in flight");
+
+        vk::CommandPoolCreateInfo cmdPoolCreateInfo {
+                vk::CommandPoolCreateFlagBits::eTransient,
+                queueFamilyIndex
+        };
+
+        // Every region starts at a multiple of the largest min*BufferOffsetAlignment the spec allows, so the shapes,
+        // draw commands and transient data can all be bound as uniform or storage buffers
+        auto align = [](vk::DeviceSize offset) { return (offset + 255) & ~vk::DeviceSize{255}; };
+
+        vk::DeviceSize indexOffset = align(static_cast<vk::DeviceSize>(config.vertexCapacity) * sizeof(Vertex));
+        vk::DeviceSize shapeOffset = align(indexOffset + static_cast<vk::DeviceSize>(config.indexCapacity) * sizeof(uint32_t));
+        vk::DeviceSize drawCommandOffset = align(shapeOffset + static_cast<vk::DeviceSize>(config.shapeCapacity) * sizeof(ShapeInstance));
+        vk::DeviceSize transientOffset = align(drawCommandOffset + static_cast<vk::DeviceSize>(config.drawCommandCapacity) * sizeof(DrawIndirectCommand));
+
+        for (uint32_t i = 0; i < config.framesInFlight; i++) {
+            FrameSlot slot;
+            slot.index = i;
+
+            slot.inFlightFence = device.createFence({ vk::FenceCreateFlagBits::eSignaled });
+            slot.imageAvailableSemaphore = device.createSemaphore({});
+            slot.renderFinishedSemaphore = device.createSemaphore({});
+            slot.commandPool = device.createCommandPool(cmdPoolCreateInfo);
+
+            vk::CommandBufferAllocateInfo cmdAllocInfo {
+                    *slot.commandPool,
+                    vk::CommandBufferLevel::ePrimary,
+                    1
+            };
+
+            slot.commandBuffer = std::move(device.allocateCommandBuffers(cmdAllocInfo).front());
+
+            // Vertices, indices, shape instances, draw commands, then transient data, all in one host coherent buffer
+            vk::BufferCreateInfo bufferInfo {
+                    {},
+                    transientOffset + config.transientBytes,
+                    vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer |
+                    vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+                    vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+                    vk::SharingMode::eExclusive
+            };
+
+            slot.uploadBuffer = device.createBuffer(bufferInfo);
+            slot.uploadMemory = allocator.bind(slot.uploadBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+            slot.uploadMapped = slot.uploadMemory.mapped;
+            slot.vertexOffset = 0;
+            slot.indexOffset = indexOffset;
+            slot.shapeOffset = shapeOffset;
+            slot.drawCommandOffset = drawCommandOffset;
+            slot.transientOffset = transientOffset;
+            slot.transient = LinearAllocator(config.transientBytes);
+
+            this->slots.push_back(std::move(slot));
+        }
+
+        // acquire() advances before handing out, so the first frame lands in slot 0
+        this->currentSlot = config.framesInFlight - 1;
+    }
+
+    FrameSlot &FrameRing::acquire(const vk::raii::Device &device) {
+        this->currentSlot = (this->currentSlot + 1) % this->config.framesInFlight;
+        FrameSlot& slot = this->slots[this->currentSlot];
+
+        // Only blocks if the CPU got framesInFlight frames ahead of the GPU
+        if (device.waitForFences({*slot.inFlightFence}, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to wait for frame fence");
+        }
+
+        this->completedFrame = std::max(this->completedFrame, slot.submittedFrame);
+
+        slot.frameNumber = ++this->frameNumber;
+        slot.transient.reset();
+        slot.commandPool.reset();
+
+        return slot;
+    }
+
+    void FrameRing::markSubmitted(FrameSlot &slot) {
+        slot.submittedFrame = slot.frameNumber;
+        this->lastSubmittedFrame = slot.frameNumber;
+    }
+
+} // imr
@@ -0,0 +1,94 @@
+#ifndef VK_IMM_RENDERER_FRAME_RING_HPP
+#define VK_IMM_RENDERER_FRAME_RING_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "renderer.hpp"
+#include "memory_allocator.hpp"
+
+namespace imr {
+
+    struct FrameRingConfig {
+        uint32_t framesInFlight = 2;
+        uint32_t vertexCapacity = 1 << 20;
+        uint32_t indexCapacity = 3 << 19;
+        uint32_t shapeCapacity = 1 << 16;
+        // Indirect draws, one per batch. Frames with more batches are drawn directly.
+        uint32_t drawCommandCapacity = 1 << 14;
+        vk::DeviceSize transientBytes = 4 << 20;
+    };
+
+    struct TransientAllocation {
+        vk::DeviceSize offset;
+        void* mapped;
+    };
+
+    // Everything a single frame in flight owns. The upload buffer stays mapped for the whole
+    // lifetime of the slot, the Renderer writes geometry straight into it.
+    struct FrameSlot {
+        vk::raii::Fence inFlightFence{VK_NULL_HANDLE};
+        vk::raii::Semaphore imageAvailableSemaphore{VK_NULL_HANDLE};
+        vk::raii::Semaphore renderFinishedSemaphore{VK_NULL_HANDLE};
+        // One pool per slot, recycled as a whole once the slot's fence has signalled
+        vk::raii::CommandPool commandPool{VK_NULL_HANDLE};
+        vk::raii::CommandBuffer commandBuffer{VK_NULL_HANDLE};
+
+        vk::raii::Buffer uploadBuffer{VK_NULL_HANDLE};
+        MemoryAllocation uploadMemory;
+        void* uploadMapped = nullptr;
+
+        vk::DeviceSize vertexOffset = 0;
+        vk::DeviceSize indexOffset = 0;
+        vk::DeviceSize shapeOffset = 0;
+        vk::DeviceSize drawCommandOffset = 0;
+        vk::DeviceSize transientOffset = 0;
+        // Uniform, storage and staging data that only lives for this frame, reset when the slot is acquired
+        LinearAllocator transient;
+
+        uint32_t index = 0;
+        uint64_t frameNumber = 0;
+        // Last frame submitted through this slot, complete once inFlightFence has signalled
+        uint64_t submittedFrame = 0;
+
+        [[nodiscard]] GeometryTarget getGeometryTarget(const FrameRingConfig& config) const;
+        [[nodiscard]] std::span<DrawIndirectCommand> getDrawCommands(const FrameRingConfig& config) const;
+        std::optional<TransientAllocation> allocateTransient(vk::DeviceSize size, vk::DeviceSize alignment);
+    };
+
+    class FrameRing {
+    public:
+        FrameRing() = default;
+        FrameRing(const vk::raii::Device& device, DeviceMemoryAllocator& allocator,
+                  uint32_t queueFamilyIndex, const FrameRingConfig& config);
+
+        // Waits until the GPU is done with the next slot and hands it out for recording
+        FrameSlot& acquire(const vk::raii::Device& device);
+        // Called after the slot's command buffer went to the queue
+        void markSubmitted(FrameSlot& slot);
+
+        [[nodiscard]] FrameSlot& current() { return this->slots[this->currentSlot]; }
+        [[nodiscard]] uint32_t getFramesInFlight() const { return this->config.framesInFlight; }
+        [[nodiscard]] const FrameRingConfig& getConfig() const { return this->config; }
+        [[nodiscard]] uint64_t getFrameNumber() const { return this->frameNumber; }
+        // A signalled fence covers every earlier submission to the queue too, so everything up to this is done
+        [[nodiscard]] uint64_t getCompletedFrame() const { return this->completedFrame; }
+        [[nodiscard]] uint64_t getLastSubmittedFrame() const { return this->lastSubmittedFrame; }
+
+    private:
+        FrameRingConfig config;
+        std::vector<FrameSlot> slots;
+
+        uint32_t currentSlot = 0;
+        uint64_t frameNumber = 0;
+        uint64_t completedFrame = 0;
+        uint64_t lastSubmittedFrame = 0;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_FRAME_RING_HPP
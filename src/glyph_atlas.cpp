@@ -0,0 +1,177 @@
+#include "glyph_atlas.hpp"
+
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    size_t GlyphKeyHash::operator()(const GlyphKey &key) const {
+        uint64_t hash = (static_cast<uint64_t>(key.font) << 48) ^ (static_cast<uint64_t>(key.scale) << 32) ^ key.codepoint;
+        // splitmix64 finalizer, codepoints are dense so the low bits need mixing
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<size_t>(hash ^ (hash >> 31));
+    }
+
+    GlyphAtlas::GlyphAtlas(uint32_t width, uint32_t height, uint32_t pageCount) :
+            width(width), height(height), pageHeight(height / std::max(pageCount, 1u)) {
+        if (pageCount == 0 || pageCount > MaxPages) throw std::runtime_error("Glyph atlas page count out of range");
+
+        this->pixels.assign(static_cast<size_t>(width) * height, 0);
+        this->pages.resize(pageCount);
+        for (auto& page : this->pages) page.skyline.push_back({0, 0, width});
+
+        // The GPU copy starts out undefined, upload the cleared atlas once
+        markDirty(0, 0, width, height);
+    }
+
+    const AtlasGlyph *GlyphAtlas::find(const GlyphKey &key) {
+        auto it = this->glyphs.find(key);
+        if (it == this->glyphs.end()) return nullptr;
+
+        this->pages[it->second.page].lastUsed = this->frame;
+        return &it->second;
+    }
+
+    void GlyphAtlas::touchPages(uint32_t pageMask) {
+        for (uint32_t page = 0; pageMask != 0; page++, pageMask >>= 1) {
+            if (pageMask & 1) this->pages[page].lastUsed = this->frame;
+        }
+    }
+
+    std::optional<AtlasRect> GlyphAtlas::pack(Page &page, uint32_t rectWidth, uint32_t rectHeight) {
+        auto& skyline = page.skyline;
+
+        // Bottom-left: the position with the lowest resulting top edge, leftmost on ties
+        size_t bestIndex = SIZE_MAX;
+        uint32_t bestY = std::numeric_limits<uint32_t>::max();
+
+        for (size_t i = 0; i < skyline.size(); i++) {
+            uint32_t x = skyline[i].x;
+            if (x + rectWidth > this->width) break;
+
+            uint32_t y = 0;
+            uint32_t covered = 0;
+            for (size_t j = i; covered < rectWidth; j++) {
+                y = std::max(y, skyline[j].y);
+                covered += skyline[j].width;
+            }
+
+            if (y + rectHeight <= this->pageHeight && y < bestY) {
+                bestY = y;
+                bestIndex = i;
+            }
+        }
+
+        if (bestIndex == SIZE_MAX) return std::nullopt;
+
+        uint32_t x = skyline[bestIndex].x;
+        SkylineSegment placed{x, bestY + rectHeight, rectWidth};
+
+        // Cut the segments the new one covers, the last of them may only be covered partly
+        size_t end = bestIndex;
+        while (end < skyline.size() && skyline[end].x + skyline[end].width <= x + rectWidth) end++;
+        if (end < skyline.size() && skyline[end].x < x + rectWidth) {
+            uint32_t cut = x + rectWidth - skyline[end].x;
+            skyline[end].x += cut;
+            skyline[end].width -= cut;
+        }
+
+        skyline.erase(skyline.begin() + static_cast<ptrdiff_t>(bestIndex), skyline.begin() + static_cast<ptrdiff_t>(end));
+        skyline.insert(skyline.begin() + static_cast<ptrdiff_t>(bestIndex), placed);
+
+        // Neighbours at the same height become one segment
+        for (size_t i = 0; i + 1 < skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + static_cast<ptrdiff_t>(i) + 1);
+            } else {
+                i++;
+            }
+        }
+
+        return AtlasRect{x, bestY, rectWidth, rectHeight};
+    }
+
+    void GlyphAtlas::evict(uint32_t page) {
+        std::erase_if(this->glyphs, [page](const auto& entry) { return entry.second.page == page; });
+
+        this->pages[page].skyline.assign(1, {0, 0, this->width});
+
+        uint32_t top = page * this->pageHeight;
+        std::fill(this->pixels.begin() + static_cast<ptrdiff_t>(top) * this->width,
+                  this->pixels.begin() + static_cast<ptrdiff_t>(top + this->pageHeight) * this->width, 0);
+        markDirty(0, top, this->width, this->pageHeight);
+
+        this->epoch++;
+    }
+
+    const AtlasGlyph *GlyphAtlas::insert(const GlyphKey &key, uint32_t glyphWidth, uint32_t glyphHeight, std::span<const uint8_t> glyphPixels) {
+        uint32_t paddedWidth = glyphWidth + 2 * Padding;
+        uint32_t paddedHeight = glyphHeight + 2 * Padding;
+        if (paddedWidth > this->width || paddedHeight > this->pageHeight) return nullptr;
+
+        uint32_t pageIndex = 0;
+        std::optional<AtlasRect> rect;
+        for (; pageIndex < this->pages.size(); pageIndex++) {
+            rect = pack(this->pages[pageIndex], paddedWidth, paddedHeight);
+            if (rect) break;
+        }
+
+        if (!rect) {
+            // Everything is full, give up the least recently used page unless the current frame needs it
+            auto lru = std::min_element(this->pages.begin(), this->pages.end(),
+                                        [](const Page& a, const Page& b) { return a.lastUsed < b.lastUsed; });
+            if (lru->lastUsed >= this->frame) return nullptr;
+
+            pageIndex = static_cast<uint32_t>(lru - this->pages.begin());
+            evict(pageIndex);
+            rect = pack(*lru, paddedWidth, paddedHeight);
+        }
+
+        uint32_t x = rect->x + Padding;
+        uint32_t y = pageIndex * this->pageHeight + rect->y + Padding;
+
+        for (uint32_t row = 0; row < glyphHeight; row++) {
+            std::copy_n(glyphPixels.data() + static_cast<size_t>(row) * glyphWidth, glyphWidth,
+                        this->pixels.data() + static_cast<size_t>(y + row) * this->width + x);
+        }
+        markDirty(x, y, glyphWidth, glyphHeight);
+
+        this->pages[pageIndex].lastUsed = this->frame;
+
+        glm::vec2 atlasSize(static_cast<float>(this->width), static_cast<float>(this->height));
+        AtlasGlyph glyph {
+                glm::vec2(static_cast<float>(x), static_cast<float>(y)) / atlasSize,
+                glm::vec2(static_cast<float>(x + glyphWidth), static_cast<float>(y + glyphHeight)) / atlasSize,
+                pageIndex
+        };
+
+        return &this->glyphs.insert_or_assign(key, glyph).first->second;
+    }
+
+    void GlyphAtlas::markDirty(uint32_t x, uint32_t y, uint32_t rectWidth, uint32_t rectHeight) {
+        if (!this->dirty) {
+            this->dirtyMinX = x;
+            this->dirtyMinY = y;
+            this->dirtyMaxX = x + rectWidth;
+            this->dirtyMaxY = y + rectHeight;
+            this->dirty = true;
+            return;
+        }
+
+        this->dirtyMinX = std::min(this->dirtyMinX, x);
+        this->dirtyMinY = std::min(this->dirtyMinY, y);
+        this->dirtyMaxX = std::max(this->dirtyMaxX, x + rectWidth);
+        this->dirtyMaxY = std::max(this->dirtyMaxY, y + rectHeight);
+    }
+
+    std::optional<AtlasRect> GlyphAtlas::takeDirtyRect() {
+        if (!this->dirty) return std::nullopt;
+
+        this->dirty = false;
+        return AtlasRect{this->dirtyMinX, this->dirtyMinY, this->dirtyMaxX - this->dirtyMinX, this->dirtyMaxY - this->dirtyMinY};
+    }
+
+} // imr
@@ -0,0 +1,108 @@
+#ifndef VK_IMM_RENDERER_GLYPH_ATLAS_HPP
+#define VK_IMM_RENDERER_GLYPH_ATLAS_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+namespace imr {
+
+    struct GlyphKey {
+        uint32_t font;
+        uint32_t codepoint;
+        uint32_t scale;
+
+        bool operator==(const GlyphKey&) const = default;
+    };
+
+    struct GlyphKeyHash {
+        size_t operator()(const GlyphKey& key) const;
+    };
+
+    struct AtlasGlyph {
+        glm::vec2 uvMin;
+        glm::vec2 uvMax;
+        uint32_t page;
+    };
+
+    struct AtlasRect {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // CPU side of an 8 bit glyph atlas. The atlas is split into horizontal pages, each skyline packed.
+    // Single glyphs can't be freed from a skyline, so eviction works on whole pages: the least recently
+    // used page that no glyph of the current frame lives on is cleared and repacked.
+    class GlyphAtlas {
+    public:
+        static constexpr uint32_t MaxPages = 32;
+
+        GlyphAtlas(uint32_t width = 1024, uint32_t height = 1024, uint32_t pageCount = 8);
+
+        void beginFrame(uint64_t frame) { this->frame = frame; }
+
+        // Marks the glyph's page as used this frame
+        const AtlasGlyph* find(const GlyphKey& key);
+        // Packs the glyph, evicting a page if needed. Returns nullptr if it is larger than a page or
+        // every page is used by the current frame.
+        const AtlasGlyph* insert(const GlyphKey& key, uint32_t width, uint32_t height, std::span<const uint8_t> pixels);
+
+        // Bit i keeps page i from being evicted this frame
+        void touchPages(uint32_t pageMask);
+
+        // Changes whenever glyphs are evicted, anything holding on to uv coordinates has to look them up again
+        [[nodiscard]] uint64_t getEpoch() const { return this->epoch; }
+
+        [[nodiscard]] std::span<const uint8_t> getPixels() const { return this->pixels; }
+        [[nodiscard]] uint32_t getWidth() const { return this->width; }
+        [[nodiscard]] uint32_t getHeight() const { return this->height; }
+        [[nodiscard]] size_t getGlyphCount() const { return this->glyphs.size(); }
+
+        [[nodiscard]] bool isDirty() const { return this->dirty; }
+        // Region changed since the last call, to be uploaded to the GPU copy
+        std::optional<AtlasRect> takeDirtyRect();
+
+    private:
+        struct SkylineSegment {
+            uint32_t x;
+            uint32_t y;
+            uint32_t width;
+        };
+
+        struct Page {
+            std::vector<SkylineSegment> skyline;
+            uint64_t lastUsed = 0;
+        };
+
+        // Empty space around every glyph so filtering never picks up a neighbour
+        static constexpr uint32_t Padding = 1;
+
+        uint32_t width;
+        uint32_t height;
+        uint32_t pageHeight;
+
+        std::vector<uint8_t> pixels;
+        std::vector<Page> pages;
+        std::unordered_map<GlyphKey, AtlasGlyph, GlyphKeyHash> glyphs;
+
+        uint64_t frame = 1;
+        uint64_t epoch = 0;
+
+        bool dirty = false;
+        uint32_t dirtyMinX = 0, dirtyMinY = 0, dirtyMaxX = 0, dirtyMaxY = 0;
+
+        // Position is relative to the page
+        std::optional<AtlasRect> pack(Page& page, uint32_t rectWidth, uint32_t rectHeight);
+        void evict(uint32_t page);
+        void markDirty(uint32_t x, uint32_t y, uint32_t rectWidth, uint32_t rectHeight);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_GLYPH_ATLAS_HPP
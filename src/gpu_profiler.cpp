@@ -0,0 +1,189 @@
+#include "gpu_profiler.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+namespace imr {
+
+    GpuProfiler::GpuProfiler(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice,
+                             uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxZonesPerFrame) {
+        auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+        uint32_t validBits = queueFamilies.at(queueFamilyIndex).timestampValidBits;
+
+        auto properties = physicalDevice.getProperties();
+        if (validBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+            std::cerr << "Timestamp queries are not supported, GPU profiling is disabled\n";
+            return;
+        }
+
+        this->timestampPeriod = properties.limits.timestampPeriod;
+        this->timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+        this->maxQueriesPerFrame = maxZonesPerFrame * 2;
+        this->frames.resize(framesInFlight);
+        this->timestamps.resize(this->maxQueriesPerFrame);
+        this->traceEvents.reserve(MaxTraceEvents);
+
+        vk::QueryPoolCreateInfo poolInfo {
+                {},
+                vk::QueryType::eTimestamp,
+                this->maxQueriesPerFrame * framesInFlight
+        };
+
+        this->queryPool = device.createQueryPool(poolInfo);
+    }
+
+    uint32_t GpuProfiler::internName(std::string_view name) {
+        auto it = this->nameIds.find(name);
+        if (it != this->nameIds.end()) return it->second;
+
+        auto id = static_cast<uint32_t>(this->names.size());
+        this->names.emplace_back(name);
+        this->nameIds.emplace(name, id);
+        this->histories.emplace_back();
+
+        return id;
+    }
+
+    void GpuProfiler::resolve(uint32_t frameSlot) {
+        FrameQueries& frame = this->frames[frameSlot];
+        if (frame.queryCount == 0) return;
+
+        // The slot's fence has already been waited on, so this either succeeds right away or the frame was never submitted
+        auto result = static_cast<vk::Result>(this->queryPool.getDispatcher()->vkGetQueryPoolResults(
+                static_cast<VkDevice>(this->queryPool.getDevice()), static_cast<VkQueryPool>(*this->queryPool),
+                frameSlot * this->maxQueriesPerFrame, frame.queryCount,
+                frame.queryCount * sizeof(uint64_t), this->timestamps.data(), sizeof(uint64_t),
+                static_cast<VkQueryResultFlags>(vk::QueryResultFlagBits::e64)));
+
+        if (result == vk::Result::eSuccess) {
+            for (const auto& zone : frame.zones) {
+                if (zone.endQuery == UINT32_MAX) continue;
+
+                uint64_t begin = this->timestamps[zone.beginQuery] & this->timestampMask;
+                uint64_t end = this->timestamps[zone.endQuery] & this->timestampMask;
+                double durationNs = static_cast<double>((end - begin) & this->timestampMask) * this->timestampPeriod;
+
+                ZoneHistory& history = this->histories[zone.name];
+                if (history.samples.size() < SamplesPerZone) {
+                    history.samples.push_back(durationNs / 1e6);
+                } else {
+                    history.samples[history.next] = durationNs / 1e6;
+                }
+                history.next = (history.next + 1) % SamplesPerZone;
+                history.total++;
+
+                if (!this->hasTraceOrigin) {
+                    this->traceOrigin = begin;
+                    this->hasTraceOrigin = true;
+                }
+
+                double startUs = static_cast<double>((begin - this->traceOrigin) & this->timestampMask) * this->timestampPeriod / 1e3;
+                TraceEvent event{zone.name, startUs, durationNs / 1e3};
+                if (this->traceEvents.size() < MaxTraceEvents) {
+                    this->traceEvents.push_back(event);
+                } else {
+                    this->traceEvents[this->traceHead] = event;
+                    this->traceHead = (this->traceHead + 1) % MaxTraceEvents;
+                }
+            }
+        }
+
+        frame.zones.clear();
+        frame.queryCount = 0;
+        frame.openZones = 0;
+    }
+
+    void GpuProfiler::beginFrame(const vk::raii::CommandBuffer &cmd, uint32_t frameSlot) {
+        if (!isEnabled()) return;
+
+        resolve(frameSlot);
+
+        this->currentSlot = frameSlot;
+        cmd.resetQueryPool(*this->queryPool, frameSlot * this->maxQueriesPerFrame, this->maxQueriesPerFrame);
+    }
+
+    uint32_t GpuProfiler::beginZone(const vk::raii::CommandBuffer &cmd, std::string_view name) {
+        if (!isEnabled()) return InvalidZone;
+
+        FrameQueries& frame = this->frames[this->currentSlot];
+        // Out of queries for this frame, the zone is silently dropped. Zones that are still open keep their end query reserved.
+        if (frame.queryCount + frame.openZones + 2 > this->maxQueriesPerFrame) return InvalidZone;
+
+        uint32_t query = frame.queryCount++;
+        frame.openZones++;
+        cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *this->queryPool, this->currentSlot * this->maxQueriesPerFrame + query);
+
+        frame.zones.push_back({internName(name), query});
+        return static_cast<uint32_t>(frame.zones.size() - 1);
+    }
+
+    void GpuProfiler::endZone(const vk::raii::CommandBuffer &cmd, uint32_t zone) {
+        if (zone == InvalidZone) return;
+
+        FrameQueries& frame = this->frames[this->currentSlot];
+
+        uint32_t query = frame.queryCount++;
+        frame.openZones--;
+        cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *this->queryPool, this->currentSlot * this->maxQueriesPerFrame + query);
+
+        frame.zones[zone].endQuery = query;
+    }
+
+    std::vector<GpuZoneStats> GpuProfiler::getZoneStats() const {
+        std::vector<GpuZoneStats> result;
+
+        std::vector<double> sorted;
+        for (uint32_t i = 0; i < this->names.size(); i++) {
+            const ZoneHistory& history = this->histories[i];
+            if (history.samples.empty()) continue;
+
+            sorted = history.samples;
+            std::sort(sorted.begin(), sorted.end());
+
+            double sum = 0.0;
+            for (double s : sorted) sum += s;
+
+            size_t p99Index = std::min(sorted.size() - 1, (sorted.size() * 99) / 100);
+
+            result.push_back({
+                this->names[i],
+                history.total,
+                sorted.front(),
+                sum / static_cast<double>(sorted.size()),
+                sorted[p99Index]
+            });
+        }
+
+        return result;
+    }
+
+    void GpuProfiler::writeChromeTrace(std::ostream &out) const {
+        auto writeEscaped = [&out](const std::string& text) {
+            for (char c : text) {
+                if (c == '"' || c == '\\') out << '\\';
+                out << c;
+            }
+        };
+
+        std::ios oldState(nullptr);
+        oldState.copyfmt(out);
+
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        for (size_t i = 0; i < this->traceEvents.size(); i++) {
+            const TraceEvent& event = this->traceEvents[(this->traceHead + i) % this->traceEvents.size()];
+            out << (first ? "" : ",") << "\n{\"name\":\"";
+            writeEscaped(this->names[event.name]);
+            out << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0"
+                << std::fixed << std::setprecision(3)
+                << ",\"ts\":" << event.startUs
+                << ",\"dur\":" << event.durationUs << "}";
+            first = false;
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        out.copyfmt(oldState);
+    }
+
+} // imr
@@ -0,0 +1,104 @@
+#ifndef VK_IMM_RENDERER_GPU_PROFILER_HPP
+#define VK_IMM_RENDERER_GPU_PROFILER_HPP
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "vulkan/vulkan_raii.hpp"
+
+namespace imr {
+
+    struct GpuZoneStats {
+        std::string name;
+        uint64_t sampleCount = 0;
+        double minMs = 0.0;
+        double avgMs = 0.0;
+        double p99Ms = 0.0;
+    };
+
+    // Timestamp query based GPU timing. Every frame slot owns its own range of queries, results are read back
+    // when the slot comes around again, after its fence has signalled, so reading never stalls.
+    class GpuProfiler {
+    public:
+        static constexpr uint32_t InvalidZone = UINT32_MAX;
+
+        GpuProfiler() = default;
+        GpuProfiler(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice,
+                    uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxZonesPerFrame = 512);
+
+        // Collects the slot's previous results and resets its queries, must be recorded outside a render pass
+        void beginFrame(const vk::raii::CommandBuffer& cmd, uint32_t frameSlot);
+
+        uint32_t beginZone(const vk::raii::CommandBuffer& cmd, std::string_view name);
+        void endZone(const vk::raii::CommandBuffer& cmd, uint32_t zone);
+
+        [[nodiscard]] std::vector<GpuZoneStats> getZoneStats() const;
+        void writeChromeTrace(std::ostream& out) const;
+
+        [[nodiscard]] bool isEnabled() const { return static_cast<bool>(*this->queryPool); }
+
+    private:
+        struct PendingZone {
+            uint32_t name;
+            uint32_t beginQuery;
+            uint32_t endQuery = UINT32_MAX;
+        };
+
+        struct FrameQueries {
+            std::vector<PendingZone> zones;
+            uint32_t queryCount = 0;
+            uint32_t openZones = 0;
+        };
+
+        struct ZoneHistory {
+            std::vector<double> samples;
+            size_t next = 0;
+            uint64_t total = 0;
+        };
+
+        struct TraceEvent {
+            uint32_t name;
+            double startUs;
+            double durationUs;
+        };
+
+        static constexpr size_t SamplesPerZone = 512;
+        static constexpr size_t MaxTraceEvents = 16384;
+
+        vk::raii::QueryPool queryPool{VK_NULL_HANDLE};
+        uint32_t maxQueriesPerFrame = 0;
+        double timestampPeriod = 1.0;
+        uint64_t timestampMask = ~0ull;
+
+        std::vector<FrameQueries> frames;
+        uint32_t currentSlot = 0;
+        // Read back into, getResults would hand out a new vector every frame
+        std::vector<uint64_t> timestamps;
+
+        // Transparent so looking up a zone name doesn't build a std::string every frame
+        struct NameHash {
+            using is_transparent = void;
+            size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+        };
+
+        std::vector<std::string> names;
+        std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> nameIds;
+        std::vector<ZoneHistory> histories;
+
+        // Ring of the last MaxTraceEvents, the oldest at traceHead once it's full
+        std::vector<TraceEvent> traceEvents;
+        size_t traceHead = 0;
+        uint64_t traceOrigin = 0;
+        bool hasTraceOrigin = false;
+
+        uint32_t internName(std::string_view name);
+        void resolve(uint32_t frameSlot);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_GPU_PROFILER_HPP
@@ -0,0 +1,445 @@
+#include "image_io.hpp"
+
+#include <bit>
+#include <array>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <charconv>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+namespace imr {
+
+    namespace {
+
+        // Reads whitespace separated header tokens, skipping # comments
+        class HeaderReader {
+        public:
+            explicit HeaderReader(std::string_view data) : data(data) {}
+
+            std::string_view token() {
+                skip();
+                size_t start = this->position;
+                while (this->position < this->data.size() && !isSpace(this->data[this->position])) this->position++;
+                return this->data.substr(start, this->position - start);
+            }
+
+            std::optional<uint32_t> number() {
+                std::string_view text = token();
+                uint32_t value = 0;
+                auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+                if (error != std::errc() || end != text.data() + text.size()) return std::nullopt;
+                return value;
+            }
+
+            // The single whitespace character that ends the header
+            size_t dataOffset() const { return this->position + 1; }
+
+        private:
+            std::string_view data;
+            size_t position = 0;
+
+            static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+            void skip() {
+                while (this->position < this->data.size()) {
+                    if (this->data[this->position] == '#') {
+                        while (this->position < this->data.size() && this->data[this->position] != '\n') this->position++;
+                    } else if (isSpace(this->data[this->position])) {
+                        this->position++;
+                    } else {
+                        break;
+                    }
+                }
+            }
+        };
+
+        std::optional<ImageData> expand(std::string_view data, size_t offset, uint32_t width, uint32_t height, uint32_t channels) {
+            if (width == 0 || height == 0 || channels == 0 || channels > 4) return std::nullopt;
+
+            size_t texels = static_cast<size_t>(width) * height;
+            if (offset > data.size() || data.size() - offset < texels * channels) return std::nullopt;
+
+            ImageData image{width, height, std::vector<uint8_t>(texels * 4)};
+            auto* in = reinterpret_cast<const uint8_t*>(data.data() + offset);
+            uint8_t* out = image.pixels.data();
+
+            for (size_t i = 0; i < texels; i++, in += channels, out += 4) {
+                switch (channels) {
+                    case 1: out[0] = out[1] = out[2] = in[0]; out[3] = 255; break;
+                    case 2: out[0] = out[1] = out[2] = in[0]; out[3] = in[1]; break;
+                    case 3: out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = 255; break;
+                    default: out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = in[3]; break;
+                }
+            }
+
+            return image;
+        }
+
+        std::optional<ImageData> decodePpm(std::string_view data) {
+            HeaderReader header(data);
+            header.token();
+
+            auto width = header.number();
+            auto height = header.number();
+            auto maxValue = header.number();
+            if (!width || !height || maxValue != 255u) return std::nullopt;
+
+            return expand(data, header.dataOffset(), *width, *height, 3);
+        }
+
+        std::optional<ImageData> decodePam(std::string_view data) {
+            HeaderReader header(data);
+            header.token();
+
+            uint32_t width = 0, height = 0, depth = 0, maxValue = 0;
+            while (true) {
+                std::string_view key = header.token();
+                if (key.empty()) return std::nullopt;
+                if (key == "ENDHDR") break;
+
+                if (key == "TUPLTYPE") {
+                    header.token();
+                    continue;
+                }
+
+                auto value = header.number();
+                if (!value) return std::nullopt;
+
+                if (key == "WIDTH") width = *value;
+                else if (key == "HEIGHT") height = *value;
+                else if (key == "DEPTH") depth = *value;
+                else if (key == "MAXVAL") maxValue = *value;
+            }
+
+            if (maxValue != 255) return std::nullopt;
+            return expand(data, header.dataOffset(), width, height, depth);
+        }
+
+
+        // Deflate's bit order: values LSB first, Huffman codes MSB first
+        class BitWriter {
+        public:
+            explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+            void bits(uint32_t value, uint32_t count) {
+                this->buffer |= static_cast<uint64_t>(value) << this->count;
+                this->count += count;
+
+                while (this->count >= 8) {
+                    this->out.push_back(static_cast<uint8_t>(this->buffer));
+                    this->buffer >>= 8;
+                    this->count -= 8;
+                }
+            }
+
+            void flush() {
+                if (this->count > 0) this->out.push_back(static_cast<uint8_t>(this->buffer));
+                this->buffer = 0;
+                this->count = 0;
+            }
+
+        private:
+            std::vector<uint8_t>& out;
+            uint64_t buffer = 0;
+            uint32_t count = 0;
+        };
+
+        struct HuffmanCode {
+            uint16_t bits;
+            uint8_t length;
+        };
+
+        // The fixed literal/length codes, bit reversed so they can be written LSB first
+        const std::array<HuffmanCode, 288>& getFixedCodes() {
+            static const std::array<HuffmanCode, 288> codes = [] {
+                std::array<HuffmanCode, 288> table{};
+
+                for (uint32_t symbol = 0; symbol < 288; symbol++) {
+                    uint32_t code, length;
+                    if (symbol < 144) { code = 0x30 + symbol; length = 8; }
+                    else if (symbol < 256) { code = 0x190 + symbol - 144; length = 9; }
+                    else if (symbol < 280) { code = symbol - 256; length = 7; }
+                    else { code = 0xC0 + symbol - 280; length = 8; }
+
+                    uint32_t reversed = 0;
+                    for (uint32_t bit = 0; bit < length; bit++) reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+                    table[symbol] = {static_cast<uint16_t>(reversed), static_cast<uint8_t>(length)};
+                }
+
+                return table;
+            }();
+
+            return codes;
+        }
+
+        void writeMatch(BitWriter& writer, const std::array<HuffmanCode, 288>& codes, uint32_t length, uint32_t distance) {
+            // Lengths 3 to 258 map to symbols 257 to 285, 4 per extra bit count
+            uint32_t value = length - 3;
+            if (value == 255) {
+                writer.bits(codes[285].bits, codes[285].length);
+            } else if (value < 8) {
+                writer.bits(codes[257 + value].bits, codes[257 + value].length);
+            } else {
+                uint32_t extra = std::bit_width(value) - 3;
+                uint32_t symbol = 257 + 4 * (extra + 1) + ((value >> extra) & 3);
+                writer.bits(codes[symbol].bits, codes[symbol].length);
+                writer.bits(value & ((1u << extra) - 1), extra);
+            }
+
+            // Distances 1 to 32768 map to codes 0 to 29, 2 per extra bit count, written as 5 fixed bits
+            uint32_t d = distance - 1;
+            uint32_t code = d < 4 ? d : 2 * (std::bit_width(d) - 1) + ((d >> (std::bit_width(d) - 2)) & 1);
+            uint32_t reversed = 0;
+            for (uint32_t bit = 0; bit < 5; bit++) reversed |= ((code >> bit) & 1) << (4 - bit);
+            writer.bits(reversed, 5);
+
+            if (code >= 4) {
+                uint32_t extra = code / 2 - 1;
+                writer.bits(d & ((1u << extra) - 1), extra);
+            }
+        }
+
+        // zlib stream of a single fixed Huffman block. LZ77 matches come from hash chains over 4 byte prefixes,
+        // cut short after a few candidates since rendered images mostly repeat the pixel or row right before.
+        std::vector<uint8_t> deflate(std::span<const uint8_t> data) {
+            constexpr uint32_t WindowSize = 32768;
+            constexpr uint32_t HashBits = 15;
+            constexpr uint32_t MaxChain = 8;
+            constexpr uint32_t MinMatch = 4;
+            constexpr uint32_t MaxMatch = 258;
+
+            std::vector<uint8_t> out;
+            out.reserve(data.size() / 4 + 64);
+            out.push_back(0x78);
+            out.push_back(0x01);
+
+            BitWriter writer(out);
+            const auto& codes = getFixedCodes();
+            // BFINAL, fixed Huffman codes
+            writer.bits(1, 1);
+            writer.bits(1, 2);
+
+            std::vector<int32_t> head(1u << HashBits, -1);
+            std::vector<int32_t> chain(WindowSize, -1);
+
+            auto hash = [&](size_t position) {
+                uint32_t value;
+                std::memcpy(&value, data.data() + position, 4);
+                return (value * 2654435761u) >> (32 - HashBits);
+            };
+
+            auto insert = [&](size_t position) {
+                uint32_t h = hash(position);
+                chain[position & (WindowSize - 1)] = head[h];
+                head[h] = static_cast<int32_t>(position);
+            };
+
+            size_t size = data.size();
+            size_t position = 0;
+            while (position < size) {
+                uint32_t bestLength = 0;
+                uint32_t bestDistance = 0;
+
+                if (position + MinMatch <= size) {
+                    uint32_t limit = static_cast<uint32_t>(std::min<size_t>(MaxMatch, size - position));
+                    int32_t candidate = head[hash(position)];
+
+                    for (uint32_t step = 0; step < MaxChain && candidate >= 0 && position - candidate <= WindowSize; step++) {
+                        const uint8_t* a = data.data() + position;
+                        const uint8_t* b = data.data() + candidate;
+
+                        if (b[bestLength] == a[bestLength] || bestLength == 0) {
+                            uint32_t length = 0;
+                            while (length < limit && a[length] == b[length]) length++;
+
+                            if (length > bestLength) {
+                                bestLength = length;
+                                bestDistance = static_cast<uint32_t>(position - candidate);
+                                if (length == limit) break;
+                            }
+                        }
+
+                        int32_t next = chain[candidate & (WindowSize - 1)];
+                        if (next >= candidate) break;
+                        candidate = next;
+                    }
+                }
+
+                if (bestLength >= MinMatch) {
+                    writeMatch(writer, codes, bestLength, bestDistance);
+
+                    size_t end = position + bestLength;
+                    for (; position < end; position++) {
+                        if (position + MinMatch <= size) insert(position);
+                    }
+                } else {
+                    writer.bits(codes[data[position]].bits, codes[data[position]].length);
+                    if (position + MinMatch <= size) insert(position);
+                    position++;
+                }
+            }
+
+            writer.bits(codes[256].bits, codes[256].length);
+            writer.flush();
+
+            uint32_t a = 1, b = 0;
+            for (size_t offset = 0; offset < size;) {
+                // Sums stay below 2^32 for this many bytes before they have to be reduced
+                size_t end = std::min<size_t>(size, offset + 5552);
+                for (; offset < end; offset++) {
+                    a += data[offset];
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+            }
+
+            uint32_t adler = (b << 16) | a;
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(adler >> shift));
+
+            return out;
+        }
+
+        uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+            static const std::array<uint32_t, 256> table = [] {
+                std::array<uint32_t, 256> entries{};
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t c = i;
+                    for (int bit = 0; bit < 8; bit++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    entries[i] = c;
+                }
+                return entries;
+            }();
+
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+        }
+
+        void appendChunk(std::vector<uint8_t>& out, const char (&type)[5], std::span<const uint8_t> data) {
+            appendBigEndian(out, static_cast<uint32_t>(data.size()));
+
+            size_t start = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data.begin(), data.end());
+
+            appendBigEndian(out, crc32(0, out.data() + start, out.size() - start));
+        }
+
+    }
+
+    std::optional<ImageData> loadImage(const std::filesystem::path &path) {
+        std::ifstream file{path, std::ios::binary};
+        if (!file.is_open()) return std::nullopt;
+
+        std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        std::string_view view = data;
+
+        if (view.starts_with("P6")) return decodePpm(view);
+        if (view.starts_with("P7")) return decodePam(view);
+
+        return std::nullopt;
+    }
+
+    const char* getImageFileExtension(ImageFileFormat format) {
+        switch (format) {
+            case ImageFileFormat::eRaw: return "rgba";
+            case ImageFileFormat::ePam: return "pam";
+            case ImageFileFormat::ePng: return "png";
+        }
+        return "";
+    }
+
+    std::vector<uint8_t> encodePng(uint32_t width, uint32_t height, std::span<const uint8_t> pixels) {
+        size_t rowBytes = static_cast<size_t>(width) * 4;
+        if (width == 0 || height == 0 || pixels.size() != rowBytes * height) throw std::runtime_error("Invalid image size");
+
+        // Every row is led by its filter type
+        std::vector<uint8_t> filtered((rowBytes + 1) * height);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t* row = pixels.data() + y * rowBytes;
+            const uint8_t* above = y > 0 ? row - rowBytes : nullptr;
+            uint8_t* out = filtered.data() + y * (rowBytes + 1);
+
+            // Smallest sum of the residuals as signed bytes, the usual guess at what compresses best
+            auto cost = [&](auto&& predict) {
+                uint32_t sum = 0;
+                for (size_t i = 0; i < rowBytes; i++) sum += std::abs(static_cast<int8_t>(row[i] - predict(i)));
+                return sum;
+            };
+            auto none = [](size_t) { return uint8_t(0); };
+            auto sub = [&](size_t i) { return i >= 4 ? row[i - 4] : uint8_t(0); };
+            auto up = [&](size_t i) { return above ? above[i] : uint8_t(0); };
+
+            uint32_t noneCost = cost(none);
+            uint32_t subCost = cost(sub);
+            uint32_t upCost = above ? cost(up) : UINT32_MAX;
+
+            if (subCost < noneCost && subCost <= upCost) {
+                out[0] = 1;
+                for (size_t i = 0; i < rowBytes; i++) out[i + 1] = static_cast<uint8_t>(row[i] - sub(i));
+            } else if (upCost < noneCost) {
+                out[0] = 2;
+                for (size_t i = 0; i < rowBytes; i++) out[i + 1] = static_cast<uint8_t>(row[i] - above[i]);
+            } else {
+                out[0] = 0;
+                std::memcpy(out + 1, row, rowBytes);
+            }
+        }
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+        std::vector<uint8_t> header;
+        appendBigEndian(header, width);
+        appendBigEndian(header, height);
+        // 8 bit RGBA, deflate, adaptive filtering, not interlaced
+        header.insert(header.end(), {8, 6, 0, 0, 0});
+
+        std::vector<uint8_t> compressed = deflate(filtered);
+        png.reserve(png.size() + compressed.size() + 64);
+
+        appendChunk(png, "IHDR", header);
+        appendChunk(png, "IDAT", compressed);
+        appendChunk(png, "IEND", {});
+
+        return png;
+    }
+
+    bool writeImage(const std::filesystem::path &path, uint32_t width, uint32_t height,
+                    std::span<const uint8_t> pixels, ImageFileFormat format) {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        if (!file.is_open()) return false;
+
+        auto write = [&](std::span<const uint8_t> bytes) {
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        };
+
+        switch (format) {
+            case ImageFileFormat::eRaw:
+                write(pixels);
+                break;
+            case ImageFileFormat::ePam: {
+                std::string header = "P7\nWIDTH " + std::to_string(width) + "\nHEIGHT " + std::to_string(height) +
+                                     "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+                file.write(header.data(), static_cast<std::streamsize>(header.size()));
+                write(pixels);
+                break;
+            }
+            case ImageFileFormat::ePng:
+                write(encodePng(width, height, pixels));
+                break;
+        }
+
+        return file.good();
+    }
+
+} // imr
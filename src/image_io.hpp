@@ -0,0 +1,44 @@
+#ifndef VK_IMM_RENDERER_IMAGE_IO_HPP
+#define VK_IMM_RENDERER_IMAGE_IO_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+namespace imr {
+
+    struct ImageData {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Tightly packed RGBA8 rows
+        std::vector<uint8_t> pixels;
+    };
+
+    // Binary Netpbm only: PPM (P6) and PAM (P7) with 8 bit channels, grayscale and RGB are expanded to RGBA.
+    // Returns nothing if the file can't be read or isn't in a supported format.
+    std::optional<ImageData> loadImage(const std::filesystem::path& path);
+
+    enum class ImageFileFormat : uint8_t {
+        // The RGBA8 rows as they are, nothing else
+        eRaw,
+        // Uncompressed, loadImage reads it back
+        ePam,
+        ePng
+    };
+
+    // Without the dot, e.g. "png"
+    const char* getImageFileExtension(ImageFileFormat format);
+
+    // 8 bit RGBA PNG. Rows are filtered with None, Sub or Up, whichever looks smallest, and deflated with the
+    // fixed Huffman codes: fast and good enough for rendered images, not as small as zlib's best.
+    std::vector<uint8_t> encodePng(uint32_t width, uint32_t height, std::span<const uint8_t> pixels);
+
+    // Pixels are tightly packed RGBA8 rows. Returns false if the file can't be written.
+    bool writeImage(const std::filesystem::path& path, uint32_t width, uint32_t height,
+                    std::span<const uint8_t> pixels, ImageFileFormat format);
+
+} // imr
+
+#endif //VK_IMM_RENDERER_IMAGE_IO_HPP
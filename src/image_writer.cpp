@@ -0,0 +1,119 @@
+#include "image_writer.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace imr {
+
+    ImageWriter::ImageWriter(const ImageWriterConfig &config) : config(config) {
+        if (this->config.workerThreads == 0) this->config.workerThreads = 1;
+        if (this->config.maxQueuedImages == 0) this->config.maxQueuedImages = 1;
+
+        for (uint32_t i = 0; i < this->config.workerThreads; i++) {
+            this->workers.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+    }
+
+    ImageWriter::~ImageWriter() {
+        {
+            std::unique_lock lock(this->mutex);
+            this->jobDone.wait(lock, [this] { return this->jobs.empty() && this->activeJobs == 0; });
+            if (!this->error.empty()) std::cerr << this->error << '\n';
+        }
+
+        this->workers.clear();
+    }
+
+    std::vector<uint8_t> ImageWriter::takeBuffer() {
+        std::scoped_lock lock(this->mutex);
+        if (this->freeBuffers.empty()) return {};
+
+        std::vector<uint8_t> buffer = std::move(this->freeBuffers.back());
+        this->freeBuffers.pop_back();
+        return buffer;
+    }
+
+    void ImageWriter::write(std::filesystem::path path, ImageData image) {
+        path += ".";
+        path += getImageFileExtension(this->config.format);
+
+        {
+            std::unique_lock lock(this->mutex);
+            throwError();
+
+            // Backpressure, the renderer can't run further ahead than the queue allows
+            this->jobDone.wait(lock, [this] { return this->jobs.size() < this->config.maxQueuedImages || !this->error.empty(); });
+            throwError();
+
+            this->jobs.push_back({std::move(path), std::move(image)});
+        }
+        this->jobAvailable.notify_one();
+    }
+
+    void ImageWriter::finish() {
+        std::unique_lock lock(this->mutex);
+        this->jobDone.wait(lock, [this] { return this->jobs.empty() && this->activeJobs == 0; });
+        throwError();
+    }
+
+    ImageWriterStats ImageWriter::getStats() {
+        std::scoped_lock lock(this->mutex);
+        return this->stats;
+    }
+
+    void ImageWriter::throwError() {
+        if (this->error.empty()) return;
+
+        std::string message = std::move(this->error);
+        this->error.clear();
+        throw std::runtime_error(message);
+    }
+
+    void ImageWriter::work(std::stop_token stop) {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock lock(this->mutex);
+                if (!this->jobAvailable.wait(lock, stop, [this] { return !this->jobs.empty(); })) return;
+
+                job = std::move(this->jobs.front());
+                this->jobs.pop_front();
+                this->activeJobs++;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            bool written = false;
+            std::string reason;
+            try {
+                written = writeImage(job.path, job.image.width, job.image.height, job.image.pixels, this->config.format);
+            } catch (const std::exception& e) {
+                written = false;
+                reason = e.what();
+            }
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::error_code sizeError;
+            uintmax_t size = written ? std::filesystem::file_size(job.path, sizeError) : 0;
+
+            {
+                std::scoped_lock lock(this->mutex);
+                this->activeJobs--;
+
+                if (written) {
+                    this->stats.images++;
+                    this->stats.bytes += sizeError ? 0 : size;
+                    this->stats.encodeSeconds += seconds;
+                } else if (this->error.empty()) {
+                    this->error = "Failed to write image: " + job.path.string();
+                    if (!reason.empty()) this->error += ": " + reason;
+                }
+
+                this->freeBuffers.push_back(std::move(job.image.pixels));
+            }
+            this->jobDone.notify_all();
+        }
+    }
+
+} // imr
@@ -0,0 +1,85 @@
+#ifndef VK_IMM_RENDERER_IMAGE_WRITER_HPP
+#define VK_IMM_RENDERER_IMAGE_WRITER_HPP
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+#include <condition_variable>
+
+#include "image_io.hpp"
+
+namespace imr {
+
+    struct ImageWriterConfig {
+        ImageFileFormat format = ImageFileFormat::ePng;
+        // Encoding is what takes time, the main thread keeps one core to render with
+        uint32_t workerThreads = std::clamp(std::thread::hardware_concurrency(), 2u, 9u) - 1;
+        // Images waiting to be written before write() blocks, bounds the memory held by a slow disk or encoder
+        uint32_t maxQueuedImages = 8;
+    };
+
+    struct ImageWriterStats {
+        uint64_t images = 0;
+        uint64_t bytes = 0;
+        // Summed over the workers, so it can exceed the wall clock time
+        double encodeSeconds = 0.0;
+    };
+
+    // Encodes and writes images to disk on worker threads. The pixel buffers go back into a pool once written,
+    // so a steady stream of frames of one size stops allocating after the first few.
+    class ImageWriter {
+    public:
+        explicit ImageWriter(const ImageWriterConfig& config);
+
+        // The workers hold on to this
+        ImageWriter(const ImageWriter&) = delete;
+        ImageWriter& operator=(const ImageWriter&) = delete;
+
+        // Finishes the queued images
+        ~ImageWriter();
+
+        // An empty buffer, or one of a written image with its capacity intact
+        std::vector<uint8_t> takeBuffer();
+
+        // Queues the image, blocking while maxQueuedImages are waiting. The extension of the configured format
+        // is appended to path. Throws if an earlier image failed to be written.
+        void write(std::filesystem::path path, ImageData image);
+        // Returns once everything queued is on disk, throws like write()
+        void finish();
+
+        [[nodiscard]] const ImageWriterConfig& getConfig() const { return this->config; }
+        [[nodiscard]] ImageWriterStats getStats();
+
+    private:
+        struct Job {
+            std::filesystem::path path;
+            ImageData image;
+        };
+
+        ImageWriterConfig config;
+
+        std::mutex mutex;
+        std::condition_variable_any jobAvailable;
+        // Signalled whenever a job has been written
+        std::condition_variable jobDone;
+        std::deque<Job> jobs;
+        uint32_t activeJobs = 0;
+        std::vector<std::vector<uint8_t>> freeBuffers;
+        ImageWriterStats stats;
+        // The first failure, reported to the main thread by its next call
+        std::string error;
+
+        std::vector<std::jthread> workers;
+
+        void work(std::stop_token stop);
+        void throwError();
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_IMAGE_WRITER_HPP
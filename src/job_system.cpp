@@ -0,0 +1,128 @@
+#include "job_system.hpp"
+
+#include <span>
+#include <array>
+#include <algorithm>
+
+namespace imr {
+
+    // Which system the current thread belongs to, and as which thread
+    static thread_local const JobSystem* currentSystem = nullptr;
+    static thread_local uint32_t currentThread = 0;
+
+    JobSystem::JobSystem(uint32_t threadCount) :
+            threadCount(threadCount != 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u)) {
+
+        for (uint32_t thread = 0; thread < this->threadCount; thread++) {
+            this->deques.push_back(std::make_unique<WorkStealingDeque<Job>>(DequeCapacity));
+        }
+        this->scratch.resize(this->threadCount);
+
+        currentSystem = this;
+        currentThread = 0;
+
+        for (uint32_t thread = 1; thread < this->threadCount; thread++) {
+            this->workers.emplace_back([this, thread] { workerLoop(thread); });
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        this->stopping.store(true);
+        this->epoch.fetch_add(1);
+        this->epoch.notify_all();
+
+        for (auto& worker : this->workers) worker.join();
+
+        if (currentSystem == this) currentSystem = nullptr;
+    }
+
+    uint32_t JobSystem::getThreadIndex() const {
+        return currentSystem == this ? currentThread : 0;
+    }
+
+    void JobSystem::dispatch(uint32_t count, Callback callback) {
+        if (count == 0) return;
+
+        // Nothing to gain from queueing, and foreign threads have no deque to push to
+        if (count == 1 || this->threadCount == 1 || currentSystem != this) {
+            for (uint32_t index = 0; index < count; index++) callback.invoke(callback.context, index);
+            return;
+        }
+
+        uint32_t self = currentThread;
+        Batch batch{callback, count, {}, nullptr};
+        std::array<Job, InlineJobs> inlineJobs;
+        std::span<Job> jobs = std::span<Job>(inlineJobs).first(std::min(count, InlineJobs));
+
+        // Jobs run while waiting may dispatch again on this thread, every level keeps its own array
+        JobScratch& jobScratch = this->scratch[self];
+        if (count > InlineJobs) {
+            if (jobScratch.levels.size() <= jobScratch.depth) jobScratch.levels.emplace_back();
+            std::vector<Job>& levelJobs = jobScratch.levels[jobScratch.depth];
+            if (levelJobs.size() < count) levelJobs.resize(count);
+
+            jobs = std::span<Job>(levelJobs).first(count);
+            jobScratch.depth++;
+        }
+
+        // Pushed back to front, the owner pops the first job and thieves take the last ones
+        auto& deque = *this->deques[self];
+        for (uint32_t index = count; index-- > 0;) {
+            jobs[index] = {&batch, index};
+            if (!deque.push(&jobs[index])) run(jobs[index]);
+        }
+
+        this->epoch.fetch_add(1, std::memory_order_release);
+        this->epoch.notify_all();
+
+        // Helps out instead of blocking, the jobs of other batches included
+        while (batch.remaining.load(std::memory_order_acquire) != 0) {
+            if (Job* job = findJob(self)) run(*job);
+            else std::this_thread::yield();
+        }
+
+        if (count > InlineJobs) jobScratch.depth--;
+        if (batch.error) std::rethrow_exception(batch.error);
+    }
+
+    JobSystem::Job *JobSystem::findJob(uint32_t thread) {
+        if (Job* job = this->deques[thread]->pop()) return job;
+
+        for (uint32_t offset = 1; offset < this->threadCount; offset++) {
+            if (Job* job = this->deques[(thread + offset) % this->threadCount]->steal()) return job;
+        }
+
+        return nullptr;
+    }
+
+    void JobSystem::run(const Job &job) {
+        Batch* batch = job.batch;
+
+        try {
+            batch->callback.invoke(batch->callback.context, job.index);
+        } catch (...) {
+            if (!batch->failed.test_and_set()) batch->error = std::current_exception();
+        }
+
+        // The batch may be gone right after the last job is counted
+        batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void JobSystem::workerLoop(uint32_t thread) {
+        currentSystem = this;
+        currentThread = thread;
+
+        while (!this->stopping.load(std::memory_order_acquire)) {
+            // Read before looking for work, jobs pushed after the search change it and cut the wait short
+            uint32_t seen = this->epoch.load(std::memory_order_acquire);
+
+            if (Job* job = findJob(thread)) {
+                run(*job);
+                continue;
+            }
+
+            this->epoch.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+} // imr
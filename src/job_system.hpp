@@ -0,0 +1,153 @@
+#ifndef VK_IMM_RENDERER_JOB_SYSTEM_HPP
+#define VK_IMM_RENDERER_JOB_SYSTEM_HPP
+
+#include <bit>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <type_traits>
+
+namespace imr {
+
+    // Fixed size Chase-Lev deque. The owning thread pushes and pops at the bottom, any thread steals from the top.
+    template<typename T>
+    class WorkStealingDeque {
+    public:
+        explicit WorkStealingDeque(uint32_t capacity) :
+                capacity(std::bit_ceil(capacity)), buffer(std::make_unique<std::atomic<T*>[]>(this->capacity)) {}
+
+        // Owner only, false if the deque is full
+        bool push(T* item) {
+            int64_t b = this->bottom.load(std::memory_order_relaxed);
+            int64_t t = this->top.load(std::memory_order_acquire);
+            if (b - t >= static_cast<int64_t>(this->capacity)) return false;
+
+            this->buffer[b & (this->capacity - 1)].store(item, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            this->bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Owner only, newest first
+        T* pop() {
+            int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+            this->bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = this->top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T* item = this->buffer[b & (this->capacity - 1)].load(std::memory_order_relaxed);
+            if (t == b) {
+                // The last item, a thief may be taking it at the same time
+                if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) item = nullptr;
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // Any thread, oldest first. Null if empty or another thread won the item.
+        T* steal() {
+            int64_t t = this->top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = this->bottom.load(std::memory_order_acquire);
+            if (t >= b) return nullptr;
+
+            T* item = this->buffer[t & (this->capacity - 1)].load(std::memory_order_relaxed);
+            if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+            return item;
+        }
+
+    private:
+        uint32_t capacity;
+        std::unique_ptr<std::atomic<T*>[]> buffer;
+        // Apart, thieves hammer top while the owner works the bottom
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+    };
+
+    // One worker per core besides the thread that creates the system, which takes part as thread 0 while it waits
+    // for its jobs. Every thread owns a deque, idle ones steal from the others and sleep once there is nothing left.
+    class JobSystem {
+    public:
+        // 0 picks one thread per hardware thread
+        explicit JobSystem(uint32_t threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // Calls job(index) for index in [0, count) in parallel and returns once all of them have finished. The first
+        // exception thrown by a job is rethrown here. Can be nested, waiting threads keep running jobs. Threads that
+        // aren't part of the system run the jobs themselves, one after another.
+        template<typename F>
+        void parallelFor(uint32_t count, F&& job) {
+            Callback callback {
+                    &job,
+                    [](void* context, uint32_t index) {
+                        (*static_cast<std::remove_reference_t<F>*>(context))(index);
+                    }
+            };
+
+            dispatch(count, callback);
+        }
+
+        [[nodiscard]] uint32_t getThreadCount() const { return this->threadCount; }
+        // Index of the calling thread, for per thread scratch memory. 0 for threads that aren't part of the system.
+        [[nodiscard]] uint32_t getThreadIndex() const;
+
+    private:
+        struct Callback {
+            void* context;
+            void (*invoke)(void* context, uint32_t index);
+        };
+
+        // Lives on the stack of the parallelFor that waits for it
+        struct Batch {
+            Callback callback;
+            std::atomic<uint32_t> remaining;
+            std::atomic_flag failed;
+            std::exception_ptr error;
+        };
+
+        struct Job {
+            Batch* batch;
+            uint32_t index;
+        };
+
+        // Job arrays of batches too large for the stack, one per nesting level of dispatch. They keep their
+        // capacity, so a thread only allocates the first time it dispatches a batch of a new size.
+        struct JobScratch {
+            std::vector<std::vector<Job>> levels;
+            uint32_t depth = 0;
+        };
+
+        static constexpr uint32_t DequeCapacity = 4096;
+        // Jobs of a batch up to this size live on the dispatching thread's stack
+        static constexpr uint32_t InlineJobs = 64;
+
+        uint32_t threadCount;
+        std::vector<std::unique_ptr<WorkStealingDeque<Job>>> deques;
+        // Indexed by thread, only touched by the thread itself
+        std::vector<JobScratch> scratch;
+        std::vector<std::thread> workers;
+
+        // Bumped whenever jobs are pushed, sleeping workers wait for it to change
+        std::atomic<uint32_t> epoch{0};
+        std::atomic<bool> stopping{false};
+
+        void dispatch(uint32_t count, Callback callback);
+        Job* findJob(uint32_t thread);
+        static void run(const Job& job);
+        void workerLoop(uint32_t thread);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_JOB_SYSTEM_HPP
@@ -1,12 +1,52 @@
 #include "app_base.hpp"
 
-class MyApp : public imr::AppBase {
+#include <string>
+#include <string_view>
 
+class MyApp : public imr::AppBase {
+public:
+    explicit MyApp(const imr::AppConfig& config) : AppBase(config) {}
 };
 
-int main() {
+int main(int argc, char** argv) {
+    imr::AppConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--headless") {
+            config.headless = true;
+            config.maxFrames = 100;
+        } else if (arg == "--startup-summary") {
+            config.printStartupSummary = true;
+        } else if (arg == "--startup-trace" && i + 1 < argc) {
+            config.startupTracePath = argv[++i];
+        } else if (arg == "--latency" && i + 1 < argc) {
+            std::string_view policy = argv[++i];
+            if (policy == "low") config.latencyPolicy = imr::LatencyPolicy::eLowLatency;
+            else if (policy == "vsync") config.latencyPolicy = imr::LatencyPolicy::eVsync;
+            else if (policy == "throughput") config.latencyPolicy = imr::LatencyPolicy::eThroughput;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            config.targetFrameRate = std::stod(argv[++i]);
+        } else if (arg == "--latency-summary") {
+            config.printLatencySummary = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            config.headless = true;
+            if (config.maxFrames == 0) config.maxFrames = 100;
+            config.batchOutputDirectory = argv[++i];
+        } else if (arg == "--batch-format" && i + 1 < argc) {
+            std::string_view format = argv[++i];
+            if (format == "png") config.batchOutput.format = imr::ImageFileFormat::ePng;
+            else if (format == "raw") config.batchOutput.format = imr::ImageFileFormat::eRaw;
+            else if (format == "pam") config.batchOutput.format = imr::ImageFileFormat::ePam;
+        } else if (arg == "--encoder-threads" && i + 1 < argc) {
+            config.batchOutput.workerThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--frames" && i + 1 < argc) {
+            config.maxFrames = std::stoull(argv[++i]);
+        }
+    }
 
-    MyApp app;
+    MyApp app(config);
     app.run();
 
     return 0;
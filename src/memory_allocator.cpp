@@ -0,0 +1,229 @@
+#include "memory_allocator.hpp"
+
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+
+namespace imr {
+
+    namespace {
+
+        // The raw calls, blocks are plain handles so the allocator also runs without a device
+        vk::DeviceMemory allocateDeviceMemory(void* context, const vk::MemoryAllocateInfo& info, bool map, void*& mapped) {
+            const auto& device = *static_cast<const vk::raii::Device*>(context);
+            auto vkDevice = static_cast<VkDevice>(*device);
+
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            auto result = static_cast<vk::Result>(device.getDispatcher()->vkAllocateMemory(
+                    vkDevice, reinterpret_cast<const VkMemoryAllocateInfo*>(&info), nullptr, &memory));
+            if (result != vk::Result::eSuccess) throw std::runtime_error("Failed to allocate device memory: " + vk::to_string(result));
+
+            if (map) {
+                result = static_cast<vk::Result>(device.getDispatcher()->vkMapMemory(vkDevice, memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+                if (result != vk::Result::eSuccess) {
+                    device.getDispatcher()->vkFreeMemory(vkDevice, memory, nullptr);
+                    throw std::runtime_error("Failed to map device memory: " + vk::to_string(result));
+                }
+            }
+
+            return memory;
+        }
+
+        // Freeing unmaps as well
+        void freeDeviceMemory(void* context, vk::DeviceMemory memory) {
+            const auto& device = *static_cast<const vk::raii::Device*>(context);
+            device.getDispatcher()->vkFreeMemory(static_cast<VkDevice>(*device), static_cast<VkDeviceMemory>(memory), nullptr);
+        }
+
+    }
+
+    uint32_t MemoryTypeTable::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) const {
+        auto find = [&](vk::MemoryPropertyFlags props) {
+            for (uint32_t i = 0; i < this->properties.memoryTypeCount; i++) {
+                if ((typeFilter & (1u << i)) && ((this->properties.memoryTypes[i].propertyFlags & props) == props)) return i;
+            }
+            return UINT32_MAX;
+        };
+
+        uint32_t type = preferred ? find(required | preferred) : UINT32_MAX;
+        if (type == UINT32_MAX) type = find(required);
+        if (type == UINT32_MAX) throw std::runtime_error("Failed to find suitable memory type");
+
+        return type;
+    }
+
+    DeviceMemoryAllocator::DeviceMemoryAllocator(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice,
+                                                 vk::DeviceSize blockSize) :
+            DeviceMemoryAllocator(physicalDevice.getMemoryProperties(),
+                                  {const_cast<vk::raii::Device*>(&device), allocateDeviceMemory, freeDeviceMemory}, blockSize) {}
+
+    DeviceMemoryAllocator::DeviceMemoryAllocator(const vk::PhysicalDeviceMemoryProperties &properties, MemoryBlockSource source,
+                                                 vk::DeviceSize blockSize) :
+            memoryTypes(properties), source(source), blockSize(blockSize) {
+
+        this->pools.resize(this->memoryTypes.getTypeCount() * 2);
+        for (uint32_t i = 0; i < this->pools.size(); i++) {
+            this->pools[i].memoryType = i / 2;
+        }
+    }
+
+    DeviceMemoryAllocator::~DeviceMemoryAllocator() {
+        release();
+    }
+
+    DeviceMemoryAllocator::DeviceMemoryAllocator(DeviceMemoryAllocator &&other) noexcept :
+            memoryTypes(other.memoryTypes), source(other.source), blockSize(other.blockSize),
+            pools(std::exchange(other.pools, {})) {}
+
+    DeviceMemoryAllocator &DeviceMemoryAllocator::operator=(DeviceMemoryAllocator &&other) noexcept {
+        if (this == &other) return *this;
+
+        release();
+        this->memoryTypes = other.memoryTypes;
+        this->source = other.source;
+        this->blockSize = other.blockSize;
+        this->pools = std::exchange(other.pools, {});
+
+        return *this;
+    }
+
+    void DeviceMemoryAllocator::release() {
+        for (auto& pool : this->pools) {
+            for (auto& block : pool.blocks) {
+                if (block.memory) this->source.free(this->source.context, block.memory);
+            }
+        }
+        this->pools.clear();
+    }
+
+    DeviceMemoryAllocator::Block DeviceMemoryAllocator::createBlock(uint32_t memoryType, vk::DeviceSize size) {
+        Block block;
+
+        vk::MemoryAllocateInfo allocInfo {
+                size,
+                memoryType
+        };
+
+        bool hostVisible = static_cast<bool>(this->memoryTypes.getTypeFlags(memoryType) & vk::MemoryPropertyFlagBits::eHostVisible);
+        block.memory = this->source.allocate(this->source.context, allocInfo, hostVisible, block.mapped);
+        block.allocator = TlsfAllocator(size);
+
+        return block;
+    }
+
+    MemoryAllocation DeviceMemoryAllocator::allocate(const vk::MemoryRequirements &requirements, vk::MemoryPropertyFlags props, ResourceKind kind,
+                                                     vk::MemoryPropertyFlags preferred) {
+        uint32_t memoryType = this->memoryTypes.findMemoryType(requirements.memoryTypeBits, props, preferred);
+        auto poolIndex = static_cast<uint32_t>(memoryType * 2 + static_cast<uint32_t>(kind));
+        Pool& pool = this->pools[poolIndex];
+
+        auto fill = [&](uint32_t blockIndex, const OffsetAllocation& range) {
+            Block& block = pool.blocks[blockIndex];
+
+            MemoryAllocation allocation;
+            allocation.memory = block.memory;
+            allocation.offset = range.offset;
+            allocation.size = range.size;
+            allocation.mapped = block.mapped ? static_cast<std::byte*>(block.mapped) + range.offset : nullptr;
+            allocation.pool = poolIndex;
+            allocation.block = blockIndex;
+            allocation.range = range;
+
+            return allocation;
+        };
+
+        uint32_t emptySlot = UINT32_MAX;
+        for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+            if (!pool.blocks[i].memory) {
+                if (emptySlot == UINT32_MAX) emptySlot = i;
+                continue;
+            }
+
+            if (auto range = pool.blocks[i].allocator.allocate(requirements.size, requirements.alignment)) {
+                return fill(i, *range);
+            }
+        }
+
+        // Out of space, this is the only path that reaches the driver
+        Block block = createBlock(memoryType, std::max(this->blockSize, requirements.size));
+
+        uint32_t blockIndex = emptySlot;
+        if (blockIndex == UINT32_MAX) {
+            blockIndex = static_cast<uint32_t>(pool.blocks.size());
+            pool.blocks.push_back(std::move(block));
+        } else {
+            pool.blocks[blockIndex] = std::move(block);
+        }
+
+        auto range = pool.blocks[blockIndex].allocator.allocate(requirements.size, requirements.alignment);
+        if (!range) throw std::runtime_error("Failed to sub-allocate from a fresh memory block");
+
+        return fill(blockIndex, *range);
+    }
+
+    void DeviceMemoryAllocator::free(MemoryAllocation &allocation) {
+        if (!allocation) return;
+
+        this->pools[allocation.pool].blocks[allocation.block].allocator.free(allocation.range);
+        allocation = {};
+    }
+
+    MemoryAllocation DeviceMemoryAllocator::bind(vk::raii::Buffer &buffer, vk::MemoryPropertyFlags props, vk::MemoryPropertyFlags preferred) {
+        MemoryAllocation allocation = allocate(buffer.getMemoryRequirements(), props, ResourceKind::eBuffer, preferred);
+        buffer.bindMemory(allocation.memory, allocation.offset);
+
+        return allocation;
+    }
+
+    MemoryAllocation DeviceMemoryAllocator::bind(vk::raii::Image &image, vk::MemoryPropertyFlags props, vk::MemoryPropertyFlags preferred) {
+        MemoryAllocation allocation = allocate(image.getMemoryRequirements(), props, ResourceKind::eImage, preferred);
+        image.bindMemory(allocation.memory, allocation.offset);
+
+        return allocation;
+    }
+
+    void DeviceMemoryAllocator::trim() {
+        for (auto& pool : this->pools) {
+            bool keptOne = false;
+
+            // Emptied blocks leave a hole so the block indices of live allocations stay valid
+            for (auto& block : pool.blocks) {
+                if (!block.memory || !block.allocator.empty()) continue;
+
+                if (!keptOne) {
+                    keptOne = true;
+                    continue;
+                }
+
+                this->source.free(this->source.context, block.memory);
+                block = Block{};
+            }
+        }
+    }
+
+    MemoryStats DeviceMemoryAllocator::getStats() const {
+        MemoryStats stats;
+        vk::DeviceSize freeBytes = 0, largestFree = 0;
+
+        for (const auto& pool : this->pools) {
+            for (const auto& block : pool.blocks) {
+                if (!block.memory) continue;
+
+                auto blockStats = block.allocator.getStats();
+
+                stats.blockCount++;
+                stats.allocationCount += blockStats.allocationCount;
+                stats.reservedBytes += blockStats.capacity;
+                stats.usedBytes += blockStats.used;
+
+                freeBytes += blockStats.capacity - blockStats.used;
+                largestFree = std::max(largestFree, blockStats.largestFreeBlock);
+            }
+        }
+
+        stats.fragmentation = freeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(largestFree) / static_cast<double>(freeBytes);
+
+        return stats;
+    }
+
+} // imr
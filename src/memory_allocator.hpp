@@ -0,0 +1,123 @@
+#ifndef VK_IMM_RENDERER_MEMORY_ALLOCATOR_HPP
+#define VK_IMM_RENDERER_MEMORY_ALLOCATOR_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "offset_allocator.hpp"
+
+namespace imr {
+
+    // Memory properties queried once per physical device
+    class MemoryTypeTable {
+    public:
+        MemoryTypeTable() = default;
+        explicit MemoryTypeTable(const vk::PhysicalDeviceMemoryProperties& properties) : properties(properties) {}
+
+        // Lowest type in the filter with all of the required flags, one that also has the preferred ones wins.
+        // Throws if no type has the required flags.
+        [[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags required,
+                                              vk::MemoryPropertyFlags preferred = {}) const;
+        [[nodiscard]] uint32_t getTypeCount() const { return this->properties.memoryTypeCount; }
+        [[nodiscard]] vk::MemoryPropertyFlags getTypeFlags(uint32_t typeIndex) const { return this->properties.memoryTypes[typeIndex].propertyFlags; }
+        [[nodiscard]] const vk::PhysicalDeviceMemoryProperties& getProperties() const { return this->properties; }
+
+    private:
+        vk::PhysicalDeviceMemoryProperties properties;
+    };
+
+    enum class ResourceKind : uint8_t {
+        eBuffer,
+        eImage
+    };
+
+    struct MemoryAllocation {
+        vk::DeviceMemory memory;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        // Host visible blocks stay mapped, this points at offset inside the mapping
+        void* mapped = nullptr;
+
+        uint32_t pool = UINT32_MAX;
+        uint32_t block = UINT32_MAX;
+        OffsetAllocation range;
+
+        explicit operator bool() const { return this->memory; }
+    };
+
+    struct MemoryStats {
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+        vk::DeviceSize reservedBytes = 0;
+        vk::DeviceSize usedBytes = 0;
+        double fragmentation = 0.0;
+    };
+
+    // Where the allocator's blocks come from, the device outside of tests. Blocks are mapped as a whole if asked to.
+    struct MemoryBlockSource {
+        void* context = nullptr;
+        vk::DeviceMemory (*allocate)(void* context, const vk::MemoryAllocateInfo& info, bool map, void*& mapped) = nullptr;
+        void (*free)(void* context, vk::DeviceMemory memory) = nullptr;
+    };
+
+    // Hands out ranges of large vk::DeviceMemory blocks. Blocks are pooled per memory type, buffers and images
+    // get separate pools so bufferImageGranularity never matters. The driver is only called when a pool runs
+    // out of space or for requests larger than a block.
+    class DeviceMemoryAllocator {
+    public:
+        static constexpr vk::DeviceSize DefaultBlockSize = 64ull << 20;
+
+        DeviceMemoryAllocator() = default;
+        DeviceMemoryAllocator(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice,
+                              vk::DeviceSize blockSize = DefaultBlockSize);
+        DeviceMemoryAllocator(const vk::PhysicalDeviceMemoryProperties& properties, MemoryBlockSource source,
+                              vk::DeviceSize blockSize = DefaultBlockSize);
+        ~DeviceMemoryAllocator();
+
+        DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+        DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+        DeviceMemoryAllocator(DeviceMemoryAllocator&& other) noexcept;
+        DeviceMemoryAllocator& operator=(DeviceMemoryAllocator&& other) noexcept;
+
+        // Preferred flags pick between the types that have the required ones, see MemoryTypeTable::findMemoryType
+        MemoryAllocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags props, ResourceKind kind,
+                                  vk::MemoryPropertyFlags preferred = {});
+        void free(MemoryAllocation& allocation);
+
+        MemoryAllocation bind(vk::raii::Buffer& buffer, vk::MemoryPropertyFlags props, vk::MemoryPropertyFlags preferred = {});
+        MemoryAllocation bind(vk::raii::Image& image, vk::MemoryPropertyFlags props, vk::MemoryPropertyFlags preferred = {});
+
+        // Releases blocks without live allocations, keeping one per pool around for reuse
+        void trim();
+
+        [[nodiscard]] MemoryStats getStats() const;
+        [[nodiscard]] const MemoryTypeTable& getMemoryTypes() const { return this->memoryTypes; }
+
+    private:
+        struct Block {
+            vk::DeviceMemory memory;
+            TlsfAllocator allocator;
+            void* mapped = nullptr;
+        };
+
+        struct Pool {
+            uint32_t memoryType = 0;
+            std::vector<Block> blocks;
+        };
+
+        MemoryTypeTable memoryTypes;
+        MemoryBlockSource source;
+        vk::DeviceSize blockSize = DefaultBlockSize;
+
+        // Indexed by memoryType * 2 + ResourceKind
+        std::vector<Pool> pools;
+
+        Block createBlock(uint32_t memoryType, vk::DeviceSize size);
+        void release();
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_MEMORY_ALLOCATOR_HPP
@@ -0,0 +1,74 @@
+#include "offscreen_target.hpp"
+
+#include <cstring>
+
+namespace imr {
+
+    OffscreenTarget::OffscreenTarget(const vk::raii::Device &device, DeviceMemoryAllocator &allocator, vk::Extent2D extent) : extent(extent) {
+        vk::ImageCreateInfo imageInfo {
+                {},
+                vk::ImageType::e2D,
+                ColorFormat,
+                vk::Extent3D(extent.width, extent.height, 1),
+                1, 1,
+                vk::SampleCountFlagBits::e1,
+                vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+                vk::SharingMode::eExclusive, 0, nullptr,
+                vk::ImageLayout::eUndefined
+        };
+
+        this->image = device.createImage(imageInfo);
+        this->imageMemory = allocator.bind(this->image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::BufferCreateInfo bufferInfo {
+                {},
+                static_cast<vk::DeviceSize>(extent.width) * extent.height * 4,
+                vk::BufferUsageFlagBits::eTransferDst,
+                vk::SharingMode::eExclusive
+        };
+
+        this->readbackBuffer = device.createBuffer(bufferInfo);
+
+        // Reading uncached memory back is several times slower, batch output copies every frame out of here
+        this->readbackMemory = allocator.bind(this->readbackBuffer,
+                                              vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                              vk::MemoryPropertyFlagBits::eHostCached);
+    }
+
+    void OffscreenTarget::recordReadback(const vk::raii::CommandBuffer &cmd) const {
+        vk::BufferImageCopy region {
+                0, 0, 0,
+                {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                {0, 0, 0},
+                {this->extent.width, this->extent.height, 1}
+        };
+
+        cmd.copyImageToBuffer(*this->image, vk::ImageLayout::eTransferSrcOptimal, *this->readbackBuffer, region);
+
+        vk::BufferMemoryBarrier hostBarrier {
+                vk::AccessFlagBits::eTransferWrite,
+                vk::AccessFlagBits::eHostRead,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                *this->readbackBuffer,
+                0, VK_WHOLE_SIZE
+        };
+
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, nullptr, hostBarrier, nullptr);
+    }
+
+    FrameCapture OffscreenTarget::read() const {
+        FrameCapture capture;
+        capture.width = this->extent.width;
+        capture.height = this->extent.height;
+        read(capture.pixels);
+
+        return capture;
+    }
+
+    void OffscreenTarget::read(std::vector<uint8_t> &pixels) const {
+        pixels.resize(static_cast<size_t>(this->extent.width) * this->extent.height * 4);
+        std::memcpy(pixels.data(), this->readbackMemory.mapped, pixels.size());
+    }
+
+} // imr
@@ -0,0 +1,50 @@
+#ifndef VK_IMM_RENDERER_OFFSCREEN_TARGET_HPP
+#define VK_IMM_RENDERER_OFFSCREEN_TARGET_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "memory_allocator.hpp"
+
+namespace imr {
+
+    struct FrameCapture {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Tightly packed RGBA8 rows
+        std::vector<uint8_t> pixels;
+    };
+
+    // Color image that stands in for a swapchain image when running headless,
+    // together with a host visible buffer the rendered frame is copied into
+    class OffscreenTarget {
+    public:
+        static constexpr vk::Format ColorFormat = vk::Format::eR8G8B8A8Unorm;
+
+        OffscreenTarget(const vk::raii::Device& device, DeviceMemoryAllocator& allocator, vk::Extent2D extent);
+
+        // Expects the image in eTransferSrcOptimal, as left behind by the frame graph
+        void recordReadback(const vk::raii::CommandBuffer& cmd) const;
+        // Only valid once the frame that recorded the readback has finished
+        [[nodiscard]] FrameCapture read() const;
+        // Same, into a buffer whose capacity is reused, e.g. one recycled by an ImageWriter
+        void read(std::vector<uint8_t>& pixels) const;
+
+        [[nodiscard]] vk::Image getImage() const { return *this->image; }
+        [[nodiscard]] vk::Extent2D getExtent() const { return this->extent; }
+
+    private:
+        vk::Extent2D extent;
+
+        vk::raii::Image image{VK_NULL_HANDLE};
+        MemoryAllocation imageMemory;
+
+        vk::raii::Buffer readbackBuffer{VK_NULL_HANDLE};
+        MemoryAllocation readbackMemory;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_OFFSCREEN_TARGET_HPP
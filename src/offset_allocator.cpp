@@ -0,0 +1,235 @@
+#include "offset_allocator.hpp"
+
+#include <bit>
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    TlsfAllocator::TlsfAllocator(uint64_t capacity) : capacity(capacity) {
+        this->freeHeads.fill(NullNode);
+        this->nodes.reserve(64);
+
+        uint32_t root = createNode();
+        this->nodes[root].offset = 0;
+        this->nodes[root].size = capacity;
+        this->nodes[root].free = true;
+        insertFree(root);
+    }
+
+    void TlsfAllocator::mapping(uint64_t size, uint32_t &firstLevel, uint32_t &secondLevel) {
+        if (size < SecondLevelCount) {
+            // Small sizes get one exact class each
+            firstLevel = 0;
+            secondLevel = static_cast<uint32_t>(size);
+            return;
+        }
+
+        auto msb = static_cast<uint32_t>(std::bit_width(size) - 1);
+        firstLevel = msb - SecondLevelLog2 + 1;
+        secondLevel = static_cast<uint32_t>(size >> (msb - SecondLevelLog2)) - SecondLevelCount;
+    }
+
+    uint32_t TlsfAllocator::createNode() {
+        if (!this->unusedNodes.empty()) {
+            uint32_t node = this->unusedNodes.back();
+            this->unusedNodes.pop_back();
+            this->nodes[node] = {};
+            return node;
+        }
+
+        this->nodes.emplace_back();
+        return static_cast<uint32_t>(this->nodes.size() - 1);
+    }
+
+    void TlsfAllocator::releaseNode(uint32_t node) {
+        // Marked free so freeing a stale allocation of it throws until the node is handed out again
+        this->nodes[node].free = true;
+        this->unusedNodes.push_back(node);
+    }
+
+    void TlsfAllocator::insertFree(uint32_t node) {
+        uint32_t fl, sl;
+        mapping(this->nodes[node].size, fl, sl);
+
+        uint32_t& head = this->freeHeads[fl * SecondLevelCount + sl];
+        this->nodes[node].prevFree = NullNode;
+        this->nodes[node].nextFree = head;
+        if (head != NullNode) this->nodes[head].prevFree = node;
+        head = node;
+
+        this->firstLevelMap |= 1ull << fl;
+        this->secondLevelMaps[fl] |= 1u << sl;
+        this->freeBlockCount++;
+    }
+
+    void TlsfAllocator::removeFree(uint32_t node) {
+        Node& n = this->nodes[node];
+
+        if (n.prevFree != NullNode) {
+            this->nodes[n.prevFree].nextFree = n.nextFree;
+        } else {
+            uint32_t fl, sl;
+            mapping(n.size, fl, sl);
+
+            this->freeHeads[fl * SecondLevelCount + sl] = n.nextFree;
+            if (n.nextFree == NullNode) {
+                this->secondLevelMaps[fl] &= ~(1u << sl);
+                if (this->secondLevelMaps[fl] == 0) this->firstLevelMap &= ~(1ull << fl);
+            }
+        }
+
+        if (n.nextFree != NullNode) this->nodes[n.nextFree].prevFree = n.prevFree;
+
+        n.prevFree = NullNode;
+        n.nextFree = NullNode;
+        this->freeBlockCount--;
+    }
+
+    uint32_t TlsfAllocator::findFree(uint64_t size) {
+        // Round up to the next class boundary so that any block in the found class is large enough
+        if (size >= SecondLevelCount) {
+            auto msb = static_cast<uint32_t>(std::bit_width(size) - 1);
+            size += (1ull << (msb - SecondLevelLog2)) - 1;
+        }
+
+        uint32_t fl, sl;
+        mapping(size, fl, sl);
+        if (fl >= FirstLevelCount) return NullNode;
+
+        uint32_t secondLevelMap = this->secondLevelMaps[fl] & (~0u << sl);
+        if (secondLevelMap == 0) {
+            uint64_t firstLevelMap = (fl + 1 < FirstLevelCount) ? this->firstLevelMap & (~0ull << (fl + 1)) : 0;
+            if (firstLevelMap == 0) return NullNode;
+
+            fl = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+            secondLevelMap = this->secondLevelMaps[fl];
+        }
+
+        sl = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+        return this->freeHeads[fl * SecondLevelCount + sl];
+    }
+
+    uint32_t TlsfAllocator::findFitting(uint64_t size, uint64_t alignment) const {
+        uint32_t fl, sl;
+        mapping(size, fl, sl);
+        if (fl >= FirstLevelCount) return NullNode;
+
+        // Only the head of the class, so this stays O(1)
+        uint32_t node = this->freeHeads[fl * SecondLevelCount + sl];
+        if (node == NullNode) return NullNode;
+
+        const Node& n = this->nodes[node];
+        uint64_t padding = ((n.offset + alignment - 1) & ~(alignment - 1)) - n.offset;
+        return n.size >= padding + size ? node : NullNode;
+    }
+
+    uint32_t TlsfAllocator::splitFront(uint32_t node, uint64_t size) {
+        uint32_t rest = createNode();
+
+        Node& front = this->nodes[node];
+        Node& back = this->nodes[rest];
+
+        back.offset = front.offset + size;
+        back.size = front.size - size;
+        back.prevPhysical = node;
+        back.nextPhysical = front.nextPhysical;
+        if (back.nextPhysical != NullNode) this->nodes[back.nextPhysical].prevPhysical = rest;
+
+        front.size = size;
+        front.nextPhysical = rest;
+
+        return rest;
+    }
+
+    std::optional<OffsetAllocation> TlsfAllocator::allocate(uint64_t size, uint64_t alignment) {
+        if (alignment == 0 || !std::has_single_bit(alignment)) throw std::runtime_error("Alignment has to be a power of two");
+        size = std::max<uint64_t>(size, 1);
+
+        // Searching for the worst case padding keeps the lookup O(1), the padding itself is given back below
+        uint32_t node = findFree(size + alignment - 1);
+        // The rounding skips the class of blocks that fit exactly, e.g. a fresh memory block of the requested size
+        if (node == NullNode) node = findFitting(size, alignment);
+        if (node == NullNode) return std::nullopt;
+
+        removeFree(node);
+
+        uint64_t offset = this->nodes[node].offset;
+        uint64_t padding = ((offset + alignment - 1) & ~(alignment - 1)) - offset;
+
+        // Neighbours of a free block are never free, so the split off pieces don't need merging
+        if (padding > 0) {
+            uint32_t rest = splitFront(node, padding);
+            this->nodes[node].free = true;
+            insertFree(node);
+            node = rest;
+        }
+
+        if (this->nodes[node].size > size) {
+            uint32_t tail = splitFront(node, size);
+            this->nodes[tail].free = true;
+            insertFree(tail);
+        }
+
+        this->nodes[node].free = false;
+        this->used += this->nodes[node].size;
+        this->allocationCount++;
+
+        return OffsetAllocation{this->nodes[node].offset, this->nodes[node].size, node};
+    }
+
+    void TlsfAllocator::free(const OffsetAllocation &allocation) {
+        uint32_t node = allocation.node;
+        if (node >= this->nodes.size() || this->nodes[node].free) throw std::runtime_error("Invalid or double free");
+
+        this->used -= this->nodes[node].size;
+        this->allocationCount--;
+
+        uint32_t prev = this->nodes[node].prevPhysical;
+        if (prev != NullNode && this->nodes[prev].free) {
+            removeFree(prev);
+
+            this->nodes[prev].size += this->nodes[node].size;
+            this->nodes[prev].nextPhysical = this->nodes[node].nextPhysical;
+            if (this->nodes[prev].nextPhysical != NullNode) this->nodes[this->nodes[prev].nextPhysical].prevPhysical = prev;
+
+            releaseNode(node);
+            node = prev;
+        }
+
+        uint32_t next = this->nodes[node].nextPhysical;
+        if (next != NullNode && this->nodes[next].free) {
+            removeFree(next);
+
+            this->nodes[node].size += this->nodes[next].size;
+            this->nodes[node].nextPhysical = this->nodes[next].nextPhysical;
+            if (this->nodes[node].nextPhysical != NullNode) this->nodes[this->nodes[node].nextPhysical].prevPhysical = node;
+
+            releaseNode(next);
+        }
+
+        this->nodes[node].free = true;
+        insertFree(node);
+    }
+
+    OffsetAllocatorStats TlsfAllocator::getStats() const {
+        OffsetAllocatorStats stats;
+        stats.capacity = this->capacity;
+        stats.used = this->used;
+        stats.freeBlockCount = this->freeBlockCount;
+        stats.allocationCount = this->allocationCount;
+
+        // The largest block sits in the highest non-empty class, only that list has to be walked
+        if (this->firstLevelMap != 0) {
+            auto fl = static_cast<uint32_t>(63 - std::countl_zero(this->firstLevelMap));
+            auto sl = static_cast<uint32_t>(31 - std::countl_zero(this->secondLevelMaps[fl]));
+
+            for (uint32_t n = this->freeHeads[fl * SecondLevelCount + sl]; n != NullNode; n = this->nodes[n].nextFree) {
+                stats.largestFreeBlock = std::max(stats.largestFreeBlock, this->nodes[n].size);
+            }
+        }
+
+        return stats;
+    }
+
+} // imr
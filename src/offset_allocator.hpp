@@ -0,0 +1,112 @@
+#ifndef VK_IMM_RENDERER_OFFSET_ALLOCATOR_HPP
+#define VK_IMM_RENDERER_OFFSET_ALLOCATOR_HPP
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace imr {
+
+    struct OffsetAllocation {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t node = UINT32_MAX;
+    };
+
+    struct OffsetAllocatorStats {
+        uint64_t capacity = 0;
+        uint64_t used = 0;
+        uint64_t largestFreeBlock = 0;
+        uint32_t freeBlockCount = 0;
+        uint32_t allocationCount = 0;
+
+        // 0 when all free space is one contiguous block, approaching 1 as it gets split up
+        [[nodiscard]] double fragmentation() const {
+            uint64_t free = capacity - used;
+            return free == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeBlock) / static_cast<double>(free);
+        }
+    };
+
+    // Two-level segregated fit allocator over an abstract [0, capacity) range. Only bookkeeping lives here,
+    // the range itself is usually a vk::DeviceMemory block. Allocation and free are O(1): free blocks are kept
+    // in size class lists found via two bitmaps, and neighbours are merged through an offset ordered list.
+    class TlsfAllocator {
+    public:
+        TlsfAllocator() = default;
+        explicit TlsfAllocator(uint64_t capacity);
+
+        std::optional<OffsetAllocation> allocate(uint64_t size, uint64_t alignment = 1);
+        void free(const OffsetAllocation& allocation);
+
+        [[nodiscard]] OffsetAllocatorStats getStats() const;
+        [[nodiscard]] uint64_t getCapacity() const { return this->capacity; }
+        [[nodiscard]] bool empty() const { return this->allocationCount == 0; }
+
+    private:
+        static constexpr uint32_t SecondLevelLog2 = 5;
+        static constexpr uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+        static constexpr uint32_t FirstLevelCount = 64;
+        static constexpr uint32_t NullNode = UINT32_MAX;
+
+        struct Node {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint32_t prevPhysical = NullNode;
+            uint32_t nextPhysical = NullNode;
+            uint32_t prevFree = NullNode;
+            uint32_t nextFree = NullNode;
+            bool free = false;
+        };
+
+        uint64_t capacity = 0;
+        uint64_t used = 0;
+        uint32_t allocationCount = 0;
+        uint32_t freeBlockCount = 0;
+
+        uint64_t firstLevelMap = 0;
+        std::array<uint32_t, FirstLevelCount> secondLevelMaps{};
+        std::array<uint32_t, FirstLevelCount * SecondLevelCount> freeHeads{};
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> unusedNodes;
+
+        static void mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+        uint32_t createNode();
+        void releaseNode(uint32_t node);
+        void insertFree(uint32_t node);
+        void removeFree(uint32_t node);
+        uint32_t findFree(uint64_t size);
+        [[nodiscard]] uint32_t findFitting(uint64_t size, uint64_t alignment) const;
+        // Shrinks node to its first `size` bytes and returns a new node for the remainder
+        uint32_t splitFront(uint32_t node, uint64_t size);
+    };
+
+    // Bump allocator for transient per-frame data, everything is released at once with reset()
+    class LinearAllocator {
+    public:
+        LinearAllocator() = default;
+        explicit LinearAllocator(uint64_t capacity) : capacity(capacity) {}
+
+        std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment = 1) {
+            uint64_t offset = (this->head + alignment - 1) & ~(alignment - 1);
+            if (offset + size > this->capacity) return std::nullopt;
+
+            this->head = offset + size;
+            return offset;
+        }
+
+        void reset() { this->head = 0; }
+
+        [[nodiscard]] uint64_t getUsed() const { return this->head; }
+        [[nodiscard]] uint64_t getCapacity() const { return this->capacity; }
+
+    private:
+        uint64_t capacity = 0;
+        uint64_t head = 0;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_OFFSET_ALLOCATOR_HPP
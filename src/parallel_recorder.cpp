@@ -0,0 +1,131 @@
+#include "parallel_recorder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    ParallelRecorder::ParallelRecorder(const vk::raii::Device &device, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t threadCount) :
+            device(device), threadCount(std::max(threadCount, 1u)), framesInFlight(framesInFlight) {
+
+        // eTransient without eResetCommandBuffer, buffers only ever go back to the pool together
+        vk::CommandPoolCreateInfo poolInfo {
+                vk::CommandPoolCreateFlagBits::eTransient,
+                queueFamilyIndex
+        };
+
+        this->threadFrames.resize(this->threadCount * framesInFlight);
+        for (auto& threadFrame : this->threadFrames) {
+            threadFrame.pool = device.createCommandPool(poolInfo);
+        }
+
+        this->recorded.resize(this->threadCount);
+        this->errors.resize(this->threadCount);
+
+        for (uint32_t worker = 1; worker < this->threadCount; worker++) {
+            this->workers.emplace_back([this, worker] { workerLoop(worker); });
+        }
+    }
+
+    ParallelRecorder::~ParallelRecorder() {
+        {
+            std::scoped_lock lock(this->mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+
+        for (auto& worker : this->workers) worker.join();
+    }
+
+    void ParallelRecorder::beginFrame(uint32_t frameSlot) {
+        this->currentSlot = frameSlot;
+
+        for (uint32_t thread = 0; thread < this->threadCount; thread++) {
+            ThreadFrame& threadFrame = this->threadFrames[thread * this->framesInFlight + frameSlot];
+
+            threadFrame.pool.reset();
+            threadFrame.used = 0;
+        }
+    }
+
+    void ParallelRecorder::recordChunk(uint32_t chunk) {
+        try {
+            ThreadFrame& threadFrame = this->threadFrames[chunk * this->framesInFlight + this->currentSlot];
+
+            if (threadFrame.used == threadFrame.buffers.size()) {
+                vk::CommandBufferAllocateInfo allocInfo {
+                        *threadFrame.pool,
+                        vk::CommandBufferLevel::eSecondary,
+                        1
+                };
+
+                auto allocated = this->device.allocateCommandBuffers(allocInfo);
+                threadFrame.buffers.push_back(std::move(allocated.front()));
+            }
+
+            auto& cmd = threadFrame.buffers[threadFrame.used++];
+
+            cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, this->inheritance});
+            this->callback.invoke(this->callback.context, cmd, chunk);
+            cmd.end();
+
+            this->recorded[chunk] = *cmd;
+        } catch (...) {
+            this->errors[chunk] = std::current_exception();
+        }
+    }
+
+    void ParallelRecorder::dispatch(uint32_t chunkCount, const vk::CommandBufferInheritanceInfo &inheritanceInfo, ChunkCallback chunkCallback) {
+        chunkCount = std::clamp(chunkCount, 1u, this->threadCount);
+
+        {
+            std::scoped_lock lock(this->mutex);
+
+            this->recorded.resize(this->threadCount);
+            this->inheritance = &inheritanceInfo;
+            this->callback = chunkCallback;
+            this->activeChunks = chunkCount;
+            this->pending = chunkCount - 1;
+            this->generation++;
+        }
+        if (chunkCount > 1) this->wake.notify_all();
+
+        recordChunk(0);
+
+        {
+            std::unique_lock lock(this->mutex);
+            this->done.wait(lock, [this] { return this->pending == 0; });
+        }
+
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            if (this->errors[chunk]) {
+                std::exception_ptr error = this->errors[chunk];
+                std::fill(this->errors.begin(), this->errors.end(), nullptr);
+                std::rethrow_exception(error);
+            }
+        }
+
+        this->recorded.resize(chunkCount);
+    }
+
+    void ParallelRecorder::workerLoop(uint32_t worker) {
+        uint64_t seenGeneration = 0;
+
+        while (true) {
+            std::unique_lock lock(this->mutex);
+            this->wake.wait(lock, [&] { return this->stopping || this->generation != seenGeneration; });
+
+            if (this->stopping) return;
+
+            seenGeneration = this->generation;
+            if (worker >= this->activeChunks) continue;
+
+            lock.unlock();
+            recordChunk(worker);
+            lock.lock();
+
+            if (--this->pending == 0) this->done.notify_one();
+        }
+    }
+
+} // imr
@@ -0,0 +1,89 @@
+#ifndef VK_IMM_RENDERER_PARALLEL_RECORDER_HPP
+#define VK_IMM_RENDERER_PARALLEL_RECORDER_HPP
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <exception>
+#include <condition_variable>
+
+#include "vulkan/vulkan_raii.hpp"
+
+namespace imr {
+
+    // Records secondary command buffers for disjoint chunks of a frame on several threads. Every thread owns
+    // one command pool per frame slot, so no pool is ever shared and a whole slot is recycled with one pool reset.
+    // Chunk 0 is recorded on the calling thread, chunk i on worker i.
+    class ParallelRecorder {
+    public:
+        ParallelRecorder(const vk::raii::Device& device, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t threadCount);
+        ~ParallelRecorder();
+
+        ParallelRecorder(const ParallelRecorder&) = delete;
+        ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+        // Resets every thread's pool for the slot, only valid once the slot's fence has signalled
+        void beginFrame(uint32_t frameSlot);
+
+        // Calls recordChunk(cmd, chunk) for chunk in [0, chunkCount) in parallel and returns the recorded
+        // secondary buffers in chunk order. chunkCount is clamped to the thread count.
+        template<typename F>
+        const std::vector<vk::CommandBuffer>& record(uint32_t chunkCount, const vk::CommandBufferInheritanceInfo& inheritance, F&& recordChunk) {
+            ChunkCallback callback {
+                    &recordChunk,
+                    [](void* context, const vk::raii::CommandBuffer& cmd, uint32_t chunk) {
+                        (*static_cast<std::remove_reference_t<F>*>(context))(cmd, chunk);
+                    }
+            };
+
+            dispatch(chunkCount, inheritance, callback);
+            return this->recorded;
+        }
+
+        [[nodiscard]] uint32_t getThreadCount() const { return this->threadCount; }
+
+    private:
+        struct ChunkCallback {
+            void* context;
+            void (*invoke)(void* context, const vk::raii::CommandBuffer& cmd, uint32_t chunk);
+        };
+
+        struct ThreadFrame {
+            vk::raii::CommandPool pool{VK_NULL_HANDLE};
+            std::vector<vk::raii::CommandBuffer> buffers;
+            uint32_t used = 0;
+        };
+
+        const vk::raii::Device& device;
+        uint32_t threadCount;
+        uint32_t currentSlot = 0;
+
+        // Indexed by thread * framesInFlight + frameSlot
+        std::vector<ThreadFrame> threadFrames;
+        uint32_t framesInFlight;
+
+        std::vector<vk::CommandBuffer> recorded;
+        std::vector<std::exception_ptr> errors;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        uint64_t generation = 0;
+        uint32_t activeChunks = 0;
+        uint32_t pending = 0;
+        bool stopping = false;
+
+        const vk::CommandBufferInheritanceInfo* inheritance = nullptr;
+        ChunkCallback callback{};
+
+        std::vector<std::thread> workers;
+
+        void dispatch(uint32_t chunkCount, const vk::CommandBufferInheritanceInfo& inheritanceInfo, ChunkCallback chunkCallback);
+        void recordChunk(uint32_t chunk);
+        void workerLoop(uint32_t worker);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_PARALLEL_RECORDER_HPP
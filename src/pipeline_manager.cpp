@@ -0,0 +1,338 @@
+#include "pipeline_manager.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <array>
+#include <cstring>
+
+namespace imr {
+
+    size_t PipelineKeyHash::operator()(const PipelineKey &key) const {
+        // FNV-1a over the fields, the key is small enough that this is cheaper than std::hash combining
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](uint64_t value) {
+            for (int i = 0; i < 8; i++) {
+                hash ^= (value >> (i * 8)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+        };
+
+        mix(key.program);
+        mix(static_cast<uint64_t>(key.blend));
+        mix(static_cast<uint64_t>(key.topology));
+        mix(key.depthTest);
+        mix(reinterpret_cast<uint64_t>(static_cast<VkRenderPass>(key.renderPass)));
+        mix(key.subpass);
+
+        return static_cast<size_t>(hash);
+    }
+
+    PipelineManager::PipelineManager(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice,
+                                     std::filesystem::path cachePath) :
+            device(&device), deviceProperties(physicalDevice.getProperties()),
+            cachePath(std::move(cachePath)) {
+
+        std::vector<uint8_t> initialData = loadCacheData();
+
+        vk::PipelineCacheCreateInfo cacheInfo {
+                {},
+                initialData.size(),
+                initialData.data()
+        };
+
+        this->pipelineCache = device.createPipelineCache(cacheInfo);
+    }
+
+    PipelineManager::PipelineManager(PipelineManager &&other) noexcept {
+        *this = std::move(other);
+    }
+
+    PipelineManager &PipelineManager::operator=(PipelineManager &&other) noexcept {
+        if (this == &other) return *this;
+
+        // Both sides must be quiet before their state is swapped out
+        if (this->prewarmThread.joinable()) this->prewarmThread.join();
+        if (other.prewarmThread.joinable()) other.prewarmThread.join();
+
+        std::scoped_lock lock(this->mutex, other.mutex);
+
+        this->device = other.device;
+        this->deviceProperties = other.deviceProperties;
+        this->cachePath = std::move(other.cachePath);
+        this->pipelineCache = std::move(other.pipelineCache);
+        this->programs = std::move(other.programs);
+        this->pipelines = std::move(other.pipelines);
+
+        other.device = nullptr;
+
+        return *this;
+    }
+
+    PipelineManager::~PipelineManager() {
+        if (this->prewarmThread.joinable()) this->prewarmThread.join();
+
+        if (this->device && *this->pipelineCache) {
+            try {
+                save();
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to save pipeline cache: " << e.what() << '\n';
+            }
+        }
+    }
+
+    std::vector<uint8_t> PipelineManager::loadCacheData() const {
+        std::ifstream file{this->cachePath, std::ios::ate | std::ios::binary};
+        if (!file.is_open()) return {};
+
+        auto fileSize = static_cast<size_t>(file.tellg());
+        std::vector<uint8_t> data(fileSize);
+
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(fileSize));
+
+        // A blob from another driver or GPU is useless at best, so check the header before handing it over
+        struct {
+            uint32_t headerSize;
+            uint32_t headerVersion;
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        } header{};
+
+        if (data.size() < sizeof(header)) {
+            std::cerr << "Pipeline cache " << this->cachePath << " is truncated, ignoring it\n";
+            return {};
+        }
+
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        bool valid = header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+                     header.headerVersion == static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne) &&
+                     header.vendorID == this->deviceProperties.vendorID &&
+                     header.deviceID == this->deviceProperties.deviceID &&
+                     std::memcmp(header.pipelineCacheUUID, this->deviceProperties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+
+        if (!valid) {
+            std::cerr << "Pipeline cache " << this->cachePath << " doesn't match this device, ignoring it\n";
+            return {};
+        }
+
+        return data;
+    }
+
+    void PipelineManager::save() const {
+        if (this->cachePath.empty()) return;
+
+        std::vector<uint8_t> data = this->pipelineCache.getData();
+
+        // Write then rename, so a crash mid-write never leaves a half written cache behind
+        std::filesystem::path tmpPath = this->cachePath;
+        tmpPath += ".tmp";
+
+        {
+            std::ofstream file{tmpPath, std::ios::binary | std::ios::trunc};
+            if (!file.is_open()) throw std::runtime_error("Failed to open file: " + tmpPath.string());
+
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        }
+
+        std::filesystem::rename(tmpPath, this->cachePath);
+    }
+
+    uint32_t PipelineManager::registerProgram(ShaderProgram program) {
+        std::scoped_lock lock(this->mutex);
+
+        this->programs.push_back(std::move(program));
+        return static_cast<uint32_t>(this->programs.size() - 1);
+    }
+
+    vk::Pipeline PipelineManager::get(const PipelineKey &key) {
+        {
+            std::scoped_lock lock(this->mutex);
+
+            auto it = this->pipelines.find(key);
+            if (it != this->pipelines.end()) return **it->second;
+        }
+
+        // Created outside the lock, the pipeline cache itself is internally synchronized
+        auto pipeline = std::make_unique<vk::raii::Pipeline>(createPipeline(key));
+
+        std::scoped_lock lock(this->mutex);
+
+        // Another thread may have won the race, keep whichever got there first
+        auto [it, inserted] = this->pipelines.try_emplace(key, std::move(pipeline));
+        return **it->second;
+    }
+
+    void PipelineManager::prewarm(std::vector<PipelineKey> keys) {
+        if (this->prewarmThread.joinable()) this->prewarmThread.join();
+
+        this->prewarmThread = std::jthread([this, keys = std::move(keys)](std::stop_token stopToken) {
+            for (const auto& key : keys) {
+                if (stopToken.stop_requested()) return;
+                get(key);
+            }
+        });
+    }
+
+    void PipelineManager::replaceShaders(uint32_t program, vk::ShaderModule vertex, vk::ShaderModule fragment) {
+        // A running prewarm could otherwise put an old variant back after the erase
+        if (this->prewarmThread.joinable()) this->prewarmThread.join();
+
+        std::scoped_lock lock(this->mutex);
+
+        ShaderProgram& target = this->programs.at(program);
+        target.vertex = vertex;
+        target.fragment = fragment;
+
+        std::erase_if(this->pipelines, [program](const auto& entry) { return entry.first.program == program; });
+    }
+
+    vk::raii::Pipeline PipelineManager::createComputePipeline(vk::ShaderModule shader, vk::PipelineLayout layout) const {
+        vk::ComputePipelineCreateInfo pipelineInfo {
+                {},
+                {{}, vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr},
+                layout
+        };
+
+        return this->device->createComputePipeline(this->pipelineCache, pipelineInfo);
+    }
+
+    size_t PipelineManager::getVariantCount() const {
+        std::scoped_lock lock(this->mutex);
+        return this->pipelines.size();
+    }
+
+    vk::raii::Pipeline PipelineManager::createPipeline(const PipelineKey &key) const {
+        ShaderProgram program;
+        {
+            std::scoped_lock lock(this->mutex);
+            program = this->programs.at(key.program);
+        }
+
+        vk::PipelineShaderStageCreateInfo shaderStages[2] = {
+                {{}, vk::ShaderStageFlagBits::eVertex, program.vertex, "main", nullptr },
+                {{}, vk::ShaderStageFlagBits::eFragment, program.fragment, "main", nullptr }
+        };
+
+        // Viewport and scissor are set while recording, resizes and clip rects don't need new variants
+        vk::PipelineViewportStateCreateInfo viewportStateInfo {
+                {},
+                1, nullptr,
+                1, nullptr
+        };
+
+        std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+
+        vk::PipelineDynamicStateCreateInfo dynamicStateInfo {
+                {},
+                dynamicStates
+        };
+
+        vk::PipelineVertexInputStateCreateInfo vertexInputStateInfo {
+                {},
+                static_cast<uint32_t>(program.bindings.size()), program.bindings.data(),
+                static_cast<uint32_t>(program.attributes.size()), program.attributes.data()
+        };
+
+        vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo {
+                {},
+                key.topology,
+                VK_FALSE
+        };
+
+        vk::PipelineRasterizationStateCreateInfo rasterizationStateInfo {
+                {},
+                VK_FALSE,
+                VK_FALSE,
+                vk::PolygonMode::eFill,
+                vk::CullModeFlagBits::eNone,
+                vk::FrontFace::eClockwise,
+                VK_FALSE,
+                0.0f, 0.0f, 0.0f,
+                1.0f
+        };
+
+        vk::PipelineMultisampleStateCreateInfo multisampleStateInfo {
+                {},
+                vk::SampleCountFlagBits::e1,
+                VK_FALSE,
+                1.0f,
+                nullptr,
+                VK_FALSE,
+                VK_FALSE
+        };
+
+        vk::PipelineColorBlendAttachmentState colorBlendAttachmentState {
+                VK_FALSE,
+                vk::BlendFactor::eOne,
+                vk::BlendFactor::eZero,
+                vk::BlendOp::eAdd,
+                vk::BlendFactor::eOne,
+                vk::BlendFactor::eZero,
+                vk::BlendOp::eAdd,
+                vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+        };
+
+        switch (key.blend) {
+            case BlendMode::eOpaque:
+                break;
+            case BlendMode::eAlpha:
+                colorBlendAttachmentState.blendEnable = VK_TRUE;
+                colorBlendAttachmentState.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+                colorBlendAttachmentState.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+                colorBlendAttachmentState.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+                break;
+            case BlendMode::eAdditive:
+                colorBlendAttachmentState.blendEnable = VK_TRUE;
+                colorBlendAttachmentState.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+                colorBlendAttachmentState.dstColorBlendFactor = vk::BlendFactor::eOne;
+                colorBlendAttachmentState.dstAlphaBlendFactor = vk::BlendFactor::eOne;
+                break;
+            case BlendMode::ePremultiplied:
+                colorBlendAttachmentState.blendEnable = VK_TRUE;
+                colorBlendAttachmentState.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+                colorBlendAttachmentState.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+                break;
+        }
+
+        vk::PipelineColorBlendStateCreateInfo colorBlendStateInfo {
+                {},
+                VK_FALSE,
+                vk::LogicOp::eCopy,
+                1, &colorBlendAttachmentState,
+                {.0f, .0f, .0f, .0f}
+        };
+
+        vk::PipelineDepthStencilStateCreateInfo depthStencilStateInfo {
+                {},
+                key.depthTest,
+                key.depthTest,
+                vk::CompareOp::eLessOrEqual,
+                VK_FALSE,
+                VK_FALSE, {}, {},
+                0.0f,
+                1.0f
+        };
+
+        vk::GraphicsPipelineCreateInfo pipelineInfo {
+                {},
+                2, shaderStages,
+                &vertexInputStateInfo,
+                &inputAssemblyStateInfo, {},
+                &viewportStateInfo,
+                &rasterizationStateInfo,
+                &multisampleStateInfo,
+                &depthStencilStateInfo,
+                &colorBlendStateInfo,
+                &dynamicStateInfo,
+                program.layout,
+                key.renderPass,
+                key.subpass,
+                VK_NULL_HANDLE, -1
+        };
+
+        return this->device->createGraphicsPipeline(this->pipelineCache, pipelineInfo);
+    }
+
+} // imr
@@ -0,0 +1,134 @@
+#ifndef VK_IMM_RENDERER_PIPELINE_MANAGER_HPP
+#define VK_IMM_RENDERER_PIPELINE_MANAGER_HPP
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <filesystem>
+#include <unordered_map>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "renderer.hpp"
+#include "vertex_format.hpp"
+
+namespace imr {
+
+    constexpr vk::Format getVertexAttributeFormat(VertexAttributeType type) {
+        switch (type) {
+            case VertexAttributeType::eFloat: return vk::Format::eR32Sfloat;
+            case VertexAttributeType::eFloat2: return vk::Format::eR32G32Sfloat;
+            case VertexAttributeType::eFloat4: return vk::Format::eR32G32B32A32Sfloat;
+            case VertexAttributeType::eUint: return vk::Format::eR32Uint;
+            case VertexAttributeType::eUnorm16x2: return vk::Format::eR16G16Unorm;
+            case VertexAttributeType::eUnorm8x4: return vk::Format::eR8G8B8A8Unorm;
+        }
+        return vk::Format::eUndefined;
+    }
+
+    template<VertexFormat T>
+    constexpr vk::VertexInputBindingDescription getVertexBinding(uint32_t binding, vk::VertexInputRate rate) {
+        return {binding, static_cast<uint32_t>(sizeof(T)), rate};
+    }
+
+    // Location i is T::getAttributes()[i]
+    template<VertexFormat T>
+    constexpr auto getVertexAttributes(uint32_t binding) {
+        constexpr auto attributes = T::getAttributes();
+
+        std::array<vk::VertexInputAttributeDescription, attributes.size()> descriptions{};
+        for (uint32_t location = 0; location < attributes.size(); location++) {
+            descriptions[location] = {location, binding, getVertexAttributeFormat(attributes[location].type), attributes[location].offset};
+        }
+        return descriptions;
+    }
+
+    // Shader pair plus the fixed inputs it expects, registered once and referenced by id from PipelineKey
+    struct ShaderProgram {
+        vk::ShaderModule vertex;
+        vk::ShaderModule fragment;
+        vk::PipelineLayout layout;
+        std::vector<vk::VertexInputBindingDescription> bindings;
+        std::vector<vk::VertexInputAttributeDescription> attributes;
+    };
+
+    // Program reading T from a single binding, its vertex input state is built at compile time
+    template<VertexFormat T, uint32_t Binding = 0, vk::VertexInputRate Rate = vk::VertexInputRate::eVertex>
+    ShaderProgram makeShaderProgram(vk::ShaderModule vertex, vk::ShaderModule fragment, vk::PipelineLayout layout) {
+        static constexpr vk::VertexInputBindingDescription Bindings[] = {getVertexBinding<T>(Binding, Rate)};
+        static constexpr auto Attributes = getVertexAttributes<T>(Binding);
+
+        return {vertex, fragment, layout, {std::begin(Bindings), std::end(Bindings)}, {Attributes.begin(), Attributes.end()}};
+    }
+
+    // The pipeline state that actually varies at runtime, everything else is fixed by the manager.
+    // Viewport and scissor are dynamic and have to be set on every command buffer before drawing.
+    struct PipelineKey {
+        uint32_t program = 0;
+        BlendMode blend = BlendMode::eAlpha;
+        vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+        bool depthTest = false;
+        vk::RenderPass renderPass;
+        uint32_t subpass = 0;
+
+        bool operator==(const PipelineKey&) const = default;
+    };
+
+    struct PipelineKeyHash {
+        size_t operator()(const PipelineKey& key) const;
+    };
+
+    // Creates pipeline variants lazily and backs them with a vk::PipelineCache that survives restarts
+    class PipelineManager {
+    public:
+        PipelineManager() = default;
+        PipelineManager(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice,
+                        std::filesystem::path cachePath);
+
+        PipelineManager(PipelineManager&& other) noexcept;
+        PipelineManager& operator=(PipelineManager&& other) noexcept;
+
+        ~PipelineManager();
+
+        uint32_t registerProgram(ShaderProgram program);
+
+        // Creates the variant on first use, later calls are a hash lookup
+        vk::Pipeline get(const PipelineKey& key);
+        // Builds the given variants on a background thread so first use doesn't stall the frame
+        void prewarm(std::vector<PipelineKey> keys);
+
+        // Compute pipelines have no variants, the caller owns them. They still go through the on-disk cache.
+        [[nodiscard]] vk::raii::Pipeline createComputePipeline(vk::ShaderModule shader, vk::PipelineLayout layout) const;
+
+        // Swaps a program's shaders and drops its variants so they are rebuilt on next use.
+        // The old pipelines are destroyed right away, so the device must not be using them anymore.
+        void replaceShaders(uint32_t program, vk::ShaderModule vertex, vk::ShaderModule fragment);
+
+        // Writes the driver's cache blob to disk, also done on destruction
+        void save() const;
+
+        [[nodiscard]] size_t getVariantCount() const;
+
+    private:
+        const vk::raii::Device* device = nullptr;
+        vk::PhysicalDeviceProperties deviceProperties;
+        std::filesystem::path cachePath;
+
+        vk::raii::PipelineCache pipelineCache{VK_NULL_HANDLE};
+
+        std::vector<ShaderProgram> programs;
+
+        mutable std::mutex mutex;
+        std::unordered_map<PipelineKey, std::unique_ptr<vk::raii::Pipeline>, PipelineKeyHash> pipelines;
+
+        std::jthread prewarmThread;
+
+        std::vector<uint8_t> loadCacheData() const;
+        vk::raii::Pipeline createPipeline(const PipelineKey& key) const;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_PIPELINE_MANAGER_HPP
@@ -0,0 +1,585 @@
+#include "renderer.hpp"
+#include "text_cache.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    void Renderer::begin() {
+        // The owned arena keeps its size across frames, so after the first few frames it stops allocating
+        begin({this->ownedVertices.data(), static_cast<uint32_t>(this->ownedVertices.size()),
+               this->ownedIndices.data(), static_cast<uint32_t>(this->ownedIndices.size()),
+               this->ownedShapes.data(), static_cast<uint32_t>(this->ownedShapes.size())});
+        this->ownsStorage = true;
+    }
+
+    void Renderer::begin(const GeometryTarget &geometryTarget) {
+        if (this->recording) throw std::runtime_error("Renderer::begin called twice without end");
+
+        this->target = geometryTarget;
+        this->ownsStorage = false;
+        this->vertexCount = 0;
+        this->indexCount = 0;
+        this->shapeCount = 0;
+        this->batches.clear();
+        this->zoneMarkers.clear();
+        this->openZones = 0;
+        this->splitBatch = false;
+        this->blendMode = BlendMode::eAlpha;
+        this->clip = {};
+        this->clipStack.clear();
+
+        this->openScopes.clear();
+        this->vertexBase = 0;
+        this->atlasPageMask = 0;
+        this->drewPlaceholder = false;
+        this->drewUncached = false;
+        this->unchanged = false;
+        this->frameScopes.clear();
+        this->frame++;
+
+        this->recording = true;
+    }
+
+    void Renderer::end() {
+        if (!this->recording) throw std::runtime_error("Renderer::end called without begin");
+
+        if (!this->openScopes.empty()) throw std::runtime_error("Renderer::end with an open scope");
+        if (!this->clipStack.empty()) throw std::runtime_error("Renderer::end with a pushed clip rect");
+        while (this->openZones > 0) endZone();
+
+        this->unchanged = !this->drewUncached && this->frameScopes == this->previousFrameScopes;
+        std::swap(this->frameScopes, this->previousFrameScopes);
+
+        // Sweeping touches every scope, once in a while is enough
+        if (this->frame % 256 == 0) {
+            uint64_t frame = this->frame;
+            std::erase_if(this->scopeCache, [frame](const auto& entry) { return entry.second.lastUsed + ScopeLifetime < frame; });
+        }
+
+        this->recording = false;
+    }
+
+    bool Renderer::beginScope(uint64_t id, uint64_t contentHash) {
+        if (!this->recording) throw std::runtime_error("Renderer::beginScope outside of begin/end");
+
+        this->openScopes.push_back({
+            id, contentHash,
+            this->vertexCount, this->indexCount, this->shapeCount,
+            static_cast<uint32_t>(this->batches.size()), static_cast<uint32_t>(this->zoneMarkers.size()), this->openZones,
+            static_cast<uint32_t>(this->clipStack.size()),
+            this->vertexBase, this->atlasPageMask, this->drewPlaceholder,
+            false
+        });
+
+        // Only top level scopes are compared, nested ones are part of their parent's result
+        if (this->openScopes.size() == 1) this->frameScopes.emplace_back(id, contentHash);
+
+        auto it = this->scopeCache.find(id);
+        if (it != this->scopeCache.end() && it->second.contentHash == contentHash && it->second.clip == this->clip) {
+            ScopeCache& cache = it->second;
+
+            bool atlasValid = cache.atlasPageMask == 0 || (this->textCache && this->textCache->getAtlas().getEpoch() == cache.atlasEpoch);
+            bool texturesValid = !cache.drewPlaceholder || (this->textureSlots && this->textureSlots->getEpoch() == cache.textureEpoch);
+            if (atlasValid && texturesValid) {
+                cache.lastUsed = this->frame;
+                replay(cache);
+                this->openScopes.back().hit = true;
+                return false;
+            }
+        }
+
+        this->splitBatch = true;
+        this->vertexBase = this->vertexCount;
+        this->atlasPageMask = 0;
+        this->drewPlaceholder = false;
+
+        return true;
+    }
+
+    void Renderer::endScope() {
+        if (this->openScopes.empty()) throw std::runtime_error("Renderer::endScope without a matching beginScope");
+
+        OpenScope scope = this->openScopes.back();
+        this->openScopes.pop_back();
+
+        if (scope.hit) return;
+        if (this->openZones != scope.zoneDepth) throw std::runtime_error("GPU zones have to be closed inside the scope they were opened in");
+        if (this->clipStack.size() != scope.clipDepth) throw std::runtime_error("Clip rects have to be popped inside the scope they were pushed in");
+
+        // Anything drawn in a missed scope is new this frame, even if the next frame will hit
+        this->drewUncached = true;
+
+        ScopeCache& cache = this->scopeCache[scope.id];
+        cache.contentHash = scope.contentHash;
+        cache.clip = this->clip;
+        cache.lastUsed = this->frame;
+        cache.atlasPageMask = this->atlasPageMask;
+        cache.atlasEpoch = this->textCache ? this->textCache->getAtlas().getEpoch() : 0;
+        cache.drewPlaceholder = this->drewPlaceholder;
+        cache.textureEpoch = this->textureSlots ? this->textureSlots->getEpoch() : 0;
+
+        cache.vertices.assign(this->target.vertices + scope.vertex, this->target.vertices + this->vertexCount);
+        cache.indices.assign(this->target.indices + scope.index, this->target.indices + this->indexCount);
+        cache.shapes.assign(this->target.shapes + scope.shape, this->target.shapes + this->shapeCount);
+
+        cache.batches.assign(this->batches.begin() + scope.batch, this->batches.end());
+        for (auto& batch : cache.batches) {
+            batch.firstIndex -= scope.index;
+            batch.firstInstance -= scope.shape;
+            batch.vertexOffset -= static_cast<int32_t>(scope.vertex);
+        }
+
+        cache.zoneMarkers.assign(this->zoneMarkers.begin() + scope.zoneMarker, this->zoneMarkers.end());
+        for (auto& marker : cache.zoneMarkers) marker.batch -= scope.batch;
+
+        this->splitBatch = true;
+        this->vertexBase = scope.parentVertexBase;
+        this->atlasPageMask |= scope.atlasPageMask;
+        this->drewPlaceholder = this->drewPlaceholder || scope.drewPlaceholder;
+    }
+
+    void Renderer::replay(const ScopeCache &cache) {
+        auto vertices = static_cast<uint32_t>(cache.vertices.size());
+        auto indices = static_cast<uint32_t>(cache.indices.size());
+        auto shapes = static_cast<uint32_t>(cache.shapes.size());
+
+        if (this->vertexCount + vertices > this->target.vertexCapacity ||
+            this->indexCount + indices > this->target.indexCapacity ||
+            this->shapeCount + shapes > this->target.shapeCapacity) {
+            grow(this->vertexCount + vertices, this->indexCount + indices, this->shapeCount + shapes);
+        }
+
+        std::copy(cache.vertices.begin(), cache.vertices.end(), this->target.vertices + this->vertexCount);
+        std::copy(cache.indices.begin(), cache.indices.end(), this->target.indices + this->indexCount);
+        std::copy(cache.shapes.begin(), cache.shapes.end(), this->target.shapes + this->shapeCount);
+
+        auto batchBase = static_cast<uint32_t>(this->batches.size());
+        for (DrawBatch batch : cache.batches) {
+            batch.firstIndex += this->indexCount;
+            batch.firstInstance += this->shapeCount;
+            batch.vertexOffset += static_cast<int32_t>(this->vertexCount);
+            this->batches.push_back(batch);
+        }
+
+        for (ZoneMarker marker : cache.zoneMarkers) {
+            marker.batch += batchBase;
+            this->zoneMarkers.push_back(marker);
+        }
+
+        this->vertexCount += vertices;
+        this->indexCount += indices;
+        this->shapeCount += shapes;
+        this->splitBatch = true;
+
+        if (cache.atlasPageMask != 0) {
+            this->textCache->getAtlas().touchPages(cache.atlasPageMask);
+            this->atlasPageMask |= cache.atlasPageMask;
+        }
+        this->drewPlaceholder = this->drewPlaceholder || cache.drewPlaceholder;
+    }
+
+    void Renderer::beginZone(const char *name) {
+        this->zoneMarkers.push_back({static_cast<uint32_t>(this->batches.size()), name});
+        this->openZones++;
+        this->splitBatch = true;
+    }
+
+    void Renderer::endZone() {
+        if (this->openZones == 0) throw std::runtime_error("Renderer::endZone without a matching beginZone");
+
+        this->zoneMarkers.push_back({static_cast<uint32_t>(this->batches.size()), nullptr});
+        this->openZones--;
+        this->splitBatch = true;
+    }
+
+    void Renderer::writeDrawCommands(std::span<DrawIndirectCommand> commands, bool culledShapes) const {
+        if (commands.size() < this->batches.size()) throw std::runtime_error("Draw commands don't fit into the indirect buffer");
+
+        for (size_t i = 0; i < this->batches.size(); i++) {
+            const DrawBatch& batch = this->batches[i];
+            if (batch.state.pipeline == PipelineType::eShape) {
+                // Two triangles per instance. The first instance goes where the indexed layout has the vertex offset.
+                commands[i] = {6, culledShapes ? 0 : batch.instanceCount, 0, static_cast<int32_t>(batch.firstInstance), 0};
+            } else {
+                commands[i] = {batch.indexCount, 1, batch.firstIndex, batch.vertexOffset, 0};
+            }
+        }
+    }
+
+    void Renderer::pushClipRect(glm::vec2 position, glm::vec2 size) {
+        this->clipStack.push_back(this->clip);
+
+        // Intersected with the parent, an empty result culls everything until the pop
+        glm::vec2 max = position + size;
+        this->clip.min = {std::max(this->clip.min.x, position.x), std::max(this->clip.min.y, position.y)};
+        this->clip.max = {std::max(this->clip.min.x, std::min(this->clip.max.x, max.x)),
+                          std::max(this->clip.min.y, std::min(this->clip.max.y, max.y))};
+    }
+
+    void Renderer::popClipRect() {
+        if (this->clipStack.empty()) throw std::runtime_error("Renderer::popClipRect without a matching pushClipRect");
+
+        this->clip = this->clipStack.back();
+        this->clipStack.pop_back();
+    }
+
+    bool Renderer::isCulled(glm::vec2 corner0, glm::vec2 corner1, float margin) const {
+        return std::max(corner0.x, corner1.x) + margin <= this->clip.min.x ||
+               std::max(corner0.y, corner1.y) + margin <= this->clip.min.y ||
+               std::min(corner0.x, corner1.x) - margin >= this->clip.max.x ||
+               std::min(corner0.y, corner1.y) - margin >= this->clip.max.y;
+    }
+
+    void Renderer::grow(uint32_t requiredVertices, uint32_t requiredIndices, uint32_t requiredShapes) {
+        if (!this->ownsStorage) throw std::runtime_error("Frame geometry doesn't fit into the upload buffer");
+
+        if (requiredVertices > this->ownedVertices.size())
+            this->ownedVertices.resize(std::max<size_t>(requiredVertices, this->ownedVertices.size() * 2));
+        if (requiredIndices > this->ownedIndices.size())
+            this->ownedIndices.resize(std::max<size_t>(requiredIndices, this->ownedIndices.size() * 2));
+        if (requiredShapes > this->ownedShapes.size())
+            this->ownedShapes.resize(std::max<size_t>(requiredShapes, this->ownedShapes.size() * 2));
+
+        this->target = {this->ownedVertices.data(), static_cast<uint32_t>(this->ownedVertices.size()),
+                        this->ownedIndices.data(), static_cast<uint32_t>(this->ownedIndices.size()),
+                        this->ownedShapes.data(), static_cast<uint32_t>(this->ownedShapes.size())};
+    }
+
+    uint32_t Renderer::reserve(const DrawState &state, uint32_t primitiveVertices, uint32_t primitiveIndices) {
+        if (!this->recording) throw std::runtime_error("Renderer draw call outside of begin/end");
+
+        if (this->vertexCount + primitiveVertices > this->target.vertexCapacity ||
+            this->indexCount + primitiveIndices > this->target.indexCapacity) {
+            grow(this->vertexCount + primitiveVertices, this->indexCount + primitiveIndices, this->shapeCount);
+        }
+
+        if (this->batches.empty() || this->splitBatch || this->batches.back().state != state) {
+            this->batches.push_back({state, this->indexCount, 0, 0, 0, static_cast<int32_t>(this->vertexBase)});
+            this->splitBatch = false;
+        }
+        this->batches.back().indexCount += primitiveIndices;
+        this->drewUncached = true;
+
+        uint32_t baseVertex = this->vertexCount;
+        this->vertexCount += primitiveVertices;
+
+        return baseVertex;
+    }
+
+    void Renderer::unreserve(uint32_t vertices, uint32_t indices) {
+        this->vertexCount -= vertices;
+        this->batches.back().indexCount -= indices;
+    }
+
+    void Renderer::pushShape(const ShapeInstance &shape, BlendMode blend) {
+        if (!this->recording) throw std::runtime_error("Renderer draw call outside of begin/end");
+
+        // Same extent as the quad sdf_shape.vert expands, and as cull_shapes.comp tests
+        if (!this->gpuShapeCulling && isCulled(shape.center - shape.halfSize, shape.center + shape.halfSize, shape.softness + 1.0f)) return;
+
+        if (this->shapeCount + 1 > this->target.shapeCapacity) {
+            grow(this->vertexCount, this->indexCount, this->shapeCount + 1);
+        }
+
+        DrawState state{PipelineType::eShape, blend, this->clip};
+        if (this->batches.empty() || this->splitBatch || this->batches.back().state != state) {
+            this->batches.push_back({state, this->indexCount, 0, this->shapeCount, 0, static_cast<int32_t>(this->vertexBase)});
+            this->splitBatch = false;
+        }
+        this->batches.back().instanceCount++;
+        this->drewUncached = true;
+
+        this->target.shapes[this->shapeCount++] = shape;
+    }
+
+    bool Renderer::isCulled(std::span<const glm::vec2> points, float margin) const {
+        if (points.empty()) return true;
+
+        glm::vec2 min = points.front(), max = points.front();
+        for (glm::vec2 point : points) {
+            min = {std::min(min.x, point.x), std::min(min.y, point.y)};
+            max = {std::max(max.x, point.x), std::max(max.y, point.y)};
+        }
+
+        return isCulled(min, max, margin);
+    }
+
+    void Renderer::pushIndices(std::initializer_list<uint32_t> values) {
+        uint32_t* out = this->target.indices + this->indexCount;
+        for (uint32_t value : values) *out++ = value - this->vertexBase;
+        this->indexCount += static_cast<uint32_t>(values.size());
+    }
+
+    void Renderer::pushQuad(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, glm::vec2 p3,
+                            glm::vec2 uvMin, glm::vec2 uvMax, Unorm8x4 color, const DrawState &state, uint32_t textureSlot) {
+        uint32_t base = reserve(state, 4, 6);
+
+        Unorm16x2 min = packUnorm16x2(uvMin), max = packUnorm16x2(uvMax);
+        Vertex* v = this->target.vertices + base;
+        v[0] = {p0, {min.x, min.y}, color, textureSlot};
+        v[1] = {p1, {max.x, min.y}, color, textureSlot};
+        v[2] = {p2, {max.x, max.y}, color, textureSlot};
+        v[3] = {p3, {min.x, max.y}, color, textureSlot};
+
+        pushIndices({base, base + 1, base + 2, base + 2, base + 3, base});
+    }
+
+    void Renderer::drawRect(glm::vec2 position, glm::vec2 size, glm::vec4 color) {
+        glm::vec2 max = position + size;
+        if (isCulled(position, max)) return;
+
+        pushQuad(position, {max.x, position.y}, max, {position.x, max.y},
+                 {0.0f, 0.0f}, {0.0f, 0.0f}, packUnorm8x4(color), {PipelineType::eSolid, this->blendMode, this->clip});
+    }
+
+    void Renderer::drawLine(glm::vec2 from, glm::vec2 to, float thickness, glm::vec4 color) {
+        glm::vec2 dir = to - from;
+        float length = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+        if (length <= 0.0f || isCulled(from, to, thickness * 0.5f)) return;
+
+        glm::vec2 normal = glm::vec2(-dir.y, dir.x) * (thickness * 0.5f / length);
+
+        pushQuad(from + normal, to + normal, to - normal, from - normal,
+                 {0.0f, 0.0f}, {0.0f, 0.0f}, packUnorm8x4(color), {PipelineType::eSolid, this->blendMode, this->clip});
+    }
+
+    void Renderer::drawPolyline(std::span<const glm::vec2> points, const StrokeStyle &style, glm::vec4 color) {
+        uint32_t segments = Tessellator::getSegmentCount(static_cast<uint32_t>(points.size()), style);
+        if (segments == 0) return;
+
+        if (this->jobSystem && this->jobSystem->getThreadCount() > 1 && segments >= ParallelStrokeMinSegments) {
+            drawPolylineChunked(points, style, color, segments);
+            return;
+        }
+
+        // Miters reach out the furthest
+        float margin = style.width * 0.5f * std::max(style.miterLimit, 1.5f);
+        if (isCulled(points, margin)) return;
+
+        TessellationCount bound = Tessellator::getStrokeBound(static_cast<uint32_t>(points.size()), style);
+        uint32_t base = reserve({PipelineType::eSolid, this->blendMode, this->clip}, bound.vertices, bound.indices);
+
+        TessellationCount written = this->tessellator.stroke(points, style, {
+                this->target.vertices + base,
+                this->target.indices + this->indexCount,
+                base - this->vertexBase,
+                packUnorm8x4(color)
+        });
+
+        this->indexCount += written.indices;
+        unreserve(bound.vertices - written.vertices, bound.indices - written.indices);
+    }
+
+    void Renderer::drawPolylineChunked(std::span<const glm::vec2> points, const StrokeStyle &style, glm::vec4 color, uint32_t segments) {
+        auto pointCount = static_cast<uint32_t>(points.size());
+        uint32_t threads = this->jobSystem->getThreadCount();
+
+        // A few chunks per thread, so stealing can even out chunks that are culled or cheaper than others
+        uint32_t chunkSegments = std::max(StrokeChunkMinSegments, (segments + threads * 4 - 1) / (threads * 4));
+        uint32_t chunkCount = (segments + chunkSegments - 1) / chunkSegments;
+
+        // Every chunk gets a range as large as its bound, they don't depend on each other's output
+        this->strokeChunks.resize(chunkCount);
+        TessellationCount total{0, 0};
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            uint32_t first = chunk * chunkSegments;
+            uint32_t count = std::min(chunkSegments, segments - first);
+
+            this->strokeChunks[chunk] = {first, count, total, {0, 0}};
+
+            TessellationCount bound = Tessellator::getStrokeSectionBound(pointCount, style, first, count);
+            total.vertices += bound.vertices;
+            total.indices += bound.indices;
+        }
+
+        DrawState state{PipelineType::eSolid, this->blendMode, this->clip};
+        uint32_t base = reserve(state, total.vertices, total.indices);
+        uint32_t firstIndex = this->indexCount;
+
+        if (this->chunkTessellators.size() < threads) this->chunkTessellators.resize(threads);
+        Unorm8x4 packedColor = packUnorm8x4(color);
+
+        float margin = style.width * 0.5f * std::max(style.miterLimit, 1.5f);
+        this->jobSystem->parallelFor(chunkCount, [&](uint32_t index) {
+            StrokeChunk& chunk = this->strokeChunks[index];
+
+            // The points the chunk's segments touch, the closing segment also reaches back to the first one
+            uint32_t end = chunk.firstSegment + chunk.segmentCount;
+            auto chunkPoints = points.subspan(chunk.firstSegment, std::min(end, pointCount - 1) - chunk.firstSegment + 1);
+            if (end < pointCount && isCulled(chunkPoints, margin)) return;
+
+            chunk.written = this->chunkTessellators[this->jobSystem->getThreadIndex()].strokeSection(points, style, chunk.firstSegment, chunk.segmentCount, {
+                    this->target.vertices + base + chunk.offset.vertices,
+                    this->target.indices + firstIndex + chunk.offset.indices,
+                    base - this->vertexBase + chunk.offset.vertices,
+                    packedColor
+            });
+        });
+
+        // The reservation went into the last batch, it's replaced by what the chunks wrote. Chunks that left
+        // a gap behind them start a new batch, unused vertices in between are simply never referenced.
+        this->batches.back().indexCount -= total.indices;
+        uint32_t indexEnd = firstIndex;
+        uint32_t vertexEnd = base;
+
+        for (const auto& chunk : this->strokeChunks) {
+            if (chunk.written.indices == 0) continue;
+
+            uint32_t start = firstIndex + chunk.offset.indices;
+            if (start != indexEnd) {
+                // The batch the reservation opened may still be empty, it can start later then
+                DrawBatch& last = this->batches.back();
+                if (last.indexCount == 0 && last.instanceCount == 0) last.firstIndex = start;
+                else this->batches.push_back({state, start, 0, 0, 0, static_cast<int32_t>(this->vertexBase)});
+            }
+            this->batches.back().indexCount += chunk.written.indices;
+
+            indexEnd = start + chunk.written.indices;
+            vertexEnd = base + chunk.offset.vertices + chunk.written.vertices;
+        }
+
+        // Everything culled, the batch the reservation opened has nothing to draw
+        if (this->batches.back().indexCount == 0 && this->batches.back().instanceCount == 0) {
+            this->batches.pop_back();
+            this->splitBatch = true;
+        }
+
+        this->indexCount = indexEnd;
+        this->vertexCount = vertexEnd;
+    }
+
+    void Renderer::fillPolygon(std::span<const glm::vec2> points, glm::vec4 color) {
+        if (points.size() < 3 || isCulled(points, 0.0f)) return;
+
+        TessellationCount bound = Tessellator::getFillBound(static_cast<uint32_t>(points.size()));
+        uint32_t base = reserve({PipelineType::eSolid, this->blendMode, this->clip}, bound.vertices, bound.indices);
+
+        TessellationCount written = this->tessellator.fill(points, {
+                this->target.vertices + base,
+                this->target.indices + this->indexCount,
+                base - this->vertexBase,
+                packUnorm8x4(color)
+        });
+
+        this->indexCount += written.indices;
+        unreserve(bound.vertices - written.vertices, bound.indices - written.indices);
+    }
+
+    void Renderer::strokePath(const Path &path, const StrokeStyle &style, glm::vec4 color) {
+        StrokeStyle subPathStyle = style;
+        for (const auto& subPath : path.getSubPaths()) {
+            subPathStyle.closed = subPath.closed;
+            drawPolyline(std::span(path.getPoints()).subspan(subPath.first, subPath.count), subPathStyle, color);
+        }
+    }
+
+    void Renderer::fillPath(const Path &path, glm::vec4 color) {
+        for (const auto& subPath : path.getSubPaths()) {
+            fillPolygon(std::span(path.getPoints()).subspan(subPath.first, subPath.count), color);
+        }
+    }
+
+    void Renderer::drawTexturedQuad(glm::vec2 position, glm::vec2 size, TextureHandle texture,
+                                    glm::vec2 uvMin, glm::vec2 uvMax, glm::vec4 tint) {
+        glm::vec2 max = position + size;
+        if (isCulled(position, max)) return;
+
+        // Any texture can follow in the same batch, only the slot in the vertices differs
+        uint32_t slot = this->textureSlots ? this->textureSlots->get(texture) : PlaceholderSlot;
+        if (slot == PlaceholderSlot) this->drewPlaceholder = true;
+
+        pushQuad(position, {max.x, position.y}, max, {position.x, max.y},
+                 uvMin, uvMax, packUnorm8x4(tint), {PipelineType::eTextured, this->blendMode, this->clip}, slot);
+    }
+
+    void Renderer::drawShape(const ShapeInstance &shape) {
+        pushShape(shape, this->blendMode);
+    }
+
+    void Renderer::drawRoundedRect(glm::vec2 position, glm::vec2 size, float radius, glm::vec4 color) {
+        drawRoundedRect(position, size, {radius, radius, radius, radius}, color);
+    }
+
+    void Renderer::drawRoundedRect(glm::vec2 position, glm::vec2 size, glm::vec4 radii, glm::vec4 color) {
+        glm::vec2 halfSize = size * 0.5f;
+        float maxRadius = std::min(halfSize.x, halfSize.y);
+
+        // (top left, top right, bottom right, bottom left) to the order sdRoundBox picks them in
+        glm::vec4 cornerRadii(std::clamp(radii.z, 0.0f, maxRadius), std::clamp(radii.y, 0.0f, maxRadius),
+                              std::clamp(radii.w, 0.0f, maxRadius), std::clamp(radii.x, 0.0f, maxRadius));
+
+        pushShape({position + halfSize, halfSize, cornerRadii, packUnorm8x4(color), {}, 0.0f, 0.0f}, this->blendMode);
+    }
+
+    void Renderer::drawBorder(glm::vec2 position, glm::vec2 size, float radius, float thickness, glm::vec4 color) {
+        glm::vec2 halfSize = size * 0.5f;
+        radius = std::clamp(radius, 0.0f, std::min(halfSize.x, halfSize.y));
+
+        pushShape({position + halfSize, halfSize, {radius, radius, radius, radius},
+                   packUnorm8x4({color.x, color.y, color.z, 0.0f}), packUnorm8x4(color), thickness, 0.0f}, this->blendMode);
+    }
+
+    void Renderer::drawCircle(glm::vec2 center, float radius, glm::vec4 color) {
+        if (radius <= 0.0f) return;
+
+        pushShape({center, {radius, radius}, {radius, radius, radius, radius}, packUnorm8x4(color), {}, 0.0f, 0.0f}, this->blendMode);
+    }
+
+    void Renderer::drawShadow(glm::vec2 position, glm::vec2 size, float radius, glm::vec2 offset, float blur, glm::vec4 color) {
+        glm::vec2 halfSize = size * 0.5f;
+        radius = std::clamp(radius, 0.0f, std::min(halfSize.x, halfSize.y));
+
+        pushShape({position + halfSize + offset, halfSize, {radius, radius, radius, radius},
+                   packUnorm8x4(color), {}, 0.0f, std::max(blur, 0.0f)}, this->blendMode);
+    }
+
+    void Renderer::drawGlow(glm::vec2 position, glm::vec2 size, float radius, float spread, glm::vec4 color) {
+        glm::vec2 halfSize = size * 0.5f;
+        radius = std::clamp(radius, 0.0f, std::min(halfSize.x, halfSize.y));
+
+        // Centered on the edge, so half of the falloff lies outside the shape
+        pushShape({position + halfSize, halfSize, {radius, radius, radius, radius},
+                   packUnorm8x4(color), {}, 0.0f, std::max(spread, 0.0f) * 2.0f}, BlendMode::eAdditive);
+    }
+
+    glm::vec2 Renderer::drawText(glm::vec2 position, std::string_view text, float size, glm::vec4 color, uint32_t font) {
+        if (!this->textCache) throw std::runtime_error("Renderer has no text cache attached");
+
+        const TextRun& run = this->textCache->getRun(text, font, size);
+        auto quadCount = static_cast<uint32_t>(run.quads.size());
+        if (quadCount == 0 || isCulled(position, position + run.size)) return run.size;
+
+        // One reservation for the whole run, the loop below is just copies
+        uint32_t base = reserve({PipelineType::eText, this->blendMode, this->clip}, quadCount * 4, quadCount * 6);
+
+        Vertex* v = this->target.vertices + base;
+        uint32_t* i = this->target.indices + this->indexCount;
+        this->atlasPageMask |= run.pageMask;
+        base -= this->vertexBase;
+        Unorm8x4 packedColor = packUnorm8x4(color);
+
+        for (const auto& quad : run.quads) {
+            glm::vec2 min = position + quad.min;
+            glm::vec2 max = position + quad.max;
+
+            Unorm16x2 uvMin = packUnorm16x2(quad.uvMin), uvMax = packUnorm16x2(quad.uvMax);
+            v[0] = {min, uvMin, packedColor, GlyphAtlasSlot};
+            v[1] = {{max.x, min.y}, {uvMax.x, uvMin.y}, packedColor, GlyphAtlasSlot};
+            v[2] = {max, uvMax, packedColor, GlyphAtlasSlot};
+            v[3] = {{min.x, max.y}, {uvMin.x, uvMax.y}, packedColor, GlyphAtlasSlot};
+            v += 4;
+
+            i[0] = base; i[1] = base + 1; i[2] = base + 2;
+            i[3] = base + 2; i[4] = base + 3; i[5] = base;
+            i += 6;
+            base += 4;
+        }
+        this->indexCount += quadCount * 6;
+
+        return run.size;
+    }
+
+} // imr
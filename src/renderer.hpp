@@ -0,0 +1,348 @@
+#ifndef VK_IMM_RENDERER_RENDERER_HPP
+#define VK_IMM_RENDERER_RENDERER_HPP
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "vertex_format.hpp"
+#include "texture_slots.hpp"
+#include "tessellator.hpp"
+#include "job_system.hpp"
+
+namespace imr {
+
+    class TextCache;
+
+    // 20 bytes. Positions stay floats, 16 bits would cost antialiased edges their subpixel precision on large
+    // framebuffers. Uvs have to lie in [0, 1].
+    struct Vertex {
+        glm::vec2 position;
+        Unorm16x2 uv;
+        Unorm8x4 color;
+        // Texture table slot, only read by the programs that sample
+        uint32_t texture = 0;
+
+        static constexpr std::array<VertexAttribute, 4> getAttributes() {
+            return {{
+                    makeVertexAttribute<glm::vec2>(offsetof(Vertex, position)),
+                    makeVertexAttribute<Unorm16x2>(offsetof(Vertex, uv)),
+                    makeVertexAttribute<Unorm8x4>(offsetof(Vertex, color)),
+                    makeVertexAttribute<uint32_t>(offsetof(Vertex, texture))
+            }};
+        }
+    };
+
+    // One analytically shaded shape, expanded to a quad in sdf_shape.vert. Laid out to be read as per instance vertex attributes.
+    struct ShapeInstance {
+        glm::vec2 center;
+        glm::vec2 halfSize;
+        // Shader order: bottom right, top right, bottom left, top left
+        glm::vec4 cornerRadii;
+        Unorm8x4 fillColor;
+        Unorm8x4 borderColor;
+        float borderWidth;
+        // Width of the edge falloff in pixels, 0 gives a crisp antialiased edge, larger values shadows and glows
+        float softness;
+
+        static constexpr std::array<VertexAttribute, 6> getAttributes() {
+            return {{
+                    makeVertexAttribute<glm::vec2>(offsetof(ShapeInstance, center)),
+                    makeVertexAttribute<glm::vec2>(offsetof(ShapeInstance, halfSize)),
+                    makeVertexAttribute<glm::vec4>(offsetof(ShapeInstance, cornerRadii)),
+                    makeVertexAttribute<Unorm8x4>(offsetof(ShapeInstance, fillColor)),
+                    makeVertexAttribute<Unorm8x4>(offsetof(ShapeInstance, borderColor)),
+                    // Border width and softness in one
+                    makeVertexAttribute<glm::vec2>(offsetof(ShapeInstance, borderWidth))
+            }};
+        }
+    };
+
+    static_assert(VertexFormat<Vertex> && VertexFormat<ShapeInstance>);
+
+    enum class PipelineType : uint8_t {
+        eSolid,
+        eTextured,
+        // Instanced SDF shapes, the batch draws ShapeInstances instead of indices
+        eShape,
+        // Vertices sampling coverage from the glyph atlas
+        eText
+    };
+
+    enum class BlendMode : uint8_t {
+        eOpaque,
+        eAlpha,
+        eAdditive,
+        ePremultiplied
+    };
+
+    // Axis aligned clip in framebuffer pixels, applied as the scissor. The default doesn't clip anything.
+    struct ClipRect {
+        glm::vec2 min{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+        glm::vec2 max{std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+
+        bool operator==(const ClipRect&) const = default;
+    };
+
+    // Everything that forces a new draw call when it changes between two primitives
+    struct DrawState {
+        PipelineType pipeline = PipelineType::eSolid;
+        BlendMode blend = BlendMode::eAlpha;
+        // Textures aren't part of it, the vertices index the texture table
+        ClipRect clip;
+
+        bool operator==(const DrawState&) const = default;
+    };
+
+    struct DrawBatch {
+        DrawState state;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstInstance = 0;
+        uint32_t instanceCount = 0;
+        // Added to every index, lets cached scopes be replayed anywhere in the vertex stream
+        int32_t vertexOffset = 0;
+    };
+
+    // Laid out like VkDrawIndexedIndirectCommand. Shape batches aren't indexed, they use the first four fields as a
+    // VkDrawIndirectCommand (vertex count, instance count, first vertex, first instance) at the same stride.
+    struct DrawIndirectCommand {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t first;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
+
+    static_assert(sizeof(DrawIndirectCommand) == 20);
+
+    // Opens a named GPU timing zone in front of batch, a null name closes the innermost open zone
+    struct ZoneMarker {
+        uint32_t batch;
+        const char* name;
+    };
+
+    // Externally owned memory the draw list is written into, e.g. a persistently mapped upload buffer
+    struct GeometryTarget {
+        Vertex* vertices = nullptr;
+        uint32_t vertexCapacity = 0;
+        uint32_t* indices = nullptr;
+        uint32_t indexCapacity = 0;
+        ShapeInstance* shapes = nullptr;
+        uint32_t shapeCapacity = 0;
+    };
+
+    class Renderer {
+    public:
+        Renderer() = default;
+
+        // Records into renderer owned storage that grows as needed
+        void begin();
+        // Records straight into the given memory, throws if the frame doesn't fit
+        void begin(const GeometryTarget& geometryTarget);
+        void end();
+
+        // GPU timing zone around the following primitives, the name has to outlive the frame (e.g. a string literal).
+        // Zone boundaries always split batches.
+        void beginZone(const char* name);
+        void endZone();
+
+        // Retained geometry. Returns true if the caller has to draw the scope's contents. Returns false if
+        // the scope was drawn with the same id and content hash before: its geometry has already been
+        // replayed from the cache, so the draw calls can be skipped. Either way endScope() has to follow.
+        // Scopes nest and split batches, GPU zones and clip rects inside a scope have to be closed inside it.
+        // A scope recorded under a different clip rect is drawn again.
+        bool beginScope(uint64_t id, uint64_t contentHash);
+        void endScope();
+
+        // True if the finished frame consists only of cache hits for the same scopes as the previous frame
+        [[nodiscard]] bool isUnchanged() const { return this->unchanged; }
+
+        // Shapes are no longer culled against the clip rect on the CPU, every one of them goes into the frame's
+        // geometry. For when a compute pass culls them before drawing, see writeDrawCommands.
+        void setGpuShapeCulling(bool enabled) { this->gpuShapeCulling = enabled; }
+
+        // Applies to all following primitives, changing it splits the batch
+        void setBlendMode(BlendMode mode) { this->blendMode = mode; }
+
+        // Restricts the following primitives to the rect, intersected with the current clip. Primitives that
+        // lie entirely outside are dropped before they reach the upload buffer, the rest is cut by the scissor.
+        // Only an actual change of the clip splits the batch.
+        void pushClipRect(glm::vec2 position, glm::vec2 size);
+        void popClipRect();
+        [[nodiscard]] const ClipRect& getClipRect() const { return this->clip; }
+
+        void drawRect(glm::vec2 position, glm::vec2 size, glm::vec4 color);
+        void drawLine(glm::vec2 from, glm::vec2 to, float thickness, glm::vec4 color);
+
+        // Long polylines are split into chunks that are culled and tessellated in parallel on the attached system.
+        // Each chunk writes into its own reserved range and gets its own batch, so the draw order is kept.
+        void setJobSystem(JobSystem* system) { this->jobSystem = system; }
+
+        // CPU tessellated geometry for what the SDF shapes can't express, e.g. charts and arbitrary outlines.
+        // Written straight into the frame's geometry, culled as a whole by the bounds of the points.
+        void drawPolyline(std::span<const glm::vec2> points, const StrokeStyle& style, glm::vec4 color);
+        void fillPolygon(std::span<const glm::vec2> points, glm::vec4 color);
+        // Every sub path on its own, the path's close() overrides the style's
+        void strokePath(const Path& path, const StrokeStyle& style, glm::vec4 color);
+        // Sub paths are filled separately, they can't cut holes into each other
+        void fillPath(const Path& path, glm::vec4 color);
+
+        // SDF shapes, one instance each instead of tessellated geometry.
+        // Corner radii are given as (top left, top right, bottom right, bottom left).
+        void drawShape(const ShapeInstance& shape);
+        void drawRoundedRect(glm::vec2 position, glm::vec2 size, float radius, glm::vec4 color);
+        void drawRoundedRect(glm::vec2 position, glm::vec2 size, glm::vec4 radii, glm::vec4 color);
+        void drawBorder(glm::vec2 position, glm::vec2 size, float radius, float thickness, glm::vec4 color);
+        void drawCircle(glm::vec2 center, float radius, glm::vec4 color);
+        // Blurred copy of a rounded rect, drawn before the shape it belongs to
+        void drawShadow(glm::vec2 position, glm::vec2 size, float radius, glm::vec2 offset, float blur, glm::vec4 color);
+        // Soft halo around a rounded rect, additive on top of whatever is below
+        void drawGlow(glm::vec2 position, glm::vec2 size, float radius, float spread, glm::vec4 color);
+
+        // Shows the placeholder until the texture is resident in the attached slots. Uvs are clamped to [0, 1].
+        void setTextureSlots(const TextureSlots* slots) { this->textureSlots = slots; }
+        void drawTexturedQuad(glm::vec2 position, glm::vec2 size, TextureHandle texture,
+                              glm::vec2 uvMin = {0.0f, 0.0f}, glm::vec2 uvMax = {1.0f, 1.0f},
+                              glm::vec4 tint = {1.0f, 1.0f, 1.0f, 1.0f});
+
+        // Text goes through the attached cache, position is the top left corner of the first line.
+        // Returns the size of the laid out text.
+        void setTextCache(TextCache* cache) { this->textCache = cache; }
+        glm::vec2 drawText(glm::vec2 position, std::string_view text, float size, glm::vec4 color, uint32_t font = 0);
+
+        [[nodiscard]] std::span<const Vertex> getVertices() const { return {this->target.vertices, this->vertexCount}; }
+        [[nodiscard]] std::span<const uint32_t> getIndices() const { return {this->target.indices, this->indexCount}; }
+        [[nodiscard]] std::span<const ShapeInstance> getShapes() const { return {this->target.shapes, this->shapeCount}; }
+        [[nodiscard]] const std::vector<DrawBatch>& getBatches() const { return this->batches; }
+        [[nodiscard]] const std::vector<ZoneMarker>& getZoneMarkers() const { return this->zoneMarkers; }
+
+        // One indirect draw per batch, in batch order. With culledShapes the shape batches' instance ranges are
+        // left empty, the culling pass fills in where their visible instances ended up. Throws if the commands
+        // don't fit.
+        void writeDrawCommands(std::span<DrawIndirectCommand> commands, bool culledShapes) const;
+
+    private:
+        GeometryTarget target;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        uint32_t shapeCount = 0;
+
+        std::vector<Vertex> ownedVertices;
+        std::vector<uint32_t> ownedIndices;
+        std::vector<ShapeInstance> ownedShapes;
+        bool ownsStorage = true;
+
+        std::vector<DrawBatch> batches;
+        std::vector<ZoneMarker> zoneMarkers;
+        uint32_t openZones = 0;
+        // Forces the next primitive into a new batch even if its state matches
+        bool splitBatch = false;
+
+        bool recording = false;
+        bool gpuShapeCulling = false;
+        BlendMode blendMode = BlendMode::eAlpha;
+
+        ClipRect clip;
+        std::vector<ClipRect> clipStack;
+
+        TextCache* textCache = nullptr;
+        const TextureSlots* textureSlots = nullptr;
+
+        Tessellator tessellator;
+
+        struct StrokeChunk {
+            uint32_t firstSegment;
+            uint32_t segmentCount;
+            // Start of the chunk's range, relative to the whole stroke's reservation
+            TessellationCount offset;
+            TessellationCount written;
+        };
+
+        // Below this many segments a polyline is cheaper to tessellate than to split
+        static constexpr uint32_t ParallelStrokeMinSegments = 16384;
+        static constexpr uint32_t StrokeChunkMinSegments = 4096;
+
+        JobSystem* jobSystem = nullptr;
+        // One per job system thread, they keep scratch memory
+        std::vector<Tessellator> chunkTessellators;
+        std::vector<StrokeChunk> strokeChunks;
+
+        struct ScopeCache {
+            uint64_t contentHash = 0;
+            // Culling and the batches' scissor depend on it
+            ClipRect clip;
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+            std::vector<ShapeInstance> shapes;
+            // Offsets relative to the start of the scope
+            std::vector<DrawBatch> batches;
+            std::vector<ZoneMarker> zoneMarkers;
+            // Cached text uvs are only valid while the atlas hasn't evicted anything
+            uint64_t atlasEpoch = 0;
+            uint32_t atlasPageMask = 0;
+            // Placeholders are only valid until another texture becomes resident
+            uint64_t textureEpoch = 0;
+            bool drewPlaceholder = false;
+            uint64_t lastUsed = 0;
+        };
+
+        struct OpenScope {
+            uint64_t id;
+            uint64_t contentHash;
+            // Where the scope starts, in the frame's streams
+            uint32_t vertex, index, shape, batch, zoneMarker, zoneDepth, clipDepth;
+            uint32_t parentVertexBase;
+            uint32_t atlasPageMask;
+            bool drewPlaceholder;
+            // Replayed from the cache, endScope only has to close it
+            bool hit;
+        };
+
+        // Frames a cached scope survives without being used
+        static constexpr uint64_t ScopeLifetime = 600;
+
+        std::unordered_map<uint64_t, ScopeCache> scopeCache;
+        std::vector<OpenScope> openScopes;
+        // Indices written from now on are relative to this vertex, see DrawBatch::vertexOffset
+        uint32_t vertexBase = 0;
+        uint32_t atlasPageMask = 0;
+        bool drewPlaceholder = false;
+
+        uint64_t frame = 0;
+        // Anything drawn this frame that didn't come from a cache hit
+        bool drewUncached = false;
+        bool unchanged = false;
+        std::vector<std::pair<uint64_t, uint64_t>> frameScopes;
+        std::vector<std::pair<uint64_t, uint64_t>> previousFrameScopes;
+
+        void replay(const ScopeCache& cache);
+
+        void grow(uint32_t requiredVertices, uint32_t requiredIndices, uint32_t requiredShapes);
+
+        // Reserves room for a primitive, merging it into the last batch when the state matches.
+        // Returns the index of the first reserved vertex.
+        uint32_t reserve(const DrawState& state, uint32_t primitiveVertices, uint32_t primitiveIndices);
+        // Gives back what the last reservation didn't use, for primitives that only know an upper bound
+        void unreserve(uint32_t vertices, uint32_t indices);
+        [[nodiscard]] bool isCulled(std::span<const glm::vec2> points, float margin) const;
+        void drawPolylineChunked(std::span<const glm::vec2> points, const StrokeStyle& style, glm::vec4 color, uint32_t segments);
+        void pushShape(const ShapeInstance& shape, BlendMode blend);
+        // True if the box spanned by the two corners, grown by margin, lies entirely outside the clip
+        [[nodiscard]] bool isCulled(glm::vec2 corner0, glm::vec2 corner1, float margin = 0.0f) const;
+        void pushIndices(std::initializer_list<uint32_t> values);
+        void pushQuad(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, glm::vec2 p3,
+                      glm::vec2 uvMin, glm::vec2 uvMax, Unorm8x4 color, const DrawState& state, uint32_t textureSlot = 0);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_RENDERER_HPP
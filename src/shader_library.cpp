@@ -0,0 +1,124 @@
+#include "shader_library.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef IMR_EMBED_SHADERS
+#include "embedded_shaders.hpp"
+#endif
+
+namespace imr {
+
+#ifdef IMR_SHADER_HOT_RELOAD
+    static std::filesystem::file_time_type sourceTime(std::string_view name) {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(std::filesystem::path(IMR_SHADER_SOURCE_DIR) / name, error);
+        return error ? std::filesystem::file_time_type::min() : time;
+    }
+#endif
+
+    ShaderLibrary::ShaderLibrary(const vk::raii::Device &device, std::filesystem::path spirvDir) :
+            device(&device), spirvDir(std::move(spirvDir)) {}
+
+    std::vector<uint32_t> ShaderLibrary::loadSpirv(const std::filesystem::path &path) const {
+        std::ifstream codeFile{path, std::ios::ate | std::ios::binary};
+        if (!codeFile.is_open()) throw std::runtime_error("Failed to open file: " + path.string());
+
+        auto fileSize = static_cast<size_t>(codeFile.tellg());
+        if (fileSize % sizeof(uint32_t) != 0) throw std::runtime_error("Invalid SPIR-V size: " + path.string());
+
+        std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+
+        codeFile.seekg(0);
+        codeFile.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(fileSize));
+
+        return code;
+    }
+
+    uint32_t ShaderLibrary::createModule(std::span<const uint32_t> code) {
+        // FNV-1a over the words plus the length, with a handful of shaders a 64 bit collision isn't a concern
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t word : code) {
+            hash ^= word;
+            hash *= 1099511628211ull;
+        }
+        hash ^= code.size() << 40;
+
+        auto it = this->modulesByHash.find(hash);
+        if (it != this->modulesByHash.end()) return it->second;
+
+        vk::ShaderModuleCreateInfo shaderInfo {
+                {},
+                code.size_bytes(),
+                code.data()
+        };
+
+        auto index = static_cast<uint32_t>(this->modules.size());
+        this->modules.push_back(this->device->createShaderModule(shaderInfo));
+        this->modulesByHash.emplace(hash, index);
+
+        return index;
+    }
+
+    vk::ShaderModule ShaderLibrary::get(std::string_view name) {
+        auto it = this->entries.find(name);
+        if (it != this->entries.end()) return *this->modules[it->second.module];
+
+        uint32_t module = UINT32_MAX;
+
+#ifdef IMR_EMBED_SHADERS
+        for (const auto& shader : embedded::shaders) {
+            if (shader.name == name) {
+                module = createModule(shader.code);
+                break;
+            }
+        }
+#endif
+
+        if (module == UINT32_MAX) {
+            module = createModule(loadSpirv(this->spirvDir / (std::string(name) + ".spv")));
+        }
+
+        Entry entry{module, {}};
+#ifdef IMR_SHADER_HOT_RELOAD
+        entry.sourceTime = sourceTime(name);
+#endif
+
+        this->entries.emplace(name, entry);
+        return *this->modules[module];
+    }
+
+    std::vector<std::string> ShaderLibrary::reloadChanged() {
+        std::vector<std::string> changed;
+
+#ifdef IMR_SHADER_HOT_RELOAD
+        for (auto& [name, entry] : this->entries) {
+            auto time = sourceTime(name);
+            if (time <= entry.sourceTime) continue;
+            entry.sourceTime = time;
+
+            auto source = std::filesystem::path(IMR_SHADER_SOURCE_DIR) / name;
+            auto output = std::filesystem::temp_directory_path() / (name + ".reload.spv");
+
+            std::string command = "\"" IMR_GLSLC "\" --target-env=vulkan1.2 \"" + source.string() + "\" -o \"" + output.string() + "\"";
+            if (std::system(command.c_str()) != 0) {
+                std::cerr << "Shader reload failed, keeping the previous " << name << "\n";
+                continue;
+            }
+
+            uint32_t module = createModule(loadSpirv(output));
+            std::filesystem::remove(output);
+
+            if (module != entry.module) {
+                entry.module = module;
+                changed.push_back(name);
+            }
+        }
+#endif
+
+        return changed;
+    }
+
+} // imr
@@ -0,0 +1,63 @@
+#ifndef VK_IMM_RENDERER_SHADER_LIBRARY_HPP
+#define VK_IMM_RENDERER_SHADER_LIBRARY_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+
+#include "vulkan/vulkan_raii.hpp"
+
+// Set by CMake to the build directory's shaders folder
+#ifndef IMR_SPIRV_DIR
+#define IMR_SPIRV_DIR "../shaders"
+#endif
+
+namespace imr {
+
+    // Shader modules by source file name, e.g. "simple_shader.vert". The SPIR-V comes from the arrays CMake
+    // embeds into the binary (IMR_EMBED_SHADERS) or from the .spv files in the build directory.
+    // Names with identical SPIR-V share one module.
+    class ShaderLibrary {
+    public:
+        ShaderLibrary() = default;
+        explicit ShaderLibrary(const vk::raii::Device& device, std::filesystem::path spirvDir = IMR_SPIRV_DIR);
+
+        vk::ShaderModule get(std::string_view name);
+
+        // Recompiles shaders whose source changed since they were loaded and returns their names.
+        // Only does anything in IMR_SHADER_HOT_RELOAD builds, a failed compile keeps the previous module.
+        std::vector<std::string> reloadChanged();
+
+        [[nodiscard]] size_t getModuleCount() const { return this->modules.size(); }
+
+    private:
+        struct Entry {
+            uint32_t module;
+            std::filesystem::file_time_type sourceTime;
+        };
+
+        // Transparent so get() doesn't build a std::string for the lookup
+        struct NameHash {
+            using is_transparent = void;
+            size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+        };
+
+        const vk::raii::Device* device = nullptr;
+        std::filesystem::path spirvDir;
+
+        std::unordered_map<std::string, Entry, NameHash, std::equal_to<>> entries;
+        // Replaced modules stay alive, pipelines created from them may still reference them
+        std::vector<vk::raii::ShaderModule> modules;
+        std::unordered_map<uint64_t, uint32_t> modulesByHash;
+
+        std::vector<uint32_t> loadSpirv(const std::filesystem::path& path) const;
+        uint32_t createModule(std::span<const uint32_t> code);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_SHADER_LIBRARY_HPP
@@ -0,0 +1,153 @@
+#include "shape_culler.hpp"
+
+#include <array>
+#include <algorithm>
+
+namespace imr {
+
+    ShapeCuller::ShapeCuller(const vk::raii::Device &device, DeviceMemoryAllocator &allocator, const PipelineManager &pipelineManager,
+                             vk::ShaderModule shader, const FrameRingConfig &config) :
+            device(&device), allocator(&allocator), shapeCapacity(config.shapeCapacity) {
+        // Input shapes, compacted shapes, draw commands, cull batches, group offsets
+        std::array<vk::DescriptorSetLayoutBinding, 5> bindings;
+        for (uint32_t i = 0; i < bindings.size(); i++) {
+            bindings[i] = {i, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute};
+        }
+
+        this->setLayout = device.createDescriptorSetLayout({{}, bindings});
+
+        vk::DescriptorPoolSize poolSize{vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(bindings.size()) * config.framesInFlight};
+        this->pool = device.createDescriptorPool({vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, config.framesInFlight, 1, &poolSize});
+
+        vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(PushConstants)};
+        vk::PipelineLayoutCreateInfo layoutInfo {
+                {}, 1, &*this->setLayout, 1, &pushConstantRange
+        };
+
+        this->pipelineLayout = device.createPipelineLayout(layoutInfo);
+        this->pipeline = pipelineManager.createComputePipeline(shader, *this->pipelineLayout);
+
+        std::vector<vk::DescriptorSetLayout> setLayouts(config.framesInFlight, *this->setLayout);
+        std::vector<vk::raii::DescriptorSet> sets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{*this->pool, setLayouts});
+
+        uint32_t groupCapacity = (config.shapeCapacity + GroupSize - 1) / GroupSize;
+
+        for (uint32_t i = 0; i < config.framesInFlight; i++) {
+            Slot slot;
+
+            // Written and read by the GPU only
+            slot.instanceBuffer = device.createBuffer({
+                    {},
+                    std::max<vk::DeviceSize>(static_cast<vk::DeviceSize>(config.shapeCapacity) * sizeof(ShapeInstance), 1),
+                    vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer,
+                    vk::SharingMode::eExclusive
+            });
+            slot.instanceMemory = allocator.bind(slot.instanceBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+            slot.groupBuffer = device.createBuffer({
+                    {},
+                    std::max<vk::DeviceSize>(static_cast<vk::DeviceSize>(groupCapacity) * sizeof(uint32_t), 4),
+                    vk::BufferUsageFlagBits::eStorageBuffer,
+                    vk::SharingMode::eExclusive
+            });
+            slot.groupMemory = allocator.bind(slot.groupBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+            slot.set = std::move(sets[i]);
+
+            this->slots.push_back(std::move(slot));
+        }
+    }
+
+    ShapeCuller::~ShapeCuller() {
+        for (auto& slot : this->slots) {
+            this->allocator->free(slot.instanceMemory);
+            this->allocator->free(slot.groupMemory);
+        }
+    }
+
+    bool ShapeCuller::record(const vk::raii::CommandBuffer &cmd, FrameSlot &frame, std::span<const DrawBatch> batches,
+                             uint32_t shapeCount, vk::Extent2D extent) {
+        if (shapeCount == 0) return true;
+        if (shapeCount > this->shapeCapacity) return false;
+
+        auto batchCount = static_cast<uint32_t>(std::ranges::count_if(batches, [](const DrawBatch& batch) {
+            return batch.state.pipeline == PipelineType::eShape;
+        }));
+
+        // 256 covers minStorageBufferOffsetAlignment on every device
+        auto table = frame.allocateTransient(static_cast<vk::DeviceSize>(batchCount) * sizeof(CullBatch), 256);
+        if (!table) return false;
+
+        // Sorted by first instance, the shader finds each instance's batch with a binary search. The clip is cut
+        // down to the framebuffer, so shapes outside of it are dropped even without a clip rect.
+        auto* cullBatches = static_cast<CullBatch*>(table->mapped);
+        auto width = static_cast<float>(extent.width);
+        auto height = static_cast<float>(extent.height);
+
+        uint32_t next = 0;
+        for (uint32_t i = 0; i < batches.size(); i++) {
+            const DrawBatch& batch = batches[i];
+            if (batch.state.pipeline != PipelineType::eShape) continue;
+
+            const ClipRect& clip = batch.state.clip;
+            cullBatches[next++] = {
+                    {std::clamp(clip.min.x, 0.0f, width), std::clamp(clip.min.y, 0.0f, height),
+                     std::clamp(clip.max.x, 0.0f, width), std::clamp(clip.max.y, 0.0f, height)},
+                    batch.firstInstance, batch.instanceCount, i, 0
+            };
+        }
+
+        Slot& slot = this->slots[frame.index];
+
+        // The slot's previous frame has finished, nothing pending uses the set anymore
+        std::array<vk::DescriptorBufferInfo, 5> bufferInfos = {{
+                {*frame.uploadBuffer, frame.shapeOffset, static_cast<vk::DeviceSize>(shapeCount) * sizeof(ShapeInstance)},
+                {*slot.instanceBuffer, 0, VK_WHOLE_SIZE},
+                {*frame.uploadBuffer, frame.drawCommandOffset, static_cast<vk::DeviceSize>(batches.size()) * sizeof(DrawIndirectCommand)},
+                {*frame.uploadBuffer, table->offset, static_cast<vk::DeviceSize>(batchCount) * sizeof(CullBatch)},
+                {*slot.groupBuffer, 0, VK_WHOLE_SIZE}
+        }};
+
+        std::array<vk::WriteDescriptorSet, 5> writes;
+        for (uint32_t i = 0; i < writes.size(); i++) {
+            writes[i] = {*slot.set, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[i]};
+        }
+        this->device->updateDescriptorSets(writes, nullptr);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *this->pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *this->pipelineLayout, 0, *slot.set, nullptr);
+
+        uint32_t groupCount = (shapeCount + GroupSize - 1) / GroupSize;
+        vk::MemoryBarrier phaseBarrier {
+                vk::AccessFlagBits::eShaderWrite,
+                vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+        };
+
+        // Count the visible instances per group, turn the counts into offsets, compact, then derive the instance
+        // counts. No atomics, so the result is the same every frame. The phases only differ in a few branches,
+        // one pipeline does all of them.
+        std::array<uint32_t, 4> phaseGroups = {groupCount, 1, groupCount, (batchCount + GroupSize - 1) / GroupSize};
+        for (uint32_t phase = 0; phase < phaseGroups.size(); phase++) {
+            if (phase > 0) {
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                    {}, phaseBarrier, nullptr, nullptr);
+            }
+
+            cmd.pushConstants<PushConstants>(*this->pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                             PushConstants{shapeCount, batchCount, phase, groupCount});
+            cmd.dispatch(phaseGroups[phase], 1, 1);
+        }
+
+        vk::MemoryBarrier drawBarrier {
+                vk::AccessFlagBits::eShaderWrite,
+                vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eVertexAttributeRead
+        };
+
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                            vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+                            {}, drawBarrier, nullptr, nullptr);
+
+        return true;
+    }
+
+} // imr
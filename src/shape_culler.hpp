@@ -0,0 +1,82 @@
+#ifndef VK_IMM_RENDERER_SHAPE_CULLER_HPP
+#define VK_IMM_RENDERER_SHAPE_CULLER_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "renderer.hpp"
+#include "frame_ring.hpp"
+#include "memory_allocator.hpp"
+#include "pipeline_manager.hpp"
+
+namespace imr {
+
+    // Culls the frame's shape instances against their batch's clip rect on the GPU, before the main pass.
+    // The visible ones are compacted into a per slot buffer in their original order, so blending comes out
+    // the same, and the shape batches' indirect draws are rewritten to cover just them. The Renderer has to
+    // write the draw commands with culledShapes for it, see Renderer::writeDrawCommands.
+    class ShapeCuller {
+    public:
+        static constexpr uint32_t GroupSize = 256;
+
+        ShapeCuller(const vk::raii::Device& device, DeviceMemoryAllocator& allocator, const PipelineManager& pipelineManager,
+                    vk::ShaderModule shader, const FrameRingConfig& config);
+        ~ShapeCuller();
+
+        ShapeCuller(const ShapeCuller&) = delete;
+        ShapeCuller& operator=(const ShapeCuller&) = delete;
+
+        // Recorded outside the render pass, after the slot's draw commands were written. Leaves the compacted
+        // instances ready for the vertex input and the commands for the indirect draws. Returns false if
+        // nothing was recorded because the batch table didn't fit into the slot's transient memory, the shapes
+        // then have to be drawn from the upload buffer with the unculled commands.
+        bool record(const vk::raii::CommandBuffer& cmd, FrameSlot& frame, std::span<const DrawBatch> batches,
+                    uint32_t shapeCount, vk::Extent2D extent);
+
+        // Bound to the shape binding at offset 0 instead of the upload buffer's shapes
+        [[nodiscard]] vk::Buffer getInstanceBuffer(uint32_t frameSlot) const { return *this->slots[frameSlot].instanceBuffer; }
+
+    private:
+        // std430 layout, see cull_shapes.comp
+        struct CullBatch {
+            glm::vec4 clip;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            uint32_t command;
+            uint32_t padding;
+        };
+
+        struct PushConstants {
+            uint32_t shapeCount;
+            uint32_t batchCount;
+            uint32_t phase;
+            uint32_t groupCount;
+        };
+
+        struct Slot {
+            vk::raii::Buffer instanceBuffer{VK_NULL_HANDLE};
+            MemoryAllocation instanceMemory;
+            // Visible instances per workgroup, turned into each group's output offset in place
+            vk::raii::Buffer groupBuffer{VK_NULL_HANDLE};
+            MemoryAllocation groupMemory;
+            vk::raii::DescriptorSet set{VK_NULL_HANDLE};
+        };
+
+        const vk::raii::Device* device = nullptr;
+        DeviceMemoryAllocator* allocator = nullptr;
+        uint32_t shapeCapacity = 0;
+
+        vk::raii::DescriptorSetLayout setLayout{VK_NULL_HANDLE};
+        vk::raii::DescriptorPool pool{VK_NULL_HANDLE};
+        vk::raii::PipelineLayout pipelineLayout{VK_NULL_HANDLE};
+        vk::raii::Pipeline pipeline{VK_NULL_HANDLE};
+
+        std::vector<Slot> slots;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_SHAPE_CULLER_HPP
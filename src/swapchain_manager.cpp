@@ -0,0 +1,161 @@
+#include "swapchain_manager.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    SwapchainManager::SwapchainManager(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice,
+                                       const vk::raii::SurfaceKHR &surface, SwapchainSettings settings, vk::Extent2D framebufferExtent) :
+            device(&device), physicalDevice(&physicalDevice), surface(&surface), settings(std::move(settings)) {
+
+        this->colorFormat = this->settings.surfaceFormat.format;
+        this->supportedPresentModes = physicalDevice.getSurfacePresentModesKHR(*surface);
+        this->presentMode = choosePresentMode();
+
+        auto capabilities = physicalDevice.getSurfaceCapabilitiesKHR(*surface);
+        this->extent = chooseExtent(capabilities, framebufferExtent);
+        if (this->extent.width == 0 || this->extent.height == 0) throw std::runtime_error("Window surface has no area");
+
+        createSwapchain(capabilities, VK_NULL_HANDLE);
+        createImageViews();
+    }
+
+    SwapchainManager::SwapchainManager(const vk::raii::Device &device, std::vector<vk::Image> images, vk::Format colorFormat, vk::Extent2D extent) :
+            device(&device), colorFormat(colorFormat), extent(extent) {
+
+        this->targets.images = std::move(images);
+
+        createImageViews();
+    }
+
+    bool SwapchainManager::recreate(vk::Extent2D framebufferExtent, DeletionQueue &deletionQueue, uint64_t retireFrame) {
+        if (!this->surface) throw std::runtime_error("Headless targets can't be recreated");
+
+        auto capabilities = this->physicalDevice->getSurfaceCapabilitiesKHR(**this->surface);
+        vk::Extent2D newExtent = chooseExtent(capabilities, framebufferExtent);
+        if (newExtent.width == 0 || newExtent.height == 0) return false;
+
+        // Frames still in flight keep using the old set until they retire
+        Targets old = std::move(this->targets);
+        this->targets = {};
+        this->extent = newExtent;
+
+        createSwapchain(capabilities, *old.swapchain);
+        createImageViews();
+
+        // Views before the swapchain that owns their images
+        deletionQueue.retire(retireFrame, [old = std::move(old)]() mutable {
+            old.imageViews.clear();
+            old.swapchain = nullptr;
+        });
+
+        return true;
+    }
+
+    uint32_t SwapchainManager::getPresentQueueDepth(uint32_t framesInFlight) const {
+        if (!this->surface) return 0;
+
+        switch (this->presentMode) {
+            case vk::PresentModeKHR::eImmediate:
+                return 0;
+            case vk::PresentModeKHR::eMailbox:
+                // Only ever the newest frame waits for the next vblank
+                return 1;
+            default:
+                // FIFO queues every frame, bounded by the images and by how far the CPU may run ahead
+                return std::min(getImageCount() - 1, framesInFlight);
+        }
+    }
+
+    vk::PresentModeKHR SwapchainManager::choosePresentMode() const {
+        std::vector<vk::PresentModeKHR> preferred;
+        switch (this->settings.latencyPolicy) {
+            case LatencyPolicy::eLowLatency:
+                preferred = {vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate};
+                break;
+            case LatencyPolicy::eVsync:
+                break;
+            case LatencyPolicy::eThroughput:
+                preferred = {vk::PresentModeKHR::eFifoRelaxed};
+                break;
+        }
+
+        for (auto mode : preferred) {
+            if (std::ranges::find(this->supportedPresentModes, mode) != this->supportedPresentModes.end()) return mode;
+        }
+
+        // The only mode every implementation has to support
+        return vk::PresentModeKHR::eFifo;
+    }
+
+    uint32_t SwapchainManager::chooseImageCount(const vk::SurfaceCapabilitiesKHR &capabilities) const {
+        uint32_t imageCount = std::max(capabilities.minImageCount, 2u);
+
+        // Mailbox needs a spare image to swap a newer frame in, the throughput policy one to render ahead into
+        if (this->presentMode == vk::PresentModeKHR::eMailbox || this->settings.latencyPolicy == LatencyPolicy::eThroughput) {
+            imageCount = std::max(capabilities.minImageCount + 1, 3u);
+        }
+
+        if (capabilities.maxImageCount != 0) imageCount = std::min(imageCount, capabilities.maxImageCount);
+        return imageCount;
+    }
+
+    vk::Extent2D SwapchainManager::chooseExtent(const vk::SurfaceCapabilitiesKHR &capabilities, vk::Extent2D framebufferExtent) const {
+        // Most platforms dictate the size, the special value leaves it to the framebuffer
+        if (capabilities.currentExtent.width != UINT32_MAX) return capabilities.currentExtent;
+
+        return {
+            std::clamp(framebufferExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width),
+            std::clamp(framebufferExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height)
+        };
+    }
+
+    void SwapchainManager::createSwapchain(const vk::SurfaceCapabilitiesKHR &capabilities, vk::SwapchainKHR oldSwapchain) {
+        uint32_t imageCount = chooseImageCount(capabilities);
+
+        bool concurrent = this->settings.queueFamilyIndices.size() > 1 && this->settings.queueFamilyIndices[0] != this->settings.queueFamilyIndices[1];
+
+        vk::SwapchainCreateInfoKHR swapchainCreateInfo {
+                {},
+                **this->surface,
+                imageCount,
+                this->settings.surfaceFormat.format,
+                this->settings.surfaceFormat.colorSpace,
+                this->extent,
+                1,
+                vk::ImageUsageFlagBits::eColorAttachment,
+                concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+                static_cast<uint32_t>(this->settings.queueFamilyIndices.size()),
+                this->settings.queueFamilyIndices.data(),
+                capabilities.currentTransform,
+                vk::CompositeAlphaFlagBitsKHR::eOpaque,
+                this->presentMode,
+                VK_TRUE,
+                oldSwapchain
+        };
+
+        this->targets.swapchain = this->device->createSwapchainKHR(swapchainCreateInfo);
+
+        for (auto image : this->targets.swapchain.getImages()) {
+            this->targets.images.emplace_back(image);
+        }
+    }
+
+    void SwapchainManager::createImageViews() {
+        vk::ImageViewCreateInfo viewCreateInfo {
+                {},
+                {},
+                vk::ImageViewType::e2D,
+                this->colorFormat,
+                {},
+                {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+        };
+
+        for (auto image : this->targets.images) {
+            viewCreateInfo.image = image;
+            this->targets.imageViews.push_back(this->device->createImageView(viewCreateInfo));
+        }
+    }
+
+} // imr
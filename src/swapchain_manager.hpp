@@ -0,0 +1,82 @@
+#ifndef VK_IMM_RENDERER_SWAPCHAIN_MANAGER_HPP
+#define VK_IMM_RENDERER_SWAPCHAIN_MANAGER_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "deletion_queue.hpp"
+
+namespace imr {
+
+    // Picks the present mode and image count, falling back to FIFO where the preferred modes aren't supported
+    enum class LatencyPolicy : uint8_t {
+        // Mailbox, else immediate, with a spare image so a newer frame can replace a queued one
+        eLowLatency,
+        // Plain FIFO with as few images as possible, lowest power
+        eVsync,
+        // FIFO relaxed with an extra image, the GPU rarely waits for the display and late frames tear instead of stalling
+        eThroughput
+    };
+
+    struct SwapchainSettings {
+        vk::SurfaceFormatKHR surfaceFormat;
+        LatencyPolicy latencyPolicy = LatencyPolicy::eVsync;
+        // Graphics and present family, the images are shared concurrently when they differ
+        std::vector<uint32_t> queueFamilyIndices;
+    };
+
+    // The swapchain and its image views. Depth buffers and framebuffers come from the frame graph.
+    // Headless it wraps externally owned images instead, those never change size.
+    class SwapchainManager {
+    public:
+        SwapchainManager() = default;
+        SwapchainManager(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice,
+                         const vk::raii::SurfaceKHR& surface, SwapchainSettings settings, vk::Extent2D framebufferExtent);
+        SwapchainManager(const vk::raii::Device& device, std::vector<vk::Image> images, vk::Format colorFormat, vk::Extent2D extent);
+
+        // Builds a new swapchain from the old one for the current surface size. The previous swapchain and
+        // views are retired at retireFrame instead of waiting for the device.
+        // Returns false if the surface has no area (minimized window), the old swapchain stays in place then.
+        bool recreate(vk::Extent2D framebufferExtent, DeletionQueue& deletionQueue, uint64_t retireFrame);
+
+        [[nodiscard]] const vk::raii::SwapchainKHR& getSwapchain() const { return this->targets.swapchain; }
+        [[nodiscard]] vk::Extent2D getExtent() const { return this->extent; }
+        [[nodiscard]] vk::Format getColorFormat() const { return this->colorFormat; }
+        [[nodiscard]] vk::PresentModeKHR getPresentMode() const { return this->presentMode; }
+        // Images the presentation engine may show before a newly presented one, estimated from the present mode
+        [[nodiscard]] uint32_t getPresentQueueDepth(uint32_t framesInFlight) const;
+        [[nodiscard]] uint32_t getImageCount() const { return static_cast<uint32_t>(this->targets.images.size()); }
+        [[nodiscard]] vk::Image getImage(uint32_t imageIndex) const { return this->targets.images[imageIndex]; }
+        [[nodiscard]] vk::ImageView getImageView(uint32_t imageIndex) const { return *this->targets.imageViews[imageIndex]; }
+
+    private:
+        struct Targets {
+            vk::raii::SwapchainKHR swapchain{VK_NULL_HANDLE};
+            std::vector<vk::Image> images;
+            std::vector<vk::raii::ImageView> imageViews;
+        };
+
+        const vk::raii::Device* device = nullptr;
+        const vk::raii::PhysicalDevice* physicalDevice = nullptr;
+        const vk::raii::SurfaceKHR* surface = nullptr;
+
+        SwapchainSettings settings;
+        vk::Format colorFormat = vk::Format::eUndefined;
+        vk::Extent2D extent;
+        std::vector<vk::PresentModeKHR> supportedPresentModes;
+        vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+
+        Targets targets;
+
+        [[nodiscard]] vk::PresentModeKHR choosePresentMode() const;
+        [[nodiscard]] uint32_t chooseImageCount(const vk::SurfaceCapabilitiesKHR& capabilities) const;
+        [[nodiscard]] vk::Extent2D chooseExtent(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Extent2D framebufferExtent) const;
+        void createSwapchain(const vk::SurfaceCapabilitiesKHR& capabilities, vk::SwapchainKHR oldSwapchain);
+        void createImageViews();
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_SWAPCHAIN_MANAGER_HPP
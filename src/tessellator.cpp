@@ -0,0 +1,521 @@
+#include "tessellator.hpp"
+#include "renderer.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IMR_TESSELLATOR_AVX2
+#define IMR_TESSELLATOR_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMR_TESSELLATOR_SSE2
+#endif
+
+namespace imr {
+
+    // The SIMD path writes position, uv and color with one store, then the texture
+    static_assert(offsetof(Vertex, uv) == offsetof(Vertex, position) + 2 * sizeof(float));
+    static_assert(offsetof(Vertex, color) == offsetof(Vertex, uv) + sizeof(Unorm16x2));
+    static_assert(sizeof(Unorm16x2) == 4 && sizeof(Unorm8x4) == 4);
+
+    namespace {
+        // Max distance between a round join or cap and its polygon, in pixels
+        constexpr float RoundTolerance = 0.25f;
+        constexpr uint32_t MaxRoundSegments = 64;
+
+        // Segments of a half circle
+        uint32_t getRoundSegments(float radius) {
+            if (radius <= RoundTolerance) return 2;
+
+            float step = 2.0f * std::acos(1.0f - RoundTolerance / radius);
+            return std::clamp(static_cast<uint32_t>(std::ceil(std::numbers::pi_v<float> / step)), 2u, MaxRoundSegments);
+        }
+
+        float cross(glm::vec2 a, glm::vec2 b) {
+            return a.x * b.y - a.y * b.x;
+        }
+
+        glm::vec2 rotate(glm::vec2 v, float cosine, float sine) {
+            return {v.x * cosine - v.y * sine, v.x * sine + v.y * cosine};
+        }
+
+        // Appends behind the segment quads
+        struct Writer {
+            const TessellationTarget& target;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+
+            uint32_t addVertex(glm::vec2 position) {
+                this->target.vertices[this->vertexCount] = {position, {}, this->target.color, 0};
+                return this->vertexCount++;
+            }
+
+            void addTriangle(uint32_t a, uint32_t b, uint32_t c) {
+                uint32_t* i = this->target.indices + this->indexCount;
+                i[0] = this->target.baseIndex + a;
+                i[1] = this->target.baseIndex + b;
+                i[2] = this->target.baseIndex + c;
+                this->indexCount += 3;
+            }
+
+            // Fan around center from `from` to `to`, turning by angle (counterclockwise in a y up frame when positive)
+            void addArc(glm::vec2 center, uint32_t centerIndex, glm::vec2 offset, uint32_t from, uint32_t to, float angle, uint32_t steps) {
+                float cosine = std::cos(angle / static_cast<float>(steps));
+                float sine = std::sin(angle / static_cast<float>(steps));
+
+                uint32_t previous = from;
+                for (uint32_t step = 1; step < steps; step++) {
+                    offset = rotate(offset, cosine, sine);
+                    uint32_t current = addVertex(center + offset);
+                    addTriangle(centerIndex, previous, current);
+                    previous = current;
+                }
+                addTriangle(centerIndex, previous, to);
+            }
+        };
+    }
+
+    void Path::moveTo(glm::vec2 point) {
+        this->subPaths.push_back({static_cast<uint32_t>(this->points.size()), 1, false});
+        this->points.push_back(point);
+    }
+
+    void Path::lineTo(glm::vec2 point) {
+        if (this->subPaths.empty() || this->subPaths.back().closed) throw std::runtime_error("Path::lineTo without moveTo");
+
+        this->points.push_back(point);
+        this->subPaths.back().count++;
+    }
+
+    void Path::quadraticTo(glm::vec2 control, glm::vec2 point) {
+        if (this->subPaths.empty() || this->subPaths.back().closed) throw std::runtime_error("Path::quadraticTo without moveTo");
+
+        // The flattening error of n uniform steps is bounded by |p0 - 2c + p1| / (4n²)
+        glm::vec2 start = this->points.back();
+        glm::vec2 dd = start - 2.0f * control + point;
+        float deviation = std::sqrt(dd.x * dd.x + dd.y * dd.y);
+        auto steps = std::clamp(static_cast<uint32_t>(std::ceil(std::sqrt(deviation / (4.0f * this->tolerance)))), 1u, 256u);
+
+        for (uint32_t step = 1; step <= steps; step++) {
+            float t = static_cast<float>(step) / static_cast<float>(steps);
+            float u = 1.0f - t;
+            lineTo(u * u * start + 2.0f * u * t * control + t * t * point);
+        }
+    }
+
+    void Path::cubicTo(glm::vec2 control0, glm::vec2 control1, glm::vec2 point) {
+        if (this->subPaths.empty() || this->subPaths.back().closed) throw std::runtime_error("Path::cubicTo without moveTo");
+
+        // Same bound with the second derivative, which is at most 6 times the larger second difference
+        glm::vec2 start = this->points.back();
+        glm::vec2 dd0 = start - 2.0f * control0 + control1;
+        glm::vec2 dd1 = control0 - 2.0f * control1 + point;
+        float deviation = std::sqrt(std::max(dd0.x * dd0.x + dd0.y * dd0.y, dd1.x * dd1.x + dd1.y * dd1.y));
+        auto steps = std::clamp(static_cast<uint32_t>(std::ceil(std::sqrt(0.75f * deviation / this->tolerance))), 1u, 256u);
+
+        for (uint32_t step = 1; step <= steps; step++) {
+            float t = static_cast<float>(step) / static_cast<float>(steps);
+            float u = 1.0f - t;
+            lineTo(u * u * u * start + 3.0f * u * u * t * control0 + 3.0f * u * t * t * control1 + t * t * t * point);
+        }
+    }
+
+    void Path::close() {
+        if (this->subPaths.empty()) throw std::runtime_error("Path::close without moveTo");
+
+        this->subPaths.back().closed = true;
+    }
+
+    void Path::clear() {
+        this->points.clear();
+        this->subPaths.clear();
+    }
+
+    TessellationCount Tessellator::getStrokeBound(uint32_t pointCount, const StrokeStyle &style) {
+        return getStrokeSectionBound(pointCount, style, 0, getSegmentCount(pointCount, style));
+    }
+
+    TessellationCount Tessellator::getStrokeSectionBound(uint32_t pointCount, const StrokeStyle &style, uint32_t firstSegment, uint32_t segmentCount) {
+        uint32_t segments = getSegmentCount(pointCount, style);
+        if (segmentCount == 0 || firstSegment + segmentCount > segments) return {0, 0};
+
+        // A join in front of every segment but the first of an open stroke
+        uint32_t joins = segmentCount - (firstSegment == 0 && !style.closed ? 1 : 0);
+        // The join in front of the section copies the corner of a segment outside of it
+        uint32_t borrowedCorners = firstSegment > 0 || (style.closed && segmentCount < segments) ? 1 : 0;
+        uint32_t caps = style.closed ? 0 : (firstSegment == 0 ? 1 : 0) + (firstSegment + segmentCount == segments ? 1 : 0);
+        uint32_t round = getRoundSegments(style.width * 0.5f);
+
+        TessellationCount join{};
+        switch (style.join) {
+            case LineJoin::eMiter: join = {2, 6}; break;
+            case LineJoin::eBevel: join = {1, 3}; break;
+            case LineJoin::eRound: join = {round, 3 * round}; break;
+        }
+        TessellationCount cap = style.cap == LineCap::eRound ? TessellationCount{round, 3 * round} : TessellationCount{0, 0};
+
+        return {segmentCount * 4 + joins * join.vertices + borrowedCorners + caps * cap.vertices,
+                segmentCount * 6 + joins * join.indices + caps * cap.indices};
+    }
+
+    uint32_t Tessellator::getSegmentCount(uint32_t pointCount, const StrokeStyle &style) {
+        if (pointCount < 2) return 0;
+
+        return style.closed ? pointCount : pointCount - 1;
+    }
+
+    TessellationCount Tessellator::getFillBound(uint32_t pointCount) {
+        if (pointCount < 3) return {0, 0};
+
+        return {pointCount, (pointCount - 2) * 3};
+    }
+
+    TessellationCount Tessellator::stroke(std::span<const glm::vec2> points, const StrokeStyle &style, const TessellationTarget &target) {
+        return strokeSection(points, style, 0, getSegmentCount(static_cast<uint32_t>(points.size()), style), target);
+    }
+
+    TessellationCount Tessellator::strokeSection(std::span<const glm::vec2> points, const StrokeStyle &style,
+                                                 uint32_t firstSegment, uint32_t segmentCount, const TessellationTarget &target) {
+        auto pointCount = static_cast<uint32_t>(points.size());
+        uint32_t segments = getSegmentCount(pointCount, style);
+        if (segmentCount == 0 || firstSegment + segmentCount > segments) return {0, 0};
+
+        float halfWidth = style.width * 0.5f;
+        float halfWidthSq = halfWidth * halfWidth;
+        uint32_t endSegment = firstSegment + segmentCount;
+        // Segments between two adjacent points, the closing one goes from the last point back to the first
+        uint32_t openSegments = std::min(endSegment, pointCount - 1) - firstSegment;
+
+        if (this->normals.size() < segmentCount) this->normals.resize(segmentCount);
+        glm::vec2* n = this->normals.data();
+
+        computeNormals(points.data() + firstSegment, openSegments, halfWidth, n);
+        emitSegments(points.data() + firstSegment, n, openSegments, target);
+
+        if (openSegments < segmentCount) {
+            glm::vec2 closing[2] = {points.back(), points.front()};
+            computeNormals(closing, 1, halfWidth, n + openSegments);
+
+            TessellationTarget closingTarget = target;
+            closingTarget.vertices += openSegments * 4;
+            closingTarget.indices += openSegments * 6;
+            closingTarget.baseIndex += openSegments * 4;
+            emitSegments(closing, n + openSegments, 1, closingTarget);
+        }
+
+        // Joins and caps branch on the turn, they stay scalar
+        Writer writer{target, segmentCount * 4, segmentCount * 6};
+        uint32_t roundSegments = getRoundSegments(halfWidth);
+
+        auto join = [&](uint32_t incoming, uint32_t outgoing) {
+            bool incomingInside = incoming >= firstSegment && incoming < endSegment;
+            glm::vec2 n1 = n[outgoing - firstSegment];
+            glm::vec2 n0 = n1;
+            if (incomingInside) {
+                n0 = n[incoming - firstSegment];
+            } else {
+                glm::vec2 ends[2] = {points[incoming], points[outgoing]};
+                computeNormals(ends, 1, halfWidth, &n0);
+            }
+
+            // Zero length segments have no direction to join
+            if (n0 == glm::vec2(0.0f) || n1 == glm::vec2(0.0f)) return;
+
+            float turn = cross(n0, n1);
+            float dot = n0.x * n1.x + n0.y * n1.y;
+            if (std::abs(turn) <= 1e-6f * halfWidthSq && dot > 0.0f) return;
+
+            // The gap opens on the outside of the turn, the inside is covered by the overlapping quads
+            bool plusOutside = turn <= 0.0f;
+            glm::vec2 center = points[outgoing];
+            uint32_t corner0 = incomingInside ? (incoming - firstSegment) * 4 + (plusOutside ? 1 : 2) :
+                               writer.addVertex(center + (plusOutside ? n0 : -n0));
+            uint32_t corner1 = (outgoing - firstSegment) * 4 + (plusOutside ? 0 : 3);
+
+            switch (style.join) {
+                case LineJoin::eMiter: {
+                    float denominator = halfWidthSq + dot;
+                    if (denominator > 1e-6f * halfWidthSq) {
+                        glm::vec2 offset = (n0 + n1) * (halfWidthSq / denominator);
+                        if (!plusOutside) offset = -offset;
+
+                        float limit = style.miterLimit * halfWidth;
+                        if (offset.x * offset.x + offset.y * offset.y <= limit * limit) {
+                            uint32_t centerIndex = writer.addVertex(center);
+                            uint32_t tip = writer.addVertex(center + offset);
+                            writer.addTriangle(centerIndex, corner0, tip);
+                            writer.addTriangle(centerIndex, tip, corner1);
+                            break;
+                        }
+                    }
+                    writer.addTriangle(writer.addVertex(center), corner0, corner1);
+                    break;
+                }
+                case LineJoin::eBevel:
+                    writer.addTriangle(writer.addVertex(center), corner0, corner1);
+                    break;
+                case LineJoin::eRound: {
+                    float angle = std::acos(std::clamp(dot / halfWidthSq, -1.0f, 1.0f));
+                    float maxStep = std::numbers::pi_v<float> / static_cast<float>(roundSegments);
+                    uint32_t steps = std::clamp(static_cast<uint32_t>(std::ceil(angle / maxStep)), 1u, roundSegments);
+
+                    writer.addArc(center, writer.addVertex(center), plusOutside ? n0 : -n0, corner0, corner1,
+                                  turn > 0.0f ? angle : -angle, steps);
+                    break;
+                }
+            }
+        };
+
+        // The join in front of each segment, the first segment of an open stroke has none
+        for (uint32_t s = firstSegment; s < endSegment; s++) {
+            if (s > 0) join(s - 1, s);
+            else if (style.closed) join(segments - 1, 0);
+        }
+        if (style.closed) return {writer.vertexCount, writer.indexCount};
+
+        // Caps of the first and last segment, if they are part of the section
+        uint32_t last = endSegment == segments ? segmentCount - 1 : UINT32_MAX;
+        glm::vec2 firstNormal = firstSegment == 0 ? n[0] : glm::vec2(0.0f);
+        glm::vec2 lastNormal = last != UINT32_MAX ? n[last] : glm::vec2(0.0f);
+
+        if (style.cap == LineCap::eSquare) {
+            // Pushes the end corners out by half the width, rotating the normal gives the direction
+            if (firstSegment == 0) {
+                glm::vec2 back(-firstNormal.y, firstNormal.x);
+                target.vertices[0].position = points.front() + firstNormal + back;
+                target.vertices[3].position = points.front() - firstNormal + back;
+            }
+            if (last != UINT32_MAX) {
+                glm::vec2 forward(lastNormal.y, -lastNormal.x);
+                target.vertices[last * 4 + 1].position = points.back() + lastNormal + forward;
+                target.vertices[last * 4 + 2].position = points.back() - lastNormal + forward;
+            }
+        } else if (style.cap == LineCap::eRound) {
+            // Half circles around the back of the first and the front of the last segment
+            if (firstNormal != glm::vec2(0.0f)) {
+                writer.addArc(points.front(), writer.addVertex(points.front()), firstNormal, 0, 3, std::numbers::pi_v<float>, roundSegments);
+            }
+            if (lastNormal != glm::vec2(0.0f)) {
+                writer.addArc(points.back(), writer.addVertex(points.back()), -lastNormal, last * 4 + 2, last * 4 + 1, std::numbers::pi_v<float>, roundSegments);
+            }
+        }
+
+        return {writer.vertexCount, writer.indexCount};
+    }
+
+    TessellationCount Tessellator::fill(std::span<const glm::vec2> points, const TessellationTarget &target) {
+        auto pointCount = static_cast<uint32_t>(points.size());
+        if (pointCount < 3) return {0, 0};
+
+        Writer writer{target, 0, 0};
+        for (glm::vec2 point : points) writer.addVertex(point);
+
+        bool leftTurns = false, rightTurns = false;
+        float area = 0.0f;
+        for (uint32_t i = 0; i < pointCount; i++) {
+            glm::vec2 a = points[i == 0 ? pointCount - 1 : i - 1];
+            glm::vec2 b = points[i];
+            glm::vec2 c = points[i + 1 == pointCount ? 0 : i + 1];
+
+            float turn = cross(b - a, c - b);
+            leftTurns = leftTurns || turn > 0.0f;
+            rightTurns = rightTurns || turn < 0.0f;
+            area += cross(a, b);
+        }
+
+        if (!leftTurns || !rightTurns) {
+            for (uint32_t i = 1; i + 1 < pointCount; i++) writer.addTriangle(0, i, i + 1);
+            return {writer.vertexCount, writer.indexCount};
+        }
+
+        // Ear clipping, quadratic in the point count
+        float orientation = area > 0.0f ? 1.0f : -1.0f;
+        this->next.resize(pointCount);
+        this->prev.resize(pointCount);
+        for (uint32_t i = 0; i < pointCount; i++) {
+            this->next[i] = i + 1 == pointCount ? 0 : i + 1;
+            this->prev[i] = i == 0 ? pointCount - 1 : i - 1;
+        }
+
+        auto isEar = [&](uint32_t ia, uint32_t ib, uint32_t ic) {
+            glm::vec2 a = points[ia], b = points[ib], c = points[ic];
+            if (orientation * cross(b - a, c - b) <= 0.0f) return false;
+
+            // Points on the edges block the ear too, unless they coincide with its corners
+            for (uint32_t i = this->next[ic]; i != ia; i = this->next[i]) {
+                glm::vec2 p = points[i];
+                if (p == a || p == b || p == c) continue;
+                if (orientation * cross(b - a, p - a) >= 0.0f &&
+                    orientation * cross(c - b, p - b) >= 0.0f &&
+                    orientation * cross(a - c, p - c) >= 0.0f) return false;
+            }
+            return true;
+        };
+
+        uint32_t remaining = pointCount;
+        uint32_t current = 0;
+        uint32_t misses = 0;
+        while (remaining > 3) {
+            uint32_t a = this->prev[current];
+            uint32_t c = this->next[current];
+
+            // A full round without an ear only happens for degenerate outlines, clip anyway to terminate
+            if (isEar(a, current, c) || misses > remaining) {
+                writer.addTriangle(a, current, c);
+                this->next[a] = c;
+                this->prev[c] = a;
+                remaining--;
+                misses = 0;
+            } else {
+                misses++;
+            }
+            current = c;
+        }
+        writer.addTriangle(this->prev[current], current, this->next[current]);
+
+        return {writer.vertexCount, writer.indexCount};
+    }
+
+    const char *Tessellator::getSimdName() {
+#if defined(IMR_TESSELLATOR_AVX2)
+        return "AVX2";
+#elif defined(IMR_TESSELLATOR_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    void Tessellator::computeNormals(const glm::vec2 *points, uint32_t segmentCount, float halfWidth, glm::vec2 *out) const {
+        uint32_t s = 0;
+
+        // Segment s runs from points[s] to points[s + 1], the loads are split into x and y lanes.
+        // Zero length segments get a zero normal.
+        if (this->simd) {
+#if defined(IMR_TESSELLATOR_AVX2)
+            const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+            const __m256 halfWidth8 = _mm256_set1_ps(halfWidth);
+            const __m256 zero8 = _mm256_setzero_ps();
+
+            for (; s + 8 <= segmentCount; s += 8) {
+                const float* p = &points[s].x;
+                __m256 a0 = _mm256_loadu_ps(p), a1 = _mm256_loadu_ps(p + 8);
+                __m256 b0 = _mm256_loadu_ps(p + 2), b1 = _mm256_loadu_ps(p + 10);
+
+                // The in lane shuffle leaves the 128 bit halves interleaved, the permute restores the order
+                __m256 ax = _mm256_permutevar8x32_ps(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)), order);
+                __m256 ay = _mm256_permutevar8x32_ps(_mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)), order);
+                __m256 bx = _mm256_permutevar8x32_ps(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)), order);
+                __m256 by = _mm256_permutevar8x32_ps(_mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)), order);
+
+                __m256 dx = _mm256_sub_ps(bx, ax);
+                __m256 dy = _mm256_sub_ps(by, ay);
+                __m256 lengthSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+                __m256 scale = _mm256_and_ps(_mm256_div_ps(halfWidth8, _mm256_sqrt_ps(lengthSq)),
+                                             _mm256_cmp_ps(lengthSq, zero8, _CMP_GT_OQ));
+
+                __m256 nx = _mm256_mul_ps(_mm256_sub_ps(zero8, dy), scale);
+                __m256 ny = _mm256_mul_ps(dx, scale);
+
+                __m256 low = _mm256_unpacklo_ps(nx, ny);
+                __m256 high = _mm256_unpackhi_ps(nx, ny);
+                _mm256_storeu_ps(&out[s].x, _mm256_permute2f128_ps(low, high, 0x20));
+                _mm256_storeu_ps(&out[s + 4].x, _mm256_permute2f128_ps(low, high, 0x31));
+            }
+#endif
+#if defined(IMR_TESSELLATOR_SSE2)
+            const __m128 halfWidth4 = _mm_set1_ps(halfWidth);
+            const __m128 zero4 = _mm_setzero_ps();
+
+            for (; s + 4 <= segmentCount; s += 4) {
+                const float* p = &points[s].x;
+                __m128 a0 = _mm_loadu_ps(p), a1 = _mm_loadu_ps(p + 4);
+                __m128 b0 = _mm_loadu_ps(p + 2), b1 = _mm_loadu_ps(p + 6);
+
+                __m128 ax = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 ay = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+                __m128 bx = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 by = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+
+                __m128 dx = _mm_sub_ps(bx, ax);
+                __m128 dy = _mm_sub_ps(by, ay);
+                __m128 lengthSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+                __m128 scale = _mm_and_ps(_mm_div_ps(halfWidth4, _mm_sqrt_ps(lengthSq)), _mm_cmpgt_ps(lengthSq, zero4));
+
+                __m128 nx = _mm_mul_ps(_mm_sub_ps(zero4, dy), scale);
+                __m128 ny = _mm_mul_ps(dx, scale);
+
+                _mm_storeu_ps(&out[s].x, _mm_unpacklo_ps(nx, ny));
+                _mm_storeu_ps(&out[s + 2].x, _mm_unpackhi_ps(nx, ny));
+            }
+#endif
+        }
+
+        for (; s < segmentCount; s++) {
+            glm::vec2 d = points[s + 1] - points[s];
+            float lengthSq = d.x * d.x + d.y * d.y;
+            float scale = lengthSq > 0.0f ? halfWidth / std::sqrt(lengthSq) : 0.0f;
+            out[s] = {-d.y * scale, d.x * scale};
+        }
+    }
+
+    void Tessellator::emitSegments(const glm::vec2 *points, const glm::vec2 *segmentNormals, uint32_t segmentCount,
+                                   const TessellationTarget &target) const {
+        // One quad per segment: start + n, end + n, end - n, start - n.
+        // Written front to back, the target may be write combined memory.
+        Vertex* v = target.vertices;
+        uint32_t* i = target.indices;
+        uint32_t s = 0;
+
+        if (this->simd) {
+#if defined(IMR_TESSELLATOR_SSE2)
+            // Zero uv and the color, behind the two floats of a position
+            const __m128 tail = _mm_castsi128_ps(_mm_setr_epi32(0, static_cast<int>(target.color.rgba), 0, 0));
+            const __m128i step = _mm_set1_epi32(4);
+            __m128i quadIndices = _mm_add_epi32(_mm_setr_epi32(0, 1, 2, 2), _mm_set1_epi32(static_cast<int>(target.baseIndex)));
+            __m128i tailIndices = _mm_add_epi32(_mm_setr_epi32(3, 0, 0, 0), _mm_set1_epi32(static_cast<int>(target.baseIndex)));
+
+            for (; s < segmentCount; s++, v += 4, i += 6) {
+                // Start and end of a segment are adjacent, one load gets both and one add offsets both
+                __m128 ends = _mm_loadu_ps(&points[s].x);
+                __m128 normal = _mm_castpd_ps(_mm_load1_pd(reinterpret_cast<const double*>(&segmentNormals[s])));
+                __m128 plus = _mm_add_ps(ends, normal);
+                __m128 minus = _mm_sub_ps(ends, normal);
+
+                _mm_storeu_ps(&v[0].position.x, _mm_movelh_ps(plus, tail));
+                v[0].texture = 0;
+                _mm_storeu_ps(&v[1].position.x, _mm_shuffle_ps(plus, tail, _MM_SHUFFLE(1, 0, 3, 2)));
+                v[1].texture = 0;
+                _mm_storeu_ps(&v[2].position.x, _mm_shuffle_ps(minus, tail, _MM_SHUFFLE(1, 0, 3, 2)));
+                v[2].texture = 0;
+                _mm_storeu_ps(&v[3].position.x, _mm_movelh_ps(minus, tail));
+                v[3].texture = 0;
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(i), quadIndices);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(i + 4), tailIndices);
+                quadIndices = _mm_add_epi32(quadIndices, step);
+                tailIndices = _mm_add_epi32(tailIndices, step);
+            }
+#endif
+        }
+
+        for (; s < segmentCount; s++, v += 4, i += 6) {
+            glm::vec2 a = points[s], b = points[s + 1], n = segmentNormals[s];
+            uint32_t base = target.baseIndex + s * 4;
+
+            v[0] = {a + n, {}, target.color, 0};
+            v[1] = {b + n, {}, target.color, 0};
+            v[2] = {b - n, {}, target.color, 0};
+            v[3] = {a - n, {}, target.color, 0};
+
+            i[0] = base; i[1] = base + 1; i[2] = base + 2;
+            i[3] = base + 2; i[4] = base + 3; i[5] = base;
+        }
+    }
+
+} // imr
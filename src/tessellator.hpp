@@ -0,0 +1,123 @@
+#ifndef VK_IMM_RENDERER_TESSELLATOR_HPP
+#define VK_IMM_RENDERER_TESSELLATOR_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "vertex_format.hpp"
+
+namespace imr {
+
+    struct Vertex;
+
+    enum class LineJoin : uint8_t {
+        eMiter,
+        eBevel,
+        eRound
+    };
+
+    enum class LineCap : uint8_t {
+        eButt,
+        eSquare,
+        eRound
+    };
+
+    struct StrokeStyle {
+        float width = 1.0f;
+        LineJoin join = LineJoin::eMiter;
+        LineCap cap = LineCap::eButt;
+        // Miters reaching further than miterLimit * width / 2 from their point are beveled
+        float miterLimit = 4.0f;
+        // Joins the last point back to the first, caps are ignored then
+        bool closed = false;
+    };
+
+    // Outline made of line segments, curves are flattened as they are added
+    class Path {
+    public:
+        struct SubPath {
+            uint32_t first;
+            uint32_t count;
+            bool closed;
+        };
+
+        void moveTo(glm::vec2 point);
+        void lineTo(glm::vec2 point);
+        void quadraticTo(glm::vec2 control, glm::vec2 point);
+        void cubicTo(glm::vec2 control0, glm::vec2 control1, glm::vec2 point);
+        void close();
+        void clear();
+
+        // Max distance between a curve and its segments, applies to the curves added afterwards
+        void setTolerance(float tolerance) { this->tolerance = tolerance; }
+
+        [[nodiscard]] const std::vector<glm::vec2>& getPoints() const { return this->points; }
+        [[nodiscard]] const std::vector<SubPath>& getSubPaths() const { return this->subPaths; }
+
+    private:
+        std::vector<glm::vec2> points;
+        std::vector<SubPath> subPaths;
+        float tolerance = 0.25f;
+    };
+
+    // Where the tessellation is written, e.g. the frame's upload buffer
+    struct TessellationTarget {
+        Vertex* vertices;
+        uint32_t* indices;
+        // Index of vertices[0]
+        uint32_t baseIndex;
+        Unorm8x4 color;
+    };
+
+    struct TessellationCount {
+        uint32_t vertices;
+        uint32_t indices;
+    };
+
+    // Expands polylines into stroke geometry and triangulates polygons, solid colored. The segment loops
+    // are vectorized with AVX2 or SSE2, whichever the build targets. Keeps its scratch memory between calls.
+    class Tessellator {
+    public:
+        // The scalar path is the baseline the SIMD one is measured against
+        explicit Tessellator(bool simd = true) : simd(simd) {}
+
+        // Upper bounds to reserve the output with, the calls below return what they actually wrote
+        [[nodiscard]] static TessellationCount getStrokeBound(uint32_t pointCount, const StrokeStyle& style);
+        [[nodiscard]] static TessellationCount getStrokeSectionBound(uint32_t pointCount, const StrokeStyle& style,
+                                                                     uint32_t firstSegment, uint32_t segmentCount);
+        [[nodiscard]] static TessellationCount getFillBound(uint32_t pointCount);
+
+        // Segment i runs from point i to i + 1, a closed stroke has one more back to the first point
+        [[nodiscard]] static uint32_t getSegmentCount(uint32_t pointCount, const StrokeStyle& style);
+
+        TessellationCount stroke(std::span<const glm::vec2> points, const StrokeStyle& style, const TessellationTarget& target);
+        // A range of the stroke's segments with the joins in front of them and the caps that fall into it. Sections
+        // don't reference each other's vertices, so the sections of one stroke can be tessellated in parallel.
+        TessellationCount strokeSection(std::span<const glm::vec2> points, const StrokeStyle& style,
+                                        uint32_t firstSegment, uint32_t segmentCount, const TessellationTarget& target);
+        // Convex polygons become a fan, concave ones are ear clipped. Self intersecting outlines aren't supported.
+        TessellationCount fill(std::span<const glm::vec2> points, const TessellationTarget& target);
+
+        // Instruction set the SIMD path was compiled for
+        [[nodiscard]] static const char* getSimdName();
+
+    private:
+        bool simd;
+
+        // Per segment, scaled to half the stroke width
+        std::vector<glm::vec2> normals;
+        // Ear clipping's linked list of the remaining polygon
+        std::vector<uint32_t> next;
+        std::vector<uint32_t> prev;
+
+        void computeNormals(const glm::vec2* points, uint32_t segmentCount, float halfWidth, glm::vec2* out) const;
+        void emitSegments(const glm::vec2* points, const glm::vec2* segmentNormals, uint32_t segmentCount,
+                          const TessellationTarget& target) const;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_TESSELLATOR_HPP
@@ -0,0 +1,135 @@
+#include "text_cache.hpp"
+
+#include <bit>
+#include <stdexcept>
+
+namespace imr {
+
+    // Decodes one UTF-8 sequence and advances, malformed input becomes U+FFFD
+    static uint32_t decodeUtf8(std::string_view text, size_t& i) {
+        auto byte = [&](size_t at) { return static_cast<uint8_t>(text[at]); };
+
+        uint8_t lead = byte(i++);
+        if (lead < 0x80) return lead;
+
+        // Continuation bytes can't lead, 0xF8 and up would be longer than 4 bytes
+        uint32_t length = lead >= 0xF8 ? 0 : lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+        if (length == 0 || i + length > text.size()) return 0xFFFD;
+
+        uint32_t codepoint = lead & (0x3F >> length);
+        for (uint32_t n = 0; n < length; n++) {
+            uint8_t continuation = byte(i);
+            if ((continuation & 0xC0) != 0x80) return 0xFFFD;
+
+            codepoint = (codepoint << 6) | (continuation & 0x3F);
+            i++;
+        }
+
+        // Overlong forms, UTF-16 surrogates and anything past the last plane
+        constexpr uint32_t MinCodepoint[] = {0, 0x80, 0x800, 0x10000};
+        if (codepoint < MinCodepoint[length] || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF) return 0xFFFD;
+
+        return codepoint;
+    }
+
+    size_t TextCache::RunKeyHash::operator()(const RunKeyView &key) const {
+        size_t hash = std::hash<std::string_view>{}(key.text);
+        hash ^= (static_cast<size_t>(key.font) << 32 | std::bit_cast<uint32_t>(key.size)) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+
+    TextCache::TextCache(uint32_t atlasSize) : atlas(atlasSize, atlasSize) {
+        addFont(BitmapFont::builtin());
+    }
+
+    FontHandle TextCache::addFont(const BitmapFont &font) {
+        this->fonts.push_back(&font);
+        return static_cast<FontHandle>(this->fonts.size() - 1);
+    }
+
+    void TextCache::beginFrame(uint64_t frame) {
+        this->frame = frame;
+        this->atlas.beginFrame(frame);
+
+        // Sweeping touches every run, once in a while is enough
+        if (frame % 64 == 0) {
+            std::erase_if(this->runs, [frame](const auto& entry) { return entry.second.lastUsed + RunLifetime < frame; });
+        }
+    }
+
+    void TextCache::layout(TextRun &run, std::string_view text, const BitmapFont &font, float size) const {
+        run.scale = font.getScale(size);
+
+        auto advance = static_cast<float>(font.cellWidth * run.scale);
+        auto lineHeight = static_cast<float>(font.cellHeight * run.scale);
+
+        glm::vec2 pen(0.0f, 0.0f);
+        for (size_t i = 0; i < text.size();) {
+            uint32_t codepoint = decodeUtf8(text, i);
+
+            if (codepoint == '\n') {
+                pen = {0.0f, pen.y + lineHeight};
+                continue;
+            }
+
+            if (codepoint != ' ') run.glyphs.push_back({codepoint, pen});
+            pen.x += advance;
+            run.size = {std::max(run.size.x, pen.x), pen.y + lineHeight};
+        }
+    }
+
+    void TextCache::resolve(TextRun &run, FontHandle font) {
+        const BitmapFont& bitmapFont = *this->fonts[font];
+        glm::vec2 glyphSize(static_cast<float>(bitmapFont.cellWidth * run.scale), static_cast<float>(bitmapFont.cellHeight * run.scale));
+
+        run.quads.clear();
+        run.pageMask = 0;
+        bool complete = true;
+
+        for (const auto& glyph : run.glyphs) {
+            uint32_t codepoint = bitmapFont.contains(glyph.codepoint) ? glyph.codepoint : bitmapFont.fallbackCodepoint;
+            GlyphKey key{font, codepoint, run.scale};
+
+            const AtlasGlyph* atlasGlyph = this->atlas.find(key);
+            if (!atlasGlyph) {
+                // Blank glyphs are not worth atlas space, they just never get a quad
+                if (!bitmapFont.rasterize(codepoint, run.scale, this->rasterScratch)) continue;
+
+                atlasGlyph = this->atlas.insert(key, bitmapFont.cellWidth * run.scale, bitmapFont.cellHeight * run.scale, this->rasterScratch);
+                if (!atlasGlyph) {
+                    complete = false;
+                    continue;
+                }
+            }
+
+            run.quads.push_back({glyph.position, glyph.position + glyphSize, atlasGlyph->uvMin, atlasGlyph->uvMax});
+            run.pageMask |= 1u << atlasGlyph->page;
+        }
+
+        // Evictions never hit pages used this frame, so the quads stay valid even if inserting evicted something.
+        // A run with missing glyphs tries again next time.
+        run.atlasEpoch = complete ? this->atlas.getEpoch() : UINT64_MAX;
+    }
+
+    const TextRun &TextCache::getRun(std::string_view text, FontHandle font, float size) {
+        if (font >= this->fonts.size()) throw std::runtime_error("Unknown font handle");
+
+        auto it = this->runs.find(RunKeyView{text, font, size});
+        if (it == this->runs.end()) {
+            it = this->runs.try_emplace(RunKey{std::string(text), font, size}).first;
+            layout(it->second, text, *this->fonts[font], size);
+        }
+
+        TextRun& run = it->second;
+        run.lastUsed = this->frame;
+
+        if (run.atlasEpoch != this->atlas.getEpoch()) {
+            resolve(run, font);
+        } else {
+            this->atlas.touchPages(run.pageMask);
+        }
+
+        return run;
+    }
+
+} // imr
@@ -0,0 +1,110 @@
+#ifndef VK_IMM_RENDERER_TEXT_CACHE_HPP
+#define VK_IMM_RENDERER_TEXT_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "bitmap_font.hpp"
+#include "glyph_atlas.hpp"
+
+namespace imr {
+
+    using FontHandle = uint32_t;
+    // BitmapFont::builtin(), always registered
+    constexpr FontHandle DefaultFont = 0;
+
+    struct GlyphQuad {
+        glm::vec2 min;
+        glm::vec2 max;
+        glm::vec2 uvMin;
+        glm::vec2 uvMax;
+    };
+
+    // A laid out string. Positions are relative to the top left of the first line.
+    struct TextRun {
+        struct Glyph {
+            uint32_t codepoint;
+            glm::vec2 position;
+        };
+
+        std::vector<Glyph> glyphs;
+        glm::vec2 size{0.0f, 0.0f};
+        uint32_t scale = 1;
+
+        // Resolved against the atlas, only glyphs that have pixels and made it into the atlas
+        std::vector<GlyphQuad> quads;
+        uint64_t atlasEpoch = UINT64_MAX;
+        uint32_t pageMask = 0;
+
+        uint64_t lastUsed = 0;
+    };
+
+    // Lays out strings once and keeps the result, so a label drawn every frame only costs a hash lookup
+    // and a copy of its quads. Runs not drawn for a while are dropped.
+    class TextCache {
+    public:
+        explicit TextCache(uint32_t atlasSize = 1024);
+
+        FontHandle addFont(const BitmapFont& font);
+
+        void beginFrame(uint64_t frame);
+
+        // Quads are valid until the next call, glyphs missing from the atlas are left out
+        const TextRun& getRun(std::string_view text, FontHandle font, float size);
+
+        [[nodiscard]] GlyphAtlas& getAtlas() { return this->atlas; }
+        [[nodiscard]] size_t getRunCount() const { return this->runs.size(); }
+
+    private:
+        struct RunKey {
+            std::string text;
+            FontHandle font;
+            float size;
+        };
+
+        struct RunKeyView {
+            std::string_view text;
+            FontHandle font;
+            float size;
+        };
+
+        struct RunKeyHash {
+            using is_transparent = void;
+            size_t operator()(const RunKeyView& key) const;
+            size_t operator()(const RunKey& key) const { return (*this)(RunKeyView{key.text, key.font, key.size}); }
+        };
+
+        struct RunKeyEqual {
+            using is_transparent = void;
+            static RunKeyView view(const RunKey& key) { return {key.text, key.font, key.size}; }
+            static RunKeyView view(const RunKeyView& key) { return key; }
+
+            template<typename A, typename B>
+            bool operator()(const A& a, const B& b) const {
+                RunKeyView x = view(a), y = view(b);
+                return x.text == y.text && x.font == y.font && x.size == y.size;
+            }
+        };
+
+        // Frames a run survives without being drawn
+        static constexpr uint64_t RunLifetime = 240;
+
+        GlyphAtlas atlas;
+        std::vector<const BitmapFont*> fonts;
+        std::unordered_map<RunKey, TextRun, RunKeyHash, RunKeyEqual> runs;
+        std::vector<uint8_t> rasterScratch;
+
+        uint64_t frame = 0;
+
+        void layout(TextRun& run, std::string_view text, const BitmapFont& font, float size) const;
+        void resolve(TextRun& run, FontHandle font);
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_TEXT_CACHE_HPP
@@ -0,0 +1,42 @@
+#ifndef VK_IMM_RENDERER_TEXTURE_SLOTS_HPP
+#define VK_IMM_RENDERER_TEXTURE_SLOTS_HPP
+
+#include <vector>
+#include <cstdint>
+
+namespace imr {
+
+    using TextureHandle = uint32_t;
+    constexpr TextureHandle NullTexture = 0;
+
+    // Fixed slots of the bindless texture table, the ones after them are handed out to loaded textures
+    constexpr uint32_t GlyphAtlasSlot = 0;
+    constexpr uint32_t PlaceholderSlot = 1;
+    constexpr uint32_t ReservedTextureSlots = 2;
+
+    // Which table slot the shaders sample for each texture handle. Vertices store the slot, not the handle,
+    // so a texture that becomes resident gets a fresh slot and frames still in flight keep their placeholder.
+    class TextureSlots {
+    public:
+        // Handles that were never assigned, NullTexture included, resolve to the placeholder
+        [[nodiscard]] uint32_t get(TextureHandle texture) const {
+            return texture < this->slots.size() ? this->slots[texture] : PlaceholderSlot;
+        }
+
+        void assign(TextureHandle texture, uint32_t slot) {
+            if (texture >= this->slots.size()) this->slots.resize(texture + 1, PlaceholderSlot);
+            this->slots[texture] = slot;
+            this->epoch++;
+        }
+
+        // Changes whenever a handle starts resolving to another slot
+        [[nodiscard]] uint64_t getEpoch() const { return this->epoch; }
+
+    private:
+        std::vector<uint32_t> slots;
+        uint64_t epoch = 0;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_TEXTURE_SLOTS_HPP
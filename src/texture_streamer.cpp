@@ -0,0 +1,396 @@
+#include "texture_streamer.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    TextureStreamer::TextureStreamer(const vk::raii::Device &device, DeviceMemoryAllocator &allocator,
+                                     const vk::raii::Queue &transferQueue, uint32_t transferQueueFamily, uint32_t graphicsQueueFamily,
+                                     TextureTable &table, const TextureStreamerConfig &config) :
+            device(&device), allocator(&allocator), transferQueue(&transferQueue),
+            transferQueueFamily(transferQueueFamily), graphicsQueueFamily(graphicsQueueFamily),
+            table(&table), config(config) {
+
+        vk::SamplerCreateInfo samplerInfo {
+                {},
+                vk::Filter::eLinear, vk::Filter::eLinear,
+                vk::SamplerMipmapMode::eNearest,
+                vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge
+        };
+
+        this->sampler = device.createSampler(samplerInfo);
+
+        this->commandPool = device.createCommandPool({vk::CommandPoolCreateFlagBits::eResetCommandBuffer, transferQueueFamily});
+
+        vk::SemaphoreTypeCreateInfo timelineInfo{vk::SemaphoreType::eTimeline, 0};
+        this->timeline = device.createSemaphore({{}, &timelineInfo});
+
+        vk::BufferCreateInfo bufferInfo {
+                {},
+                config.stagingBytes,
+                vk::BufferUsageFlagBits::eTransferSrc,
+                vk::SharingMode::eExclusive
+        };
+
+        this->stagingBuffer = device.createBuffer(bufferInfo);
+        this->stagingMemory = allocator.bind(this->stagingBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+        // Uploaded right away and waited for, every other texture falls back to it
+        constexpr uint32_t PlaceholderSize = 8;
+        this->textures.emplace_back();
+
+        std::unique_lock lock(this->mutex);
+        StagedRows* rows = reserve({}, lock, {Placeholder, PlaceholderSize, PlaceholderSize, 0, PlaceholderSize, 0, 0, false, false},
+                                   PlaceholderSize * PlaceholderSize * 4);
+
+        auto* texel = static_cast<uint8_t*>(this->stagingMemory.mapped) + rows->offset;
+        for (uint32_t y = 0; y < PlaceholderSize; y++) {
+            for (uint32_t x = 0; x < PlaceholderSize; x++, texel += 4) {
+                uint8_t value = ((x / 4 + y / 4) % 2) ? 96 : 160;
+                texel[0] = texel[1] = texel[2] = value;
+                texel[3] = 255;
+            }
+        }
+        rows->ready = true;
+        lock.unlock();
+
+        update();
+        vk::SemaphoreWaitInfo waitInfo{{}, 1, &*this->timeline, &this->submittedTicket};
+        if (device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to wait for the placeholder texture upload");
+        }
+        update();
+
+        for (uint32_t i = 0; i < config.workerThreads; i++) {
+            this->workers.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+    }
+
+    TextureStreamer::~TextureStreamer() {
+        // Joined before anything they use goes away
+        this->workers.clear();
+
+        vk::SemaphoreWaitInfo waitInfo{{}, 1, &*this->timeline, &this->submittedTicket};
+        (void) this->device->waitSemaphores(waitInfo, UINT64_MAX);
+
+        for (auto& texture : this->textures) {
+            if (texture.imageMemory) this->allocator->free(texture.imageMemory);
+        }
+        this->allocator->free(this->stagingMemory);
+    }
+
+    TextureHandle TextureStreamer::load(std::filesystem::path path) {
+        return enqueue({0, std::move(path), {}});
+    }
+
+    TextureHandle TextureStreamer::load(ImageData image) {
+        return enqueue({0, std::nullopt, std::move(image)});
+    }
+
+    TextureHandle TextureStreamer::enqueue(Job job) {
+        if (this->textures.size() >= this->config.maxTextures) throw std::runtime_error("Too many textures");
+
+        this->textures.emplace_back();
+        job.texture = static_cast<TextureHandle>(this->textures.size());
+
+        {
+            std::scoped_lock lock(this->mutex);
+            this->jobs.push_back(std::move(job));
+        }
+        this->jobAvailable.notify_one();
+
+        return static_cast<TextureHandle>(this->textures.size());
+    }
+
+    void TextureStreamer::work(std::stop_token stop) {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock lock(this->mutex);
+                if (!this->jobAvailable.wait(lock, stop, [this] { return !this->jobs.empty(); })) return;
+
+                job = std::move(this->jobs.front());
+                this->jobs.pop_front();
+            }
+
+            std::optional<ImageData> image;
+            if (job.path) {
+                image = loadImage(*job.path);
+                if (!image) std::cerr << "Failed to load texture " << job.path->string() << '\n';
+            } else if (job.image.width > 0 && job.image.height > 0 &&
+                       job.image.pixels.size() == static_cast<size_t>(job.image.width) * job.image.height * 4) {
+                image = std::move(job.image);
+            }
+
+            if (!image) {
+                std::unique_lock lock(this->mutex);
+                if (StagedRows* rows = reserve(stop, lock, {job.texture, 0, 0, 0, 0, 0, 0, false, true}, 0)) rows->ready = true;
+                continue;
+            }
+
+            stage(stop, job.texture, *image);
+        }
+    }
+
+    void TextureStreamer::stage(std::stop_token stop, TextureHandle texture, const ImageData &image) {
+        vk::DeviceSize rowBytes = static_cast<vk::DeviceSize>(image.width) * 4;
+        // Slices of at most a quarter of the ring, so one huge image can't hold back everything else
+        auto sliceRows = static_cast<uint32_t>(std::clamp<vk::DeviceSize>(this->config.stagingBytes / 4 / rowBytes, 1, image.height));
+
+        if (rowBytes > this->config.stagingBytes / 4) {
+            std::cerr << "Texture rows don't fit into the staging ring\n";
+
+            std::unique_lock lock(this->mutex);
+            if (StagedRows* rows = reserve(stop, lock, {texture, 0, 0, 0, 0, 0, 0, false, true}, 0)) rows->ready = true;
+            return;
+        }
+
+        for (uint32_t firstRow = 0; firstRow < image.height; firstRow += sliceRows) {
+            uint32_t rowCount = std::min(sliceRows, image.height - firstRow);
+
+            std::unique_lock lock(this->mutex);
+            StagedRows* rows = reserve(stop, lock, {texture, image.width, image.height, firstRow, rowCount, 0, 0, false, false}, rowCount * rowBytes);
+            if (!rows) return;
+            lock.unlock();
+
+            // Written without the lock, the slice can't be submitted before it is marked ready
+            std::memcpy(static_cast<uint8_t*>(this->stagingMemory.mapped) + rows->offset,
+                        image.pixels.data() + firstRow * rowBytes,
+                        rowCount * rowBytes);
+
+            lock.lock();
+            rows->ready = true;
+        }
+    }
+
+    TextureStreamer::StagedRows *TextureStreamer::reserve(std::stop_token stop, std::unique_lock<std::mutex> &lock, StagedRows rows, vk::DeviceSize size) {
+        vk::DeviceSize capacity = this->config.stagingBytes;
+        // Keeps every slice aligned for the texel size and the copy offset rules
+        size = (size + 15) & ~vk::DeviceSize{15};
+
+        uint64_t start = 0;
+        auto fits = [&] {
+            start = this->ringHead;
+            // A slice never wraps, the rest of the ring is skipped instead
+            if (start % capacity + size > capacity) start += capacity - start % capacity;
+            return start + size - this->ringTail <= capacity;
+        };
+
+        if (!this->ringSpace.wait(lock, stop, fits)) return nullptr;
+
+        this->ringHead = start + size;
+        rows.offset = start % capacity;
+        rows.ringEnd = this->ringHead;
+
+        this->staged.push_back(rows);
+        return &this->staged.back();
+    }
+
+    void TextureStreamer::update() {
+        // Submissions finish in order, everything up to the counter has retired
+        uint64_t completed = this->timeline.getCounterValue();
+        while (!this->inFlight.empty() && this->inFlight.front().ticket <= completed) {
+            Submission& submission = this->inFlight.front();
+
+            for (TextureHandle handle : submission.completed) {
+                this->textures[handle - 1].state = TextureState::eUploaded;
+                this->pendingAcquires.push_back(handle);
+            }
+            this->completedTicket = submission.ticket;
+
+            {
+                std::scoped_lock lock(this->mutex);
+                this->ringTail = submission.ringEnd;
+            }
+            this->ringSpace.notify_all();
+
+            this->freeContexts.push_back(std::move(submission.context));
+            this->inFlight.pop_front();
+        }
+
+        // Only the written prefix, a slice still being filled holds back everything after it
+        std::vector<StagedRows> slices;
+        {
+            std::scoped_lock lock(this->mutex);
+            while (!this->staged.empty() && this->staged.front().ready) {
+                slices.push_back(this->staged.front());
+                this->staged.pop_front();
+            }
+        }
+
+        if (slices.empty()) return;
+
+        UploadContext context = takeContext();
+        auto& cmd = context.commandBuffer;
+        cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+        vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+        bool ownershipTransfer = this->transferQueueFamily != this->graphicsQueueFamily;
+
+        std::vector<vk::ImageMemoryBarrier> toTransfer;
+        for (const auto& rows : slices) {
+            Texture& texture = this->textures[rows.texture - 1];
+            if (rows.failed || *texture.image) continue;
+
+            createImage(texture, rows.width, rows.height);
+            toTransfer.push_back({
+                    {}, vk::AccessFlagBits::eTransferWrite,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                    *texture.image, range
+            });
+        }
+
+        if (!toTransfer.empty()) {
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+        }
+
+        Submission submission{++this->submittedTicket, slices.back().ringEnd, {}, {}};
+        std::vector<vk::ImageMemoryBarrier> toShader;
+
+        for (const auto& rows : slices) {
+            Texture& texture = this->textures[rows.texture - 1];
+            if (rows.failed) {
+                texture.state = TextureState::eFailed;
+                continue;
+            }
+
+            vk::BufferImageCopy region {
+                    rows.offset, 0, 0,
+                    {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                    {0, static_cast<int32_t>(rows.firstRow), 0},
+                    {rows.width, rows.rowCount, 1}
+            };
+
+            cmd.copyBufferToImage(*this->stagingBuffer, *texture.image, vk::ImageLayout::eTransferDstOptimal, region);
+
+            texture.rowsSubmitted += rows.rowCount;
+            if (texture.rowsSubmitted < texture.height) continue;
+
+            // With separate families this is the release half, recordAcquires() does the acquire
+            toShader.push_back({
+                    vk::AccessFlagBits::eTransferWrite,
+                    ownershipTransfer ? vk::AccessFlags{} : vk::AccessFlagBits::eShaderRead,
+                    vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                    ownershipTransfer ? this->transferQueueFamily : VK_QUEUE_FAMILY_IGNORED,
+                    ownershipTransfer ? this->graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED,
+                    *texture.image, range
+            });
+            submission.completed.push_back(rows.texture);
+        }
+
+        if (!toShader.empty()) {
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                ownershipTransfer ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eFragmentShader,
+                                {}, nullptr, nullptr, toShader);
+        }
+
+        cmd.end();
+
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{0, nullptr, 1, &submission.ticket};
+        vk::SubmitInfo submitInfo {
+                0, nullptr, nullptr,
+                1, &*cmd,
+                1, &*this->timeline,
+                &timelineInfo
+        };
+
+        this->transferQueue->submit(submitInfo);
+
+        submission.context = std::move(context);
+        this->inFlight.push_back(std::move(submission));
+    }
+
+    void TextureStreamer::recordAcquires(const vk::raii::CommandBuffer &cmd) {
+        this->acquireWait = 0;
+        if (this->pendingAcquires.empty()) return;
+
+        // Every pending texture is part of a retired submission
+        this->acquireWait = this->completedTicket;
+
+        if (this->transferQueueFamily != this->graphicsQueueFamily) {
+            vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+
+            std::vector<vk::ImageMemoryBarrier> acquires;
+            for (TextureHandle handle : this->pendingAcquires) {
+                acquires.push_back({
+                        {}, vk::AccessFlagBits::eShaderRead,
+                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                        this->transferQueueFamily, this->graphicsQueueFamily,
+                        *this->textures[handle - 1].image, range
+                });
+            }
+
+            // Starts at the stage the submit waits for the timeline at, so the transitions follow the wait
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, acquires);
+        }
+
+        // Fresh slots, no frame in flight can be sampling them yet. The placeholder's slot is only ever
+        // written here, before the first frame that draws with it.
+        for (TextureHandle handle : this->pendingAcquires) {
+            Texture& texture = this->textures[handle - 1];
+            texture.slot = handle == Placeholder ? PlaceholderSlot : this->table->allocate();
+            this->table->write(texture.slot, *this->sampler, *texture.view);
+            texture.state = TextureState::eResident;
+
+            if (handle != Placeholder) this->slots.assign(handle, texture.slot);
+        }
+        this->pendingAcquires.clear();
+    }
+
+    bool TextureStreamer::isResident(TextureHandle texture) const {
+        return texture != NullTexture && texture <= this->textures.size() && this->textures[texture - 1].state == TextureState::eResident;
+    }
+
+    void TextureStreamer::createImage(Texture &texture, uint32_t width, uint32_t height) {
+        texture.width = width;
+        texture.height = height;
+
+        vk::ImageCreateInfo imageInfo {
+                {},
+                vk::ImageType::e2D,
+                vk::Format::eR8G8B8A8Unorm,
+                vk::Extent3D(width, height, 1),
+                1, 1,
+                vk::SampleCountFlagBits::e1,
+                vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+                vk::SharingMode::eExclusive, 0, nullptr,
+                vk::ImageLayout::eUndefined
+        };
+
+        texture.image = this->device->createImage(imageInfo);
+        texture.imageMemory = this->allocator->bind(texture.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::ImageViewCreateInfo viewInfo {
+                {},
+                *texture.image,
+                vk::ImageViewType::e2D,
+                vk::Format::eR8G8B8A8Unorm,
+                {},
+                {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+        };
+
+        texture.view = this->device->createImageView(viewInfo);
+    }
+
+    TextureStreamer::UploadContext TextureStreamer::takeContext() {
+        if (!this->freeContexts.empty()) {
+            UploadContext context = std::move(this->freeContexts.back());
+            this->freeContexts.pop_back();
+            return context;
+        }
+
+        vk::CommandBufferAllocateInfo cmdAllocInfo {
+                *this->commandPool,
+                vk::CommandBufferLevel::ePrimary,
+                1
+        };
+
+        return {std::move(this->device->allocateCommandBuffers(cmdAllocInfo).front())};
+    }
+
+} // imr
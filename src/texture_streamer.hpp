@@ -0,0 +1,179 @@
+#ifndef VK_IMM_RENDERER_TEXTURE_STREAMER_HPP
+#define VK_IMM_RENDERER_TEXTURE_STREAMER_HPP
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <condition_variable>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "image_io.hpp"
+#include "texture_table.hpp"
+#include "texture_slots.hpp"
+#include "memory_allocator.hpp"
+
+namespace imr {
+
+    struct TextureStreamerConfig {
+        uint32_t workerThreads = 2;
+        // Images larger than a quarter of the ring are uploaded in several slices of rows
+        vk::DeviceSize stagingBytes = 32 << 20;
+        // Also sizes the bindless texture table
+        uint32_t maxTextures = 4096;
+    };
+
+    // Loads RGBA textures without ever stalling a frame. Worker threads decode the images and copy their rows into
+    // a staging ring, update() submits the copies to the transfer queue once per frame and only polls for their
+    // completion. When the transfer queue belongs to another family the image is released there and acquired by
+    // the graphics queue in recordAcquires(), which also gives it its slot in the texture table. Until then its
+    // handle resolves to the placeholder's slot. Every submission signals a timeline semaphore with its ticket,
+    // the graphics submit that carries the acquires waits for it, see getAcquireWait().
+    class TextureStreamer {
+    public:
+        TextureStreamer(const vk::raii::Device& device, DeviceMemoryAllocator& allocator,
+                        const vk::raii::Queue& transferQueue, uint32_t transferQueueFamily, uint32_t graphicsQueueFamily,
+                        TextureTable& table, const TextureStreamerConfig& config);
+
+        // The workers hold on to this
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        ~TextureStreamer();
+
+        // Returns right away, the texture shows the placeholder until it is resident.
+        // Textures that fail to load keep the placeholder.
+        TextureHandle load(std::filesystem::path path);
+        TextureHandle load(ImageData image);
+
+        // Once per frame on the main thread: retires finished transfers and submits the rows staged since
+        // the last call. Only polls the timeline semaphore, never waits on the GPU.
+        void update();
+        // Graphics queue half of the ownership transfers, has to be recorded outside a render pass before
+        // anything samples the textures. Draws recorded after this call resolve the textures to their own slots.
+        void recordAcquires(const vk::raii::CommandBuffer& cmd);
+
+        [[nodiscard]] bool isResident(TextureHandle texture) const;
+        // Textures finished uploading but not acquired yet, frames showing their placeholder are outdated
+        [[nodiscard]] bool hasPendingAcquires() const { return !this->pendingAcquires.empty(); }
+        [[nodiscard]] const TextureSlots& getSlots() const { return this->slots; }
+
+        // The graphics submit with the last recordAcquires() has to wait for the timeline to reach this value at
+        // the fragment shader stage. The uploads have already finished by then, the wait only orders the acquires
+        // after them. 0 if nothing was acquired.
+        [[nodiscard]] vk::Semaphore getTimeline() const { return *this->timeline; }
+        [[nodiscard]] uint64_t getAcquireWait() const { return this->acquireWait; }
+
+        // Transfers complete in submission order, everything up to this ticket has finished. Tickets are the
+        // values the timeline semaphore is signalled with.
+        [[nodiscard]] uint64_t getCompletedTicket() const { return this->completedTicket; }
+        [[nodiscard]] uint64_t getSubmittedTicket() const { return this->submittedTicket; }
+
+    private:
+        enum class TextureState : uint8_t {
+            eLoading,
+            // Copied, waiting for the graphics queue to acquire it
+            eUploaded,
+            eResident,
+            eFailed
+        };
+
+        struct Texture {
+            TextureState state = TextureState::eLoading;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t rowsSubmitted = 0;
+            uint32_t slot = PlaceholderSlot;
+
+            vk::raii::Image image{VK_NULL_HANDLE};
+            MemoryAllocation imageMemory;
+            vk::raii::ImageView view{VK_NULL_HANDLE};
+        };
+
+        struct Job {
+            TextureHandle texture;
+            std::optional<std::filesystem::path> path;
+            ImageData image;
+        };
+
+        // A slice of rows in the staging ring. Slices are queued in ring order when their space is reserved
+        // and only submitted once every slice before them has been written.
+        struct StagedRows {
+            TextureHandle texture;
+            uint32_t width, height;
+            uint32_t firstRow, rowCount;
+            vk::DeviceSize offset;
+            // Ring position after this slice, the ring is free up to here once its transfer finished
+            uint64_t ringEnd;
+            bool ready;
+            bool failed;
+        };
+
+        struct UploadContext {
+            vk::raii::CommandBuffer commandBuffer{VK_NULL_HANDLE};
+        };
+
+        struct Submission {
+            uint64_t ticket;
+            uint64_t ringEnd;
+            UploadContext context;
+            std::vector<TextureHandle> completed;
+        };
+
+        static constexpr TextureHandle Placeholder = 1;
+
+        const vk::raii::Device* device = nullptr;
+        DeviceMemoryAllocator* allocator = nullptr;
+        const vk::raii::Queue* transferQueue = nullptr;
+        uint32_t transferQueueFamily = 0;
+        uint32_t graphicsQueueFamily = 0;
+        TextureTable* table = nullptr;
+        TextureStreamerConfig config;
+
+        vk::raii::Sampler sampler{VK_NULL_HANDLE};
+        vk::raii::CommandPool commandPool{VK_NULL_HANDLE};
+        vk::raii::Semaphore timeline{VK_NULL_HANDLE};
+
+        // Main thread only, indexed by handle - 1
+        std::deque<Texture> textures;
+        TextureSlots slots;
+        std::vector<TextureHandle> pendingAcquires;
+        std::deque<Submission> inFlight;
+        std::vector<UploadContext> freeContexts;
+        uint64_t submittedTicket = 0;
+        uint64_t completedTicket = 0;
+        uint64_t acquireWait = 0;
+
+        vk::raii::Buffer stagingBuffer{VK_NULL_HANDLE};
+        MemoryAllocation stagingMemory;
+
+        // Shared with the workers
+        std::mutex mutex;
+        std::condition_variable_any jobAvailable;
+        std::condition_variable_any ringSpace;
+        std::deque<Job> jobs;
+        std::deque<StagedRows> staged;
+        // Monotonic byte positions, the ring offset is the position modulo its size
+        uint64_t ringHead = 0;
+        uint64_t ringTail = 0;
+
+        std::vector<std::jthread> workers;
+
+        TextureHandle enqueue(Job job);
+        void work(std::stop_token stop);
+        void stage(std::stop_token stop, TextureHandle texture, const ImageData& image);
+        // Queues a slice and reserves its ring space, blocking until enough of the ring has retired.
+        // The returned slice stays in place until it is marked ready. Null if the worker is being stopped.
+        StagedRows* reserve(std::stop_token stop, std::unique_lock<std::mutex>& lock, StagedRows rows, vk::DeviceSize size);
+
+        void createImage(Texture& texture, uint32_t width, uint32_t height);
+        UploadContext takeContext();
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_TEXTURE_STREAMER_HPP
@@ -0,0 +1,73 @@
+#include "texture_table.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace imr {
+
+    TextureTable::TextureTable(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice, uint32_t capacity) :
+            device(&device) {
+        // Update after bind descriptors have their own, often lower, limits. A combined image sampler counts as a
+        // sampled image and as a sampler, per set and per stage.
+        auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+        const auto& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+        this->capacity = std::min({capacity,
+                                   limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                                   limits.maxDescriptorSetUpdateAfterBindSamplers,
+                                   limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                   limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+        if (this->capacity <= ReservedTextureSlots) throw std::runtime_error("Texture table is too small");
+
+        vk::DescriptorSetLayoutBinding binding {
+                0, vk::DescriptorType::eCombinedImageSampler, this->capacity, vk::ShaderStageFlagBits::eFragment
+        };
+
+        vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                                  vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                                  vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{1, &bindingFlags};
+        vk::DescriptorSetLayoutCreateInfo layoutInfo {
+                vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+                1, &binding,
+                &bindingFlagsInfo
+        };
+
+        this->layout = device.createDescriptorSetLayout(layoutInfo);
+
+        vk::DescriptorPoolSize poolSize{vk::DescriptorType::eCombinedImageSampler, this->capacity};
+        this->pool = device.createDescriptorPool({vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet | vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, 1, &poolSize});
+
+        vk::DescriptorSetAllocateInfo setAllocInfo{*this->pool, 1, &*this->layout};
+        this->set = std::move(device.allocateDescriptorSets(setAllocInfo).front());
+
+        for (uint32_t slot = this->capacity; slot > ReservedTextureSlots; slot--) {
+            this->freeSlots.push_back(slot - 1);
+        }
+    }
+
+    uint32_t TextureTable::allocate() {
+        if (this->freeSlots.empty()) throw std::runtime_error("Texture table is full");
+
+        uint32_t slot = this->freeSlots.back();
+        this->freeSlots.pop_back();
+        return slot;
+    }
+
+    void TextureTable::release(uint32_t slot) {
+        if (slot < ReservedTextureSlots || slot >= this->capacity) throw std::runtime_error("Invalid texture slot");
+
+        this->freeSlots.push_back(slot);
+    }
+
+    void TextureTable::write(uint32_t slot, vk::Sampler sampler, vk::ImageView view) {
+        vk::DescriptorImageInfo imageInfo {
+                sampler,
+                view,
+                vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+
+        this->device->updateDescriptorSets(vk::WriteDescriptorSet{*this->set, 0, slot, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo}, nullptr);
+    }
+
+} // imr
@@ -0,0 +1,47 @@
+#ifndef VK_IMM_RENDERER_TEXTURE_TABLE_HPP
+#define VK_IMM_RENDERER_TEXTURE_TABLE_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "vulkan/vulkan_raii.hpp"
+
+#include "texture_slots.hpp"
+
+namespace imr {
+
+    // Bindless texture array: one descriptor set holding every sampled image, bound once per command buffer.
+    // Shaders index it with the slot stored in the vertex, so changing textures never splits a batch.
+    // The binding is partially bound and update after bind, slots that aren't used by pending frames can be
+    // written at any time.
+    class TextureTable {
+    public:
+        TextureTable() = default;
+        TextureTable(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice, uint32_t capacity);
+
+        // Throws when the table is full. The reserved slots are never handed out.
+        uint32_t allocate();
+        // The slot must not be sampled by any pending frame anymore
+        void release(uint32_t slot);
+
+        void write(uint32_t slot, vk::Sampler sampler, vk::ImageView view);
+
+        [[nodiscard]] vk::DescriptorSetLayout getLayout() const { return *this->layout; }
+        [[nodiscard]] vk::DescriptorSet getSet() const { return *this->set; }
+        [[nodiscard]] uint32_t getCapacity() const { return this->capacity; }
+
+    private:
+        const vk::raii::Device* device = nullptr;
+        uint32_t capacity = 0;
+
+        vk::raii::DescriptorSetLayout layout{VK_NULL_HANDLE};
+        vk::raii::DescriptorPool pool{VK_NULL_HANDLE};
+        vk::raii::DescriptorSet set{VK_NULL_HANDLE};
+
+        // Handed out from the back, so the lowest slots go first
+        std::vector<uint32_t> freeSlots;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_TEXTURE_TABLE_HPP
@@ -0,0 +1,85 @@
+#ifndef VK_IMM_RENDERER_VERTEX_FORMAT_HPP
+#define VK_IMM_RENDERER_VERTEX_FORMAT_HPP
+
+#include <span>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+
+#include <glm/glm.hpp>
+
+namespace imr {
+
+    // Two [0, 1] values in 16 bits each, read as a vec2 by the shaders
+    struct Unorm16x2 {
+        uint16_t x = 0;
+        uint16_t y = 0;
+
+        bool operator==(const Unorm16x2&) const = default;
+    };
+
+    // RGBA in 8 bits each, red in the lowest byte. Read as a vec4 by the shaders.
+    struct Unorm8x4 {
+        uint32_t rgba = 0;
+
+        bool operator==(const Unorm8x4&) const = default;
+    };
+
+    // Clamped to [0, 1] and rounded to the nearest step
+    inline Unorm16x2 packUnorm16x2(glm::vec2 value) {
+        auto pack = [](float v) { return static_cast<uint16_t>(std::clamp(v, 0.0f, 1.0f) * 65535.0f + 0.5f); };
+        return {pack(value.x), pack(value.y)};
+    }
+
+    inline Unorm8x4 packUnorm8x4(glm::vec4 value) {
+        auto pack = [](float v) { return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+        return {pack(value.x) | pack(value.y) << 8 | pack(value.z) << 16 | pack(value.w) << 24};
+    }
+
+    // What a shader input is fetched from, see getVertexAttributeFormat for the Vulkan side
+    enum class VertexAttributeType : uint8_t {
+        eFloat,
+        eFloat2,
+        eFloat4,
+        eUint,
+        eUnorm16x2,
+        eUnorm8x4
+    };
+
+    template<typename T>
+    constexpr VertexAttributeType getVertexAttributeType() {
+        if constexpr (std::same_as<T, float>) return VertexAttributeType::eFloat;
+        else if constexpr (std::same_as<T, glm::vec2>) return VertexAttributeType::eFloat2;
+        else if constexpr (std::same_as<T, glm::vec4>) return VertexAttributeType::eFloat4;
+        else if constexpr (std::same_as<T, uint32_t>) return VertexAttributeType::eUint;
+        else if constexpr (std::same_as<T, Unorm16x2>) return VertexAttributeType::eUnorm16x2;
+        else if constexpr (std::same_as<T, Unorm8x4>) return VertexAttributeType::eUnorm8x4;
+        else static_assert(sizeof(T) == 0, "Type can't be used as a vertex attribute");
+    }
+
+    struct VertexAttribute {
+        VertexAttributeType type;
+        uint32_t offset;
+    };
+
+    // T is the type the shader reads at offset, e.g. two adjacent floats as one glm::vec2
+    template<typename T>
+    constexpr VertexAttribute makeVertexAttribute(size_t offset) {
+        return {getVertexAttributeType<T>(), static_cast<uint32_t>(offset)};
+    }
+
+    // Structs read by the vertex stage declare their inputs with a constexpr getAttributes(), the array index
+    // being the shader location. The pipeline state is generated from it, see getVertexAttributes and
+    // makeShaderProgram in pipeline_manager.hpp.
+    template<typename T>
+    concept VertexFormat = std::is_trivially_copyable_v<T> && requires {
+        { T::getAttributes() } -> std::convertible_to<std::span<const VertexAttribute>>;
+        typename std::integral_constant<size_t, T::getAttributes().size()>;
+    };
+
+} // imr
+
+#endif //VK_IMM_RENDERER_VERTEX_FORMAT_HPP
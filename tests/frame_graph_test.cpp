@@ -0,0 +1,353 @@
+#include "test_common.hpp"
+
+#include "frame_graph.hpp"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// Culling, barriers, load and store ops and lazy transients of compiled frame graphs, and transient memory aliasing
+
+using namespace imr;
+
+namespace {
+
+    const vk::Extent2D Extent{64, 64};
+    const vk::ClearColorValue Black(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f});
+
+    ImportedImage makeBackbuffer() {
+        ImportedImage backbuffer;
+        backbuffer.format = vk::Format::eB8G8R8A8Unorm;
+        backbuffer.extent = Extent;
+        backbuffer.initialStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        backbuffer.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+        backbuffer.output = true;
+        return backbuffer;
+    }
+
+    const FrameGraphBarrier* findBarrier(const CompiledPass& pass, FrameGraphResource resource) {
+        auto it = std::ranges::find(pass.barriers, resource, &FrameGraphBarrier::resource);
+        return it != pass.barriers.end() ? &*it : nullptr;
+    }
+
+    const FrameGraphAttachment* findAttachment(const CompiledPass& pass, FrameGraphResource resource) {
+        auto it = std::ranges::find(pass.attachments, resource, &FrameGraphAttachment::resource);
+        return it != pass.attachments.end() ? &*it : nullptr;
+    }
+
+    const CompiledTransient* findTransient(const CompiledFrameGraph& compiled, FrameGraphResource resource) {
+        auto it = std::ranges::find(compiled.transients, resource, &CompiledTransient::resource);
+        return it != compiled.transients.end() ? &*it : nullptr;
+    }
+
+    void testCulling() {
+        FrameArena arena;
+        FrameGraph graph(arena);
+
+        FrameGraphResource backbuffer = graph.importImage(makeBackbuffer());
+        FrameGraphResource unread = graph.createImage({vk::Format::eR8G8B8A8Unorm, Extent});
+        FrameGraphResource history = graph.importImage({{}, {}, vk::Format::eR8G8B8A8Unorm, Extent});
+
+        // Cleared by the next pass, nothing sees what this one wrote
+        FrameGraphPass overwritten = graph.addPass("Overwritten", FrameGraphCallback{});
+        graph.writeColor(overwritten, backbuffer);
+
+        FrameGraphPass scene = graph.addPass("Scene", FrameGraphCallback{});
+        graph.writeColor(scene, backbuffer, Black);
+
+        // Nothing reads the transient, and the imported image isn't an output
+        FrameGraphPass unused = graph.addPass("Unused", FrameGraphCallback{});
+        graph.writeColor(unused, unread, Black);
+        FrameGraphPass notOutput = graph.addPass("NotOutput", FrameGraphCallback{});
+        graph.writeColor(notOutput, history, Black);
+
+        // Writes no image, only kept alive
+        FrameGraphPass readback = graph.addPass("Readback", FrameGraphCallback{});
+        graph.copyFrom(readback, backbuffer);
+        graph.keepAlive(readback);
+
+        const CompiledFrameGraph& compiled = graph.compile();
+
+        IMR_CHECK(compiled.culledPassCount == 3);
+        IMR_CHECK(compiled.passes.size() == 2);
+        if (compiled.passes.size() != 2) return;
+
+        IMR_CHECK(compiled.passes[0].pass == scene);
+        IMR_CHECK(compiled.passes[1].pass == readback);
+        IMR_CHECK(findTransient(compiled, unread) == nullptr);
+        IMR_CHECK(compiled.transients.empty());
+
+        // Reading the cleared image keeps the writer in front of it alive
+        graph.reset();
+        arena.reset();
+
+        backbuffer = graph.importImage(makeBackbuffer());
+        FrameGraphResource offscreen = graph.createImage({vk::Format::eR8G8B8A8Unorm, Extent});
+
+        FrameGraphPass producer = graph.addPass("Producer", FrameGraphCallback{});
+        graph.writeColor(producer, offscreen, Black);
+        FrameGraphPass consumer = graph.addPass("Consumer", FrameGraphCallback{});
+        graph.sample(consumer, offscreen);
+        graph.writeColor(consumer, backbuffer, Black);
+
+        IMR_CHECK(graph.compile().culledPassCount == 0);
+        IMR_CHECK(graph.getCompiled().passes.size() == 2);
+    }
+
+    // Offscreen color and a depth buffer, composited into the backbuffer and overlaid
+    struct CompositeGraph {
+        FrameArena arena;
+        FrameGraph graph{arena};
+        FrameGraphResource backbuffer, offscreen, depth;
+        FrameGraphPass offscreenPass, compositePass, overlayPass;
+
+        CompositeGraph() {
+            backbuffer = graph.importImage(makeBackbuffer());
+            offscreen = graph.createImage({vk::Format::eR8G8B8A8Unorm, Extent});
+            depth = graph.createImage({vk::Format::eD32Sfloat, Extent});
+
+            offscreenPass = graph.addPass("Offscreen", FrameGraphCallback{});
+            graph.writeColor(offscreenPass, offscreen, Black);
+
+            // Depth declared first, it still has to end up last
+            compositePass = graph.addPass("Composite", FrameGraphCallback{});
+            graph.writeDepth(compositePass, depth, vk::ClearDepthStencilValue{1.0f, 0});
+            graph.sample(compositePass, offscreen);
+            graph.writeColor(compositePass, backbuffer, Black);
+
+            overlayPass = graph.addPass("Overlay", FrameGraphCallback{});
+            graph.sample(overlayPass, offscreen);
+            graph.writeColor(overlayPass, backbuffer);
+
+            graph.compile();
+        }
+    };
+
+    void testBarriers() {
+        CompositeGraph setup;
+        const CompiledFrameGraph& compiled = setup.graph.getCompiled();
+
+        IMR_CHECK(compiled.passes.size() == 3);
+        if (compiled.passes.size() != 3) return;
+
+        const CompiledPass& offscreenPass = compiled.passes[0];
+        const CompiledPass& compositePass = compiled.passes[1];
+        const CompiledPass& overlayPass = compiled.passes[2];
+
+        // First use of a transient discards whatever was in its memory
+        const FrameGraphBarrier* first = findBarrier(offscreenPass, setup.offscreen);
+        IMR_CHECK(first != nullptr);
+        if (first) {
+            IMR_CHECK(first->oldLayout == vk::ImageLayout::eUndefined);
+            IMR_CHECK(first->newLayout == vk::ImageLayout::eColorAttachmentOptimal);
+            IMR_CHECK(first->dstStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput));
+        }
+
+        // Written as an attachment, then sampled
+        const FrameGraphBarrier* toSampled = findBarrier(compositePass, setup.offscreen);
+        IMR_CHECK(toSampled != nullptr);
+        if (toSampled) {
+            IMR_CHECK(toSampled->oldLayout == vk::ImageLayout::eColorAttachmentOptimal);
+            IMR_CHECK(toSampled->newLayout == vk::ImageLayout::eShaderReadOnlyOptimal);
+            IMR_CHECK(toSampled->srcStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput));
+            IMR_CHECK(toSampled->dstStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader));
+            IMR_CHECK(toSampled->srcAccess == vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite));
+            IMR_CHECK(toSampled->dstAccess == vk::AccessFlags(vk::AccessFlagBits::eShaderRead));
+        }
+
+        // The imported image waits for the stage it was handed over at
+        const FrameGraphBarrier* acquire = findBarrier(compositePass, setup.backbuffer);
+        IMR_CHECK(acquire != nullptr);
+        if (acquire) {
+            IMR_CHECK(acquire->oldLayout == vk::ImageLayout::eUndefined);
+            IMR_CHECK(acquire->srcStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput));
+        }
+
+        // Already visible to the fragment shader, a second read needs nothing
+        IMR_CHECK(findBarrier(overlayPass, setup.offscreen) == nullptr);
+
+        // Write after write keeps the layout but still waits
+        const FrameGraphBarrier* overlay = findBarrier(overlayPass, setup.backbuffer);
+        IMR_CHECK(overlay != nullptr);
+        if (overlay) {
+            IMR_CHECK(overlay->oldLayout == vk::ImageLayout::eColorAttachmentOptimal);
+            IMR_CHECK(overlay->newLayout == vk::ImageLayout::eColorAttachmentOptimal);
+            IMR_CHECK(overlay->srcAccess == vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite));
+        }
+
+        // Only the imported image is moved to its final layout
+        IMR_CHECK(compiled.finalBarriers.size() == 1);
+        if (!compiled.finalBarriers.empty()) {
+            const FrameGraphBarrier& present = compiled.finalBarriers[0];
+            IMR_CHECK(present.resource == setup.backbuffer);
+            IMR_CHECK(present.oldLayout == vk::ImageLayout::eColorAttachmentOptimal);
+            IMR_CHECK(present.newLayout == vk::ImageLayout::ePresentSrcKHR);
+            IMR_CHECK(present.srcStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput));
+            IMR_CHECK(present.srcAccess == vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite));
+        }
+    }
+
+    void testLoadStoreOps() {
+        CompositeGraph setup;
+        const CompiledFrameGraph& compiled = setup.graph.getCompiled();
+        if (compiled.passes.size() != 3) return;
+
+        // Cleared, and kept for the passes that sample it
+        const FrameGraphAttachment* offscreen = findAttachment(compiled.passes[0], setup.offscreen);
+        IMR_CHECK(offscreen && offscreen->loadOp == vk::AttachmentLoadOp::eClear && offscreen->storeOp == vk::AttachmentStoreOp::eStore);
+
+        // Imported images are always stored
+        const FrameGraphAttachment* scene = findAttachment(compiled.passes[1], setup.backbuffer);
+        IMR_CHECK(scene && scene->loadOp == vk::AttachmentLoadOp::eClear && scene->storeOp == vk::AttachmentStoreOp::eStore);
+
+        const FrameGraphAttachment* overlay = findAttachment(compiled.passes[2], setup.backbuffer);
+        IMR_CHECK(overlay && overlay->loadOp == vk::AttachmentLoadOp::eLoad && overlay->storeOp == vk::AttachmentStoreOp::eStore);
+
+        // Nothing after the pass reads the depth, it's never written out
+        const FrameGraphAttachment* depth = findAttachment(compiled.passes[1], setup.depth);
+        IMR_CHECK(depth && depth->loadOp == vk::AttachmentLoadOp::eClear && depth->storeOp == vk::AttachmentStoreOp::eDontCare);
+        IMR_CHECK(depth && depth->clearValue.depthStencil.depth == 1.0f);
+
+        // The depth attachment goes last
+        IMR_CHECK(!compiled.passes[1].attachments.empty() && compiled.passes[1].attachments.back().resource == setup.depth);
+        IMR_CHECK(compiled.passes[1].extent == Extent);
+
+        // Neither loaded nor stored: not cleared, never written before and never read after
+        FrameArena arena;
+        FrameGraph graph(arena);
+        FrameGraphResource backbuffer = graph.importImage(makeBackbuffer());
+        FrameGraphResource scratch = graph.createImage({vk::Format::eD32Sfloat, Extent});
+
+        FrameGraphPass pass = graph.addPass("Scene", FrameGraphCallback{});
+        graph.writeColor(pass, backbuffer, Black);
+        graph.writeDepth(pass, scratch);
+
+        const CompiledFrameGraph& single = graph.compile();
+        IMR_CHECK(single.passes.size() == 1);
+        if (single.passes.size() != 1) return;
+
+        const FrameGraphAttachment* transient = findAttachment(single.passes[0], scratch);
+        IMR_CHECK(transient && transient->loadOp == vk::AttachmentLoadOp::eDontCare && transient->storeOp == vk::AttachmentStoreOp::eDontCare);
+    }
+
+    void testLazyTransients() {
+        CompositeGraph setup;
+        const CompiledFrameGraph& compiled = setup.graph.getCompiled();
+
+        // Attachment of a single pass, never leaves tile memory
+        const CompiledTransient* depth = findTransient(compiled, setup.depth);
+        IMR_CHECK(depth != nullptr);
+        if (depth) {
+            IMR_CHECK(depth->lazy);
+            IMR_CHECK(depth->firstUse == 1 && depth->lastUse == 1);
+            IMR_CHECK(static_cast<bool>(depth->usage & vk::ImageUsageFlagBits::eTransientAttachment));
+            IMR_CHECK(static_cast<bool>(depth->usage & vk::ImageUsageFlagBits::eDepthStencilAttachment));
+        }
+
+        // Sampled later, so it's stored and can't be lazy
+        const CompiledTransient* offscreen = findTransient(compiled, setup.offscreen);
+        IMR_CHECK(offscreen != nullptr);
+        if (offscreen) {
+            IMR_CHECK(!offscreen->lazy);
+            IMR_CHECK(offscreen->firstUse == 0 && offscreen->lastUse == 2);
+            IMR_CHECK(!(offscreen->usage & vk::ImageUsageFlagBits::eTransientAttachment));
+            IMR_CHECK(offscreen->usage == (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled));
+        }
+
+        // Imported images aren't transients
+        IMR_CHECK(findTransient(compiled, setup.backbuffer) == nullptr);
+        IMR_CHECK(compiled.transients.size() == 2);
+
+        // Only a copy source, not an attachment
+        FrameArena arena;
+        FrameGraph graph(arena);
+        FrameGraphResource copied = graph.createImage({vk::Format::eR8G8B8A8Unorm, Extent});
+        FrameGraphPass pass = graph.addPass("Copy", FrameGraphCallback{});
+        graph.copyTo(pass, copied);
+        graph.keepAlive(pass);
+
+        const CompiledTransient* transfer = findTransient(graph.compile(), copied);
+        IMR_CHECK(transfer && !transfer->lazy);
+    }
+
+    bool overlaps(const TransientMemoryRequest& a, vk::DeviceSize aOffset, const TransientMemoryRequest& b, vk::DeviceSize bOffset) {
+        bool inTime = a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+        bool inMemory = aOffset < bOffset + b.size && bOffset < aOffset + a.size;
+        return inTime && inMemory;
+    }
+
+    void testPackTransientMemory() {
+        // A and B never live at the same time, C overlaps both
+        std::array<TransientMemoryRequest, 3> requests = {{
+                {100, 4, 0, 1},
+                {100, 4, 2, 3},
+                {50, 64, 1, 2}
+        }};
+
+        auto [offsets, size] = packTransientMemory(requests);
+        IMR_CHECK(offsets.size() == 3);
+        if (offsets.size() != 3) return;
+
+        IMR_CHECK(offsets[0] == offsets[1]);
+        IMR_CHECK(offsets[2] == 128);
+        IMR_CHECK(size == 178);
+
+        // Everything alive at once is laid out one after another
+        std::array<TransientMemoryRequest, 2> together = {{{256, 256, 0, 0}, {256, 256, 0, 0}}};
+        auto [togetherOffsets, togetherSize] = packTransientMemory(together);
+        IMR_CHECK(togetherOffsets[0] != togetherOffsets[1]);
+        IMR_CHECK(togetherSize == 512);
+
+        IMR_CHECK(packTransientMemory({}).second == 0);
+
+        // Random lifetimes: aligned, and nothing alive at the same time shares memory
+        uint32_t state = 0x9E3779B9u;
+        auto next = [&](uint32_t range) {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) % range;
+        };
+
+        for (int round = 0; round < 100; round++) {
+            std::vector<TransientMemoryRequest> random(1 + next(12));
+            vk::DeviceSize sum = 0;
+            for (auto& request : random) {
+                request.size = 1 + next(4096);
+                request.alignment = vk::DeviceSize{1} << next(9);
+                request.firstUse = next(8);
+                request.lastUse = request.firstUse + next(4);
+                sum += request.size + request.alignment;
+            }
+
+            auto [randomOffsets, randomSize] = packTransientMemory(random);
+
+            for (size_t i = 0; i < random.size(); i++) {
+                IMR_CHECK(randomOffsets[i] % random[i].alignment == 0);
+                IMR_CHECK(randomOffsets[i] + random[i].size <= randomSize);
+
+                for (size_t j = i + 1; j < random.size(); j++) {
+                    IMR_CHECK(!overlaps(random[i], randomOffsets[i], random[j], randomOffsets[j]));
+                }
+            }
+            IMR_CHECK(randomSize <= sum);
+        }
+    }
+
+    void testImageAspect() {
+        IMR_CHECK(getImageAspect(vk::Format::eB8G8R8A8Unorm) == vk::ImageAspectFlags(vk::ImageAspectFlagBits::eColor));
+        IMR_CHECK(getImageAspect(vk::Format::eD32Sfloat) == vk::ImageAspectFlags(vk::ImageAspectFlagBits::eDepth));
+        IMR_CHECK(getImageAspect(vk::Format::eD24UnormS8Uint) == (vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil));
+    }
+
+}
+
+int main() {
+    testCulling();
+    testBarriers();
+    testLoadStoreOps();
+    testLazyTransients();
+    testPackTransientMemory();
+    testImageAspect();
+
+    return imr::test::finish("frame_graph_test");
+}
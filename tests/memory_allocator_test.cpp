@@ -0,0 +1,239 @@
+#include "test_common.hpp"
+
+#include "memory_allocator.hpp"
+#include "offset_allocator.hpp"
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+// Memory type choice and block bookkeeping of the DeviceMemoryAllocator, with blocks handed out by a fake device
+
+using namespace imr;
+
+namespace {
+
+    using Props = vk::MemoryPropertyFlagBits;
+
+    // Ordered like drivers report them, plain device local first
+    vk::PhysicalDeviceMemoryProperties makeProperties() {
+        vk::PhysicalDeviceMemoryProperties properties;
+        properties.memoryTypeCount = 4;
+        properties.memoryTypes[0].propertyFlags = Props::eDeviceLocal;
+        properties.memoryTypes[1].propertyFlags = Props::eHostVisible | Props::eHostCoherent;
+        properties.memoryTypes[2].propertyFlags = Props::eHostVisible | Props::eHostCoherent | Props::eHostCached;
+        properties.memoryTypes[3].propertyFlags = Props::eDeviceLocal | Props::eLazilyAllocated;
+        return properties;
+    }
+
+    // Hands out fake handles, host visible blocks are backed by host memory
+    struct FakeDevice {
+        uintptr_t nextHandle = 1;
+        uint32_t allocatedBlocks = 0;
+        uint32_t freedBlocks = 0;
+        std::vector<vk::DeviceSize> blockSizes;
+        std::vector<std::unique_ptr<std::byte[]>> hostMemory;
+
+        MemoryBlockSource getSource() {
+            return {
+                    this,
+                    [](void* context, const vk::MemoryAllocateInfo& info, bool map, void*& mapped) {
+                        auto* device = static_cast<FakeDevice*>(context);
+                        device->allocatedBlocks++;
+                        device->blockSizes.push_back(info.allocationSize);
+
+                        if (map) {
+                            device->hostMemory.push_back(std::make_unique<std::byte[]>(info.allocationSize));
+                            mapped = device->hostMemory.back().get();
+                        }
+                        return vk::DeviceMemory(reinterpret_cast<VkDeviceMemory>(device->nextHandle++));
+                    },
+                    [](void* context, vk::DeviceMemory) {
+                        static_cast<FakeDevice*>(context)->freedBlocks++;
+                    }
+            };
+        }
+    };
+
+    constexpr vk::DeviceSize BlockSize = 1 << 20;
+    constexpr uint32_t AllTypes = 0xF;
+
+    void testTypeChoice() {
+        MemoryTypeTable types(makeProperties());
+
+        IMR_CHECK(types.findMemoryType(AllTypes, Props::eDeviceLocal) == 0);
+        IMR_CHECK(types.findMemoryType(AllTypes, Props::eHostVisible) == 1);
+
+        // Preferred flags pick among the types with the required ones, without them the first one is taken
+        IMR_CHECK(types.findMemoryType(AllTypes, Props::eHostVisible | Props::eHostCoherent, Props::eHostCached) == 2);
+        IMR_CHECK(types.findMemoryType(AllTypes & ~(1u << 2), Props::eHostVisible, Props::eHostCached) == 1);
+        IMR_CHECK(types.findMemoryType(AllTypes, Props::eDeviceLocal, Props::eLazilyAllocated) == 3);
+        IMR_CHECK(types.findMemoryType(1u << 0, Props::eDeviceLocal, Props::eLazilyAllocated) == 0);
+
+        // The filter has the last word, preferred flags never make up for missing required ones
+        IMR_CHECK(types.findMemoryType(1u << 3, vk::MemoryPropertyFlags{}) == 3);
+        IMR_CHECK_THROWS((void)types.findMemoryType(1u << 0, Props::eHostVisible));
+        IMR_CHECK_THROWS((void)types.findMemoryType(AllTypes, Props::eHostCached | Props::eLazilyAllocated));
+    }
+
+    void testHostVisibleBlocksAreMapped() {
+        FakeDevice device;
+        DeviceMemoryAllocator allocator(makeProperties(), device.getSource(), BlockSize);
+
+        MemoryAllocation first = allocator.allocate({1000, 16, AllTypes}, Props::eHostVisible, ResourceKind::eBuffer, Props::eHostCached);
+        MemoryAllocation second = allocator.allocate({1000, 16, AllTypes}, Props::eHostVisible, ResourceKind::eBuffer, Props::eHostCached);
+        MemoryAllocation local = allocator.allocate({1000, 16, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+
+        IMR_CHECK(first.memory == second.memory);
+        IMR_CHECK(first.mapped != nullptr && second.mapped != nullptr);
+        IMR_CHECK(static_cast<std::byte*>(second.mapped) - static_cast<std::byte*>(first.mapped) ==
+                  static_cast<std::ptrdiff_t>(second.offset - first.offset));
+        IMR_CHECK(local.memory != first.memory);
+        IMR_CHECK(local.mapped == nullptr);
+        IMR_CHECK(device.hostMemory.size() == 1);
+    }
+
+    void testAlignment() {
+        FakeDevice device;
+        DeviceMemoryAllocator allocator(makeProperties(), device.getSource(), BlockSize);
+
+        std::vector<MemoryAllocation> allocations;
+        for (vk::DeviceSize alignment : {1ull, 256ull, 4ull, 4096ull, 64ull, 65536ull}) {
+            MemoryAllocation allocation = allocator.allocate({333, alignment, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+            IMR_CHECK(allocation.offset % alignment == 0);
+            IMR_CHECK(allocation.size >= 333);
+            allocations.push_back(allocation);
+        }
+
+        // None of them overlap
+        for (size_t i = 0; i < allocations.size(); i++) {
+            for (size_t j = i + 1; j < allocations.size(); j++) {
+                const MemoryAllocation& a = allocations[i];
+                const MemoryAllocation& b = allocations[j];
+                IMR_CHECK(a.offset + a.size <= b.offset || b.offset + b.size <= a.offset);
+            }
+        }
+
+        IMR_CHECK(allocator.getStats().blockCount == 1);
+    }
+
+    void testSplitAndMerge() {
+        FakeDevice device;
+        DeviceMemoryAllocator allocator(makeProperties(), device.getSource(), BlockSize);
+
+        vk::MemoryRequirements requirements{BlockSize / 4, 256, AllTypes};
+        MemoryAllocation a = allocator.allocate(requirements, Props::eDeviceLocal, ResourceKind::eBuffer);
+        MemoryAllocation b = allocator.allocate(requirements, Props::eDeviceLocal, ResourceKind::eBuffer);
+        MemoryAllocation c = allocator.allocate(requirements, Props::eDeviceLocal, ResourceKind::eBuffer);
+
+        MemoryStats stats = allocator.getStats();
+        IMR_CHECK(stats.blockCount == 1);
+        IMR_CHECK(stats.allocationCount == 3);
+        IMR_CHECK(stats.usedBytes == 3 * requirements.size);
+        IMR_CHECK(device.allocatedBlocks == 1);
+
+        // Two holes that can't merge across b
+        allocator.free(a);
+        allocator.free(c);
+        IMR_CHECK(!a && !c);
+        IMR_CHECK(allocator.getStats().fragmentation > 0.0);
+
+        // Freeing b merges everything back into a single free range
+        allocator.free(b);
+        stats = allocator.getStats();
+        IMR_CHECK(stats.allocationCount == 0);
+        IMR_CHECK(stats.usedBytes == 0);
+        IMR_CHECK(stats.fragmentation == 0.0);
+
+        // Space that was split and merged again is reused, the driver isn't asked for more
+        MemoryAllocation half = allocator.allocate({BlockSize / 2, 256, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+        IMR_CHECK(static_cast<bool>(half));
+        IMR_CHECK(device.allocatedBlocks == 1);
+
+        // Freeing twice is harmless, the allocation was reset
+        allocator.free(half);
+        allocator.free(half);
+        IMR_CHECK(allocator.getStats().allocationCount == 0);
+    }
+
+    void testDoubleFree() {
+        TlsfAllocator tlsf(4096);
+
+        std::optional<OffsetAllocation> a = tlsf.allocate(1024);
+        std::optional<OffsetAllocation> b = tlsf.allocate(1024);
+        IMR_CHECK(a && b);
+        if (!a || !b) return;
+
+        // a is still free on its own, b is merged into it and its node goes back to the pool
+        tlsf.free(*a);
+        tlsf.free(*b);
+        IMR_CHECK_THROWS(tlsf.free(*a));
+        IMR_CHECK_THROWS(tlsf.free(*b));
+
+        OffsetAllocatorStats stats = tlsf.getStats();
+        IMR_CHECK(stats.used == 0);
+        IMR_CHECK(stats.allocationCount == 0);
+        IMR_CHECK(stats.freeBlockCount == 1);
+        IMR_CHECK(stats.largestFreeBlock == 4096);
+
+        // The free lists are intact, the whole range can be handed out again
+        std::optional<OffsetAllocation> all = tlsf.allocate(4096);
+        IMR_CHECK(all && all->offset == 0);
+    }
+
+    void testBlocks() {
+        FakeDevice device;
+
+        {
+            DeviceMemoryAllocator allocator(makeProperties(), device.getSource(), BlockSize);
+
+            // Buffers and images never share a block
+            MemoryAllocation buffer = allocator.allocate({4096, 256, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+            MemoryAllocation image = allocator.allocate({4096, 256, AllTypes}, Props::eDeviceLocal, ResourceKind::eImage);
+            IMR_CHECK(buffer.memory != image.memory);
+
+            // Larger than a block, gets a block of its own size
+            MemoryAllocation large = allocator.allocate({BlockSize * 3, 256, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+            IMR_CHECK(large.memory != buffer.memory);
+            IMR_CHECK(device.blockSizes.size() == 3 && device.blockSizes[2] == BlockSize * 3);
+
+            // Full block, the next one is opened
+            MemoryAllocation rest = allocator.allocate({BlockSize / 2, 256, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+            MemoryAllocation more = allocator.allocate({BlockSize / 2, 256, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+            IMR_CHECK(allocator.getStats().blockCount == device.allocatedBlocks);
+
+            // Moving hands the blocks over, the moved from allocator owns nothing
+            DeviceMemoryAllocator moved = std::move(allocator);
+            IMR_CHECK(moved.getStats().blockCount == device.allocatedBlocks);
+            IMR_CHECK(allocator.getStats().blockCount == 0);
+
+            // Trim keeps one empty block per pool
+            uint32_t blocks = device.allocatedBlocks;
+            for (MemoryAllocation* allocation : {&buffer, &image, &large, &rest, &more}) moved.free(*allocation);
+            moved.trim();
+            IMR_CHECK(moved.getStats().blockCount == 2);
+            IMR_CHECK(device.freedBlocks == blocks - 2);
+
+            // Slots of trimmed blocks are reused
+            MemoryAllocation again = moved.allocate({BlockSize * 2, 256, AllTypes}, Props::eDeviceLocal, ResourceKind::eBuffer);
+            IMR_CHECK(again.block < blocks);
+        }
+
+        // Everything goes back when the allocator does
+        IMR_CHECK(device.freedBlocks == device.allocatedBlocks);
+    }
+
+}
+
+int main() {
+    testTypeChoice();
+    testHostVisibleBlocksAreMapped();
+    testAlignment();
+    testSplitAndMerge();
+    testDoubleFree();
+    testBlocks();
+
+    return imr::test::finish("memory_allocator_test");
+}
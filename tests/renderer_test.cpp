@@ -0,0 +1,301 @@
+#include "test_common.hpp"
+
+#include "renderer.hpp"
+#include "text_cache.hpp"
+
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+// Batch counts of the Renderer for mixed primitive streams, recorded into host memory
+
+using namespace imr;
+
+namespace {
+
+    const glm::vec4 White{1.0f, 1.0f, 1.0f, 1.0f};
+
+    // Stands in for the mapped upload buffer
+    struct HostTarget {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<ShapeInstance> shapes;
+
+        HostTarget(uint32_t vertexCapacity, uint32_t indexCapacity, uint32_t shapeCapacity) :
+                vertices(vertexCapacity), indices(indexCapacity), shapes(shapeCapacity) {}
+
+        GeometryTarget get() {
+            return {vertices.data(), static_cast<uint32_t>(vertices.size()),
+                    indices.data(), static_cast<uint32_t>(indices.size()),
+                    shapes.data(), static_cast<uint32_t>(shapes.size())};
+        }
+    };
+
+    bool hasPipelines(const Renderer& renderer, std::initializer_list<PipelineType> pipelines) {
+        const auto& batches = renderer.getBatches();
+        if (batches.size() != pipelines.size()) return false;
+
+        size_t i = 0;
+        for (PipelineType pipeline : pipelines) {
+            if (batches[i++].state.pipeline != pipeline) return false;
+        }
+        return true;
+    }
+
+    void testRectsShareOneBatch() {
+        HostTarget host(4096, 8192, 16);
+        Renderer renderer;
+
+        renderer.begin(host.get());
+        for (int i = 0; i < 100; i++) renderer.drawRect({static_cast<float>(i), 0.0f}, {10.0f, 10.0f}, White);
+        renderer.end();
+
+        IMR_CHECK(renderer.getBatches().size() == 1);
+        IMR_CHECK(renderer.getBatches()[0].indexCount == 600);
+        IMR_CHECK(renderer.getVertices().size() == 400);
+    }
+
+    void testPipelineChangesSplit() {
+        HostTarget host(4096, 8192, 16);
+        TextureSlots slots;
+        slots.assign(ReservedTextureSlots, ReservedTextureSlots);
+        TextCache textCache;
+
+        Renderer renderer;
+        renderer.setTextureSlots(&slots);
+        renderer.setTextCache(&textCache);
+        textCache.beginFrame(1);
+
+        renderer.begin(host.get());
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.drawLine({0.0f, 0.0f}, {10.0f, 10.0f}, 2.0f, White);
+        renderer.drawRoundedRect({0.0f, 0.0f}, {10.0f, 10.0f}, 2.0f, White);
+        renderer.drawCircle({5.0f, 5.0f}, 5.0f, White);
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        // Different textures stay in one batch, the slot is part of the vertices
+        renderer.drawTexturedQuad({0.0f, 0.0f}, {10.0f, 10.0f}, ReservedTextureSlots);
+        renderer.drawTexturedQuad({0.0f, 0.0f}, {10.0f, 10.0f}, NullTexture);
+        renderer.drawText({0.0f, 0.0f}, "Batches", 16.0f, White);
+        renderer.drawText({0.0f, 20.0f}, "share the atlas", 16.0f, White);
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.end();
+
+        IMR_CHECK(hasPipelines(renderer, {PipelineType::eSolid, PipelineType::eShape, PipelineType::eSolid,
+                                          PipelineType::eTextured, PipelineType::eText, PipelineType::eSolid}));
+        IMR_CHECK(renderer.getBatches()[1].instanceCount == 2);
+        IMR_CHECK(renderer.getBatches()[1].firstInstance == 0);
+        IMR_CHECK(renderer.getBatches()[3].indexCount == 12);
+        IMR_CHECK(renderer.getShapes().size() == 2);
+    }
+
+    void testBlendChangesSplit() {
+        HostTarget host(4096, 8192, 16);
+        Renderer renderer;
+
+        renderer.begin(host.get());
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        // Setting the current mode again changes nothing
+        renderer.setBlendMode(BlendMode::eAlpha);
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.setBlendMode(BlendMode::eAdditive);
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.setBlendMode(BlendMode::eAlpha);
+        renderer.drawRoundedRect({0.0f, 0.0f}, {10.0f, 10.0f}, 2.0f, White);
+        // Glows are always additive
+        renderer.drawGlow({0.0f, 0.0f}, {10.0f, 10.0f}, 2.0f, 4.0f, White);
+        renderer.drawRoundedRect({0.0f, 0.0f}, {10.0f, 10.0f}, 2.0f, White);
+        renderer.end();
+
+        const auto& batches = renderer.getBatches();
+        IMR_CHECK(batches.size() == 5);
+        if (batches.size() != 5) return;
+
+        IMR_CHECK(batches[0].indexCount == 12);
+        IMR_CHECK(batches[1].state.blend == BlendMode::eAdditive);
+        IMR_CHECK(batches[3].state.blend == BlendMode::eAdditive);
+        IMR_CHECK(batches[3].state.pipeline == PipelineType::eShape);
+        IMR_CHECK(batches[4].firstInstance == 2);
+    }
+
+    void testClipChangesSplit() {
+        HostTarget host(4096, 8192, 16);
+        Renderer renderer;
+
+        renderer.begin(host.get());
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+
+        renderer.pushClipRect({0.0f, 0.0f}, {100.0f, 100.0f});
+        renderer.drawRect({10.0f, 10.0f}, {10.0f, 10.0f}, White);
+        // Outside of the clip, dropped before it reaches the geometry
+        renderer.drawRect({200.0f, 200.0f}, {10.0f, 10.0f}, White);
+        renderer.drawCircle({300.0f, 300.0f}, 5.0f, White);
+
+        // Same clip again, no split
+        renderer.pushClipRect({0.0f, 0.0f}, {100.0f, 100.0f});
+        renderer.drawRect({20.0f, 20.0f}, {10.0f, 10.0f}, White);
+        renderer.popClipRect();
+
+        // Nothing is left of a clip outside of its parent
+        renderer.pushClipRect({500.0f, 500.0f}, {10.0f, 10.0f});
+        renderer.drawRect({500.0f, 500.0f}, {10.0f, 10.0f}, White);
+        renderer.popClipRect();
+        renderer.popClipRect();
+
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.end();
+
+        const auto& batches = renderer.getBatches();
+        IMR_CHECK(batches.size() == 3);
+        if (batches.size() != 3) return;
+
+        IMR_CHECK(batches[1].indexCount == 12);
+        IMR_CHECK(batches[1].state.clip.max == glm::vec2(100.0f, 100.0f));
+        IMR_CHECK(batches[0].state.clip == batches[2].state.clip);
+        IMR_CHECK(renderer.getShapes().empty());
+        IMR_CHECK(renderer.getVertices().size() == 16);
+    }
+
+    void testZonesSplit() {
+        HostTarget host(4096, 8192, 16);
+        Renderer renderer;
+
+        renderer.begin(host.get());
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.beginZone("Zone");
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.endZone();
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.end();
+
+        IMR_CHECK(renderer.getBatches().size() == 3);
+
+        const auto& markers = renderer.getZoneMarkers();
+        IMR_CHECK(markers.size() == 2);
+        if (markers.size() != 2) return;
+
+        IMR_CHECK(markers[0].batch == 1 && markers[0].name != nullptr);
+        IMR_CHECK(markers[1].batch == 2 && markers[1].name == nullptr);
+    }
+
+    void testScopesSplitAndReplay() {
+        HostTarget host(4096, 8192, 16);
+        Renderer renderer;
+
+        auto drawFrame = [&] {
+            renderer.begin(host.get());
+            renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+            if (renderer.beginScope(1, 42)) {
+                renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+                renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+                renderer.drawCircle({5.0f, 5.0f}, 5.0f, White);
+            }
+            renderer.endScope();
+            renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+            renderer.end();
+        };
+
+        drawFrame();
+        IMR_CHECK(hasPipelines(renderer, {PipelineType::eSolid, PipelineType::eSolid, PipelineType::eShape, PipelineType::eSolid}));
+
+        std::vector<DrawBatch> first = renderer.getBatches();
+
+        // The hit replays the same batches at the same offsets
+        drawFrame();
+        const auto& batches = renderer.getBatches();
+        IMR_CHECK(batches.size() == first.size());
+        for (size_t i = 0; i < std::min(batches.size(), first.size()); i++) {
+            IMR_CHECK(batches[i].firstIndex == first[i].firstIndex);
+            IMR_CHECK(batches[i].indexCount == first[i].indexCount);
+            IMR_CHECK(batches[i].instanceCount == first[i].instanceCount);
+            IMR_CHECK(batches[i].vertexOffset == first[i].vertexOffset);
+        }
+    }
+
+    void testDrawCommands() {
+        HostTarget host(4096, 8192, 16);
+        Renderer renderer;
+
+        renderer.begin(host.get());
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.drawCircle({5.0f, 5.0f}, 5.0f, White);
+        renderer.drawCircle({5.0f, 5.0f}, 5.0f, White);
+        renderer.drawCircle({5.0f, 5.0f}, 5.0f, White);
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.end();
+
+        std::array<DrawIndirectCommand, 3> commands{};
+        renderer.writeDrawCommands(commands, false);
+
+        IMR_CHECK(commands[0].count == 12 && commands[0].instanceCount == 1 && commands[0].first == 0);
+        IMR_CHECK(commands[1].count == 6 && commands[1].instanceCount == 3 && commands[1].vertexOffset == 0);
+        IMR_CHECK(commands[2].count == 6 && commands[2].first == 12);
+
+        // The culling pass fills in the shape instances
+        renderer.writeDrawCommands(commands, true);
+        IMR_CHECK(commands[1].instanceCount == 0);
+        IMR_CHECK(commands[2].instanceCount == 1);
+
+        std::array<DrawIndirectCommand, 2> tooFew{};
+        IMR_CHECK_THROWS(renderer.writeDrawCommands(tooFew, false));
+    }
+
+    void testTargetOverflowThrows() {
+        HostTarget host(4, 6, 1);
+        Renderer renderer;
+
+        renderer.begin(host.get());
+        renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White);
+        renderer.drawCircle({5.0f, 5.0f}, 5.0f, White);
+        IMR_CHECK_THROWS(renderer.drawRect({0.0f, 0.0f}, {10.0f, 10.0f}, White));
+        IMR_CHECK_THROWS(renderer.drawCircle({5.0f, 5.0f}, 5.0f, White));
+        renderer.end();
+
+        IMR_CHECK(renderer.getBatches().size() == 2);
+    }
+
+    std::vector<uint32_t> decode(TextCache& textCache, std::string_view text) {
+        std::vector<uint32_t> codepoints;
+        for (const auto& glyph : textCache.getRun(text, DefaultFont, 8.0f).glyphs) codepoints.push_back(glyph.codepoint);
+        return codepoints;
+    }
+
+    void testUtf8Decoding() {
+        TextCache textCache;
+        using Codepoints = std::vector<uint32_t>;
+
+        IMR_CHECK(decode(textCache, "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80") == (Codepoints{'a', 0xE9, 0x20AC, 0x1F600}));
+        IMR_CHECK(decode(textCache, "\xF4\x8F\xBF\xBF") == Codepoints{0x10FFFF});
+
+        // Overlong forms
+        IMR_CHECK(decode(textCache, "\xC0\xAF") == Codepoints{0xFFFD});
+        IMR_CHECK(decode(textCache, "\xE0\x80\xAF") == Codepoints{0xFFFD});
+        IMR_CHECK(decode(textCache, "\xF0\x80\x80\xAF") == Codepoints{0xFFFD});
+
+        // Surrogates, past U+10FFFF, leads of 5 and 6 byte forms
+        IMR_CHECK(decode(textCache, "\xED\xA0\x80") == Codepoints{0xFFFD});
+        IMR_CHECK(decode(textCache, "\xF4\x90\x80\x80") == Codepoints{0xFFFD});
+        IMR_CHECK(decode(textCache, "\xF8\x88\x80\x80\x80x") == (Codepoints{0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD, 'x'}));
+
+        // Truncated, the next character isn't swallowed
+        IMR_CHECK(decode(textCache, "\xE2\x82x") == (Codepoints{0xFFFD, 'x'}));
+    }
+
+}
+
+int main() {
+    testRectsShareOneBatch();
+    testPipelineChangesSplit();
+    testBlendChangesSplit();
+    testClipChangesSplit();
+    testZonesSplit();
+    testScopesSplitAndReplay();
+    testDrawCommands();
+    testTargetOverflowThrows();
+    testUtf8Decoding();
+
+    return imr::test::finish("renderer_test");
+}
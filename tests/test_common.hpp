@@ -0,0 +1,45 @@
+#ifndef VK_IMM_RENDERER_TEST_COMMON_HPP
+#define VK_IMM_RENDERER_TEST_COMMON_HPP
+
+#include <iostream>
+#include <exception>
+
+// Just enough for the CPU tests: failed checks are printed and turn the exit code into 1, the test goes on
+
+namespace imr::test {
+
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline void check(bool passed, const char* expression, const char* file, int line) {
+        if (passed) return;
+
+        std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+        failures()++;
+    }
+
+    // Return value of main
+    inline int finish(const char* name) {
+        if (failures() == 0) {
+            std::cout << name << ": all checks passed\n";
+            return 0;
+        }
+
+        std::cerr << name << ": " << failures() << " checks failed\n";
+        return 1;
+    }
+
+} // imr::test
+
+#define IMR_CHECK(expression) ::imr::test::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+#define IMR_CHECK_THROWS(statement)                                                  \
+    do {                                                                             \
+        bool threw = false;                                                          \
+        try { statement; } catch (const std::exception&) { threw = true; }           \
+        ::imr::test::check(threw, #statement " throws", __FILE__, __LINE__);         \
+    } while (false)
+
+#endif //VK_IMM_RENDERER_TEST_COMMON_HPP